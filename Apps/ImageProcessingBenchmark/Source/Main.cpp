@@ -0,0 +1,174 @@
+// Times the processing of decoded 2K and 4K images in a single fused pass against the separate passes it replaced,
+// and checks that both produce the same bytes. Returns a nonzero exit code when they differ.
+
+#include <ImageProcessing.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstring>
+#include <functional>
+#include <iomanip>
+#include <iostream>
+#include <vector>
+
+using namespace Babylon;
+
+namespace
+{
+    constexpr size_t Iterations{5};
+
+    struct Scenario
+    {
+        const char* Name;
+        bimg::TextureFormat::Enum Format;
+        ImageProcessingOptions Options;
+    };
+
+    bimg::ImageContainer* MakeImage(bx::AllocatorI* allocator, bimg::TextureFormat::Enum format, uint16_t size)
+    {
+        bimg::ImageContainer* image = bimg::imageAlloc(allocator, format, size, size, 1, 1, false, false);
+        uint8_t* data = static_cast<uint8_t*>(image->m_data);
+        uint32_t state = 0x12345678;
+        for (uint32_t index = 0; index < image->m_size; ++index)
+        {
+            state = state * 1664525u + 1013904223u;
+            data[index] = static_cast<uint8_t>(state >> 24);
+        }
+        return image;
+    }
+
+    bimg::ImageContainer* CopyImage(bx::AllocatorI* allocator, const bimg::ImageContainer& image)
+    {
+        bimg::ImageContainer* copy = bimg::imageAlloc(allocator, image.m_format, static_cast<uint16_t>(image.m_width), static_cast<uint16_t>(image.m_height), 1, 1, false, false);
+        std::memcpy(copy->m_data, image.m_data, image.m_size);
+        return copy;
+    }
+
+    // Applies the options one full pass over the image at a time, as images were processed before the passes were fused.
+    bimg::ImageContainer* ProcessImageInSteps(bx::AllocatorI* allocator, const bimg::ImageContainer& input, const ImageProcessingOptions& options)
+    {
+        using namespace ImageProcessingDetail;
+
+        const bool narrow = options.NarrowTo8Bits && input.m_format == bimg::TextureFormat::RGBA16;
+        const bimg::TextureFormat::Enum format = narrow ? bimg::TextureFormat::RGBA8 : input.m_format;
+        const uint32_t width = input.m_width;
+        const uint32_t height = input.m_height;
+        const size_t rowSize = static_cast<size_t>(width) * MipGenerationDetail::GetChannelCount(format);
+
+        bimg::ImageContainer* image = bimg::imageAlloc(allocator, format, static_cast<uint16_t>(width), static_cast<uint16_t>(height), 1, 1, false, false);
+        uint8_t* data = static_cast<uint8_t*>(image->m_data);
+        if (narrow)
+        {
+            NarrowRow(static_cast<const uint8_t*>(input.m_data), data, static_cast<uint32_t>(rowSize * height));
+        }
+        else
+        {
+            std::memcpy(data, input.m_data, rowSize * height);
+        }
+
+        if (options.FlipY)
+        {
+            for (uint32_t y = 0; y < height / 2; ++y)
+            {
+                std::swap_ranges(data + y * rowSize, data + (y + 1) * rowSize, data + (height - 1 - y) * rowSize);
+            }
+        }
+
+        if (options.PremultiplyAlpha && MipGenerationDetail::GetChannelCount(format) == 4)
+        {
+            for (uint32_t y = 0; y < height; ++y)
+            {
+                PremultiplyRow(data + y * rowSize, width);
+            }
+        }
+
+        if (options.GenerateMips)
+        {
+            bimg::ImageContainer* mips = GenerateMipChain(allocator, *image, options.Filter, options.Srgb);
+            bimg::imageFree(image);
+            image = mips;
+        }
+
+        return image;
+    }
+
+    // Returns the median duration of the processing, in milliseconds, and the result of the last iteration.
+    double Time(bx::AllocatorI* allocator, const bimg::ImageContainer& source, const std::function<bimg::ImageContainer*(bimg::ImageContainer*)>& process, bimg::ImageContainer*& result)
+    {
+        std::vector<double> durations{};
+        for (size_t iteration = 0; iteration < Iterations; ++iteration)
+        {
+            // The copy of the decoded image is not timed, the decoder hands over a fresh image each time.
+            bimg::ImageContainer* input = CopyImage(allocator, source);
+            const auto start = std::chrono::steady_clock::now();
+            bimg::ImageContainer* output = process(input);
+            durations.push_back(std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count());
+
+            if (result != nullptr)
+            {
+                bimg::imageFree(result);
+            }
+            result = output;
+        }
+
+        std::sort(durations.begin(), durations.end());
+        return durations[durations.size() / 2];
+    }
+}
+
+int main()
+{
+    bx::DefaultAllocator allocator{};
+
+    const Scenario scenarios[]{
+        {"RGBA8, flip, premultiply, box mips", bimg::TextureFormat::RGBA8, {true, true, false, true, MipFilter::Box, true}},
+        {"RGBA8, flip, premultiply, Kaiser mips", bimg::TextureFormat::RGBA8, {true, true, false, true, MipFilter::Kaiser, true}},
+        {"RGBA16, narrow, flip, premultiply, box mips", bimg::TextureFormat::RGBA16, {true, true, true, true, MipFilter::Box, true}},
+        {"RGBA8, flip, premultiply", bimg::TextureFormat::RGBA8, {true, true, false, false}},
+    };
+
+    size_t mismatches = 0;
+    for (const uint16_t size : {2048, 4096})
+    {
+        for (const auto& scenario : scenarios)
+        {
+            bimg::ImageContainer* source = MakeImage(&allocator, scenario.Format, size);
+
+            bimg::ImageContainer* unfused = nullptr;
+            const double unfusedTime = Time(&allocator, *source, [&](bimg::ImageContainer* input) {
+                bimg::ImageContainer* output = ProcessImageInSteps(&allocator, *input, scenario.Options);
+                bimg::imageFree(input);
+                return output;
+            }, unfused);
+
+            bimg::ImageContainer* fused = nullptr;
+            const double fusedTime = Time(&allocator, *source, [&](bimg::ImageContainer* input) {
+                if (!ProcessImage(&allocator, &input, scenario.Options))
+                {
+                    bimg::imageFree(input);
+                    return static_cast<bimg::ImageContainer*>(nullptr);
+                }
+                return input;
+            }, fused);
+
+            const bool identical = fused != nullptr && fused->m_size == unfused->m_size && std::memcmp(fused->m_data, unfused->m_data, unfused->m_size) == 0;
+            if (!identical)
+            {
+                mismatches++;
+            }
+
+            std::cout << size << "x" << size << " " << scenario.Name << ": separate passes " << std::fixed << std::setprecision(2) << unfusedTime
+                      << " ms, fused " << fusedTime << " ms, " << (identical ? "identical" : "MISMATCH") << std::endl;
+
+            if (fused != nullptr)
+            {
+                bimg::imageFree(fused);
+            }
+            bimg::imageFree(unfused);
+            bimg::imageFree(source);
+        }
+    }
+
+    return mismatches == 0 ? 0 : 1;
+}
@@ -0,0 +1,68 @@
+#include "UnitTests.h"
+
+#include <BindingShadowState.h>
+
+using Babylon::BindingShadowState;
+
+TEST(BindingShadowStateSkipsRepeatedTextures)
+{
+    BindingShadowState state{};
+
+    CHECK(state.SetTexture(0, 4, 10, 0));
+    CHECK(!state.SetTexture(0, 4, 10, 0));
+
+    // Another sampler, texture or set of flags on the stage is a new binding.
+    CHECK(state.SetTexture(0, 5, 10, 0));
+    CHECK(state.SetTexture(0, 5, 11, 0));
+    CHECK(state.SetTexture(0, 5, 11, 1));
+
+    // Stages are independent.
+    CHECK(state.SetTexture(1, 5, 11, 1));
+    CHECK(!state.SetTexture(0, 5, 11, 1));
+
+    CHECK(state.GetStatistics().BindingsSubmitted == 5);
+    CHECK(state.GetStatistics().BindingsElided == 2);
+}
+
+TEST(BindingShadowStateComparesBufferRanges)
+{
+    BindingShadowState state{};
+
+    CHECK(state.SetVertexBuffer(0, 7, 0, 2));
+    CHECK(!state.SetVertexBuffer(0, 7, 0, 2));
+    CHECK(state.SetVertexBuffer(0, 7, 16, 2));
+    CHECK(state.SetVertexBuffer(0, 7, 16, 3));
+
+    CHECK(state.SetIndexBuffer(9, 0, 36));
+    CHECK(!state.SetIndexBuffer(9, 0, 36));
+    CHECK(state.SetIndexBuffer(9, 36, 36));
+}
+
+TEST(BindingShadowStateAlwaysBindsUncomparableBuffers)
+{
+    BindingShadowState state{};
+    constexpr auto transient = BindingShadowState::UncomparableBuffer;
+
+    CHECK(state.SetVertexBuffer(0, transient, 0, 1));
+    CHECK(state.SetVertexBuffer(0, transient, 0, 1));
+
+    // The slot stays unknown after an uncomparable binding.
+    CHECK(state.SetIndexBuffer(transient, 0, 6));
+    CHECK(state.SetIndexBuffer(3, 0, 6));
+    CHECK(!state.SetIndexBuffer(3, 0, 6));
+}
+
+TEST(BindingShadowStateForgetsDiscardedBindings)
+{
+    BindingShadowState state{};
+
+    CHECK(state.SetIndexBuffer(3, 0, 6));
+    state.DiscardIndexBuffer();
+    CHECK(state.SetIndexBuffer(3, 0, 6));
+
+    CHECK(state.SetTexture(2, 1, 1, 0));
+    CHECK(state.SetVertexBuffer(1, 1, 0, 0));
+    state.Reset();
+    CHECK(state.SetTexture(2, 1, 1, 0));
+    CHECK(state.SetVertexBuffer(1, 1, 0, 0));
+}
@@ -0,0 +1,65 @@
+#include "UnitTests.h"
+
+#include <CommandStream.h>
+
+#include <cstdint>
+#include <stdexcept>
+
+using namespace Babylon;
+
+namespace
+{
+    // The table only compares addresses, the objects are never dereferenced.
+    template<typename T>
+    const T* FakeObject(const void* storage)
+    {
+        return static_cast<const T*>(storage);
+    }
+
+    uint64_t ToHandle(const void* object)
+    {
+        return static_cast<uint64_t>(reinterpret_cast<uintptr_t>(object));
+    }
+}
+
+TEST(CommandHandleTableResolvesRegisteredObjects)
+{
+    const uint64_t storage[2]{};
+    CommandHandleTable handles{};
+    handles.Register(FakeObject<VertexArray>(&storage[0]));
+    handles.Register(FakeObject<TextureData>(&storage[1]));
+
+    CHECK(handles.Resolve<VertexArray>(ToHandle(&storage[0])) == FakeObject<VertexArray>(&storage[0]));
+    CHECK(handles.Resolve<TextureData>(ToHandle(&storage[1])) == FakeObject<TextureData>(&storage[1]));
+}
+
+TEST(CommandHandleTableRejectsNullAndStaleHandles)
+{
+    const uint64_t storage{};
+    CommandHandleTable handles{};
+    CHECK_THROWS(handles.Resolve<VertexArray>(0), std::runtime_error);
+    CHECK_THROWS(handles.Resolve<VertexArray>(ToHandle(&storage)), std::runtime_error);
+
+    handles.Register(FakeObject<VertexArray>(&storage));
+    handles.Unregister(&storage);
+    CHECK(!handles.Contains(&storage));
+    CHECK_THROWS(handles.Resolve<VertexArray>(ToHandle(&storage)), std::runtime_error);
+}
+
+TEST(CommandHandleTableRejectsObjectsOfAnotherType)
+{
+    const uint64_t storage{};
+    CommandHandleTable handles{};
+    handles.Register(FakeObject<TextureData>(&storage));
+
+    CHECK_THROWS(handles.Resolve<VertexArray>(ToHandle(&storage)), std::runtime_error);
+    CHECK_THROWS(handles.Resolve<ProgramData>(ToHandle(&storage)), std::runtime_error);
+    CHECK_THROWS(handles.Resolve<UniformInfo>(ToHandle(&storage)), std::runtime_error);
+    CHECK_THROWS(handles.Resolve<FrameBufferData>(ToHandle(&storage)), std::runtime_error);
+
+    // Memory reused by an object of another type is registered again with the new type.
+    handles.Unregister(&storage);
+    handles.Register(FakeObject<UniformInfo>(&storage));
+    CHECK(handles.Resolve<UniformInfo>(ToHandle(&storage)) == FakeObject<UniformInfo>(&storage));
+    CHECK_THROWS(handles.Resolve<TextureData>(ToHandle(&storage)), std::runtime_error);
+}
@@ -0,0 +1,130 @@
+#include "UnitTests.h"
+
+#include <CubeTextureAssembly.h>
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <stdexcept>
+#include <thread>
+#include <vector>
+
+using namespace Babylon;
+
+namespace
+{
+    bimg::ImageContainer* MakeImage(bx::AllocatorI* allocator, uint16_t width, uint16_t height, uint8_t seed, bool hasMips = false)
+    {
+        bimg::ImageContainer* image = bimg::imageAlloc(allocator, bimg::TextureFormat::RGBA8, width, height, 1, 1, false, hasMips);
+        uint8_t* data = static_cast<uint8_t*>(image->m_data);
+        for (uint32_t index = 0; index < image->m_size; ++index)
+        {
+            data[index] = static_cast<uint8_t>(index * 37 + seed);
+        }
+        return image;
+    }
+
+    uint32_t GetLevelSize(uint32_t width, uint32_t height, uint32_t mip)
+    {
+        return std::max(width >> mip, 1u) * std::max(height >> mip, 1u) * 4;
+    }
+}
+
+TEST(CubeTextureAssemblyGeneratesMipsOfEachFace)
+{
+    bx::DefaultAllocator allocator{};
+    constexpr uint16_t size{16};
+    CubeTextureAssembly assembly{1, true, MipFilter::Box};
+
+    // The faces are placed concurrently, as by the decoding tasks.
+    std::vector<bimg::ImageContainer*> expected{};
+    std::vector<std::thread> threads{};
+    for (uint32_t face = 0; face < 6; ++face)
+    {
+        bimg::ImageContainer* image = MakeImage(&allocator, size, size, static_cast<uint8_t>(face));
+        expected.push_back(GenerateMipChain(&allocator, *image, MipFilter::Box, false));
+        threads.emplace_back([&assembly, image, face] { assembly.Place(image, face, 0); });
+    }
+    for (auto& thread : threads)
+    {
+        thread.join();
+    }
+
+    CHECK(assembly.HasMips());
+    CHECK(assembly.GetWidth() == size && assembly.GetHeight() == size);
+    CHECK(assembly.GetDataSize() == expected[0]->m_size * 6);
+    for (uint32_t face = 0; face < 6; ++face)
+    {
+        const bimg::ImageContainer image = assembly.GetFace(face);
+        CHECK(image.m_numMips == expected[face]->m_numMips);
+        CHECK(assembly.GetData() + face * expected[face]->m_size == image.m_data);
+        CHECK(std::memcmp(image.m_data, expected[face]->m_data, expected[face]->m_size) == 0);
+        bimg::imageFree(expected[face]);
+    }
+}
+
+TEST(CubeTextureAssemblyPlacesLoadedMipsInAnyOrder)
+{
+    bx::DefaultAllocator allocator{};
+    constexpr uint16_t size{8};
+    constexpr uint8_t mipCount{3};
+    CubeTextureAssembly assembly{mipCount, false};
+
+    // The last levels arrive before any first level, and are kept until the block is allocated.
+    for (uint32_t face = 0; face < 6; ++face)
+    {
+        for (uint8_t mip = mipCount; mip-- > 0;)
+        {
+            const uint16_t mipSize = static_cast<uint16_t>(size >> mip);
+            assembly.Place(MakeImage(&allocator, mipSize, mipSize, static_cast<uint8_t>(face * 16 + mip)), face, mip);
+        }
+    }
+
+    CHECK(assembly.HasMips());
+    const uint32_t faceSize = GetLevelSize(size, size, 0) + GetLevelSize(size, size, 1) + GetLevelSize(size, size, 2);
+    CHECK(assembly.GetDataSize() == faceSize * 6);
+    for (uint32_t face = 0; face < 6; ++face)
+    {
+        uint32_t offset = face * faceSize;
+        for (uint8_t mip = 0; mip < mipCount; ++mip)
+        {
+            const uint16_t mipSize = static_cast<uint16_t>(size >> mip);
+            bimg::ImageContainer* level = MakeImage(&allocator, mipSize, mipSize, static_cast<uint8_t>(face * 16 + mip));
+            CHECK(std::memcmp(assembly.GetData() + offset, level->m_data, level->m_size) == 0);
+            offset += level->m_size;
+            bimg::imageFree(level);
+        }
+    }
+}
+
+TEST(CubeTextureAssemblyCopiesExistingMipChains)
+{
+    // Faces found in the texture cache already hold their generated mips.
+    bx::DefaultAllocator allocator{};
+    constexpr uint16_t size{4};
+    CubeTextureAssembly assembly{1, true};
+    std::vector<bimg::ImageContainer*> faces{};
+    for (uint32_t face = 0; face < 6; ++face)
+    {
+        faces.push_back(MakeImage(&allocator, size, size, static_cast<uint8_t>(face), true));
+        assembly.Place(*faces.back(), face);
+    }
+
+    for (uint32_t face = 0; face < 6; ++face)
+    {
+        CHECK(std::memcmp(assembly.GetFace(face).m_data, faces[face]->m_data, faces[face]->m_size) == 0);
+        bimg::imageFree(faces[face]);
+    }
+}
+
+TEST(CubeTextureAssemblyRejectsMismatchedFaces)
+{
+    bx::DefaultAllocator allocator{};
+    CubeTextureAssembly assembly{2, false};
+    assembly.Place(MakeImage(&allocator, 8, 8, 0), 0, 0);
+
+    CHECK_THROWS(assembly.Place(MakeImage(&allocator, 4, 4, 0), 1, 0), std::runtime_error);
+    CHECK_THROWS(assembly.Place(MakeImage(&allocator, 8, 8, 0), 1, 1), std::runtime_error);
+    CHECK_THROWS(assembly.Place(MakeImage(&allocator, 2, 2, 0), 1, 2), std::runtime_error);
+    CHECK_THROWS(assembly.Place(nullptr, 1, 0), std::runtime_error);
+}
@@ -0,0 +1,226 @@
+#include "UnitTests.h"
+
+#include <ImageProcessing.h>
+
+#include <cstdint>
+#include <cstring>
+#include <utility>
+#include <vector>
+
+using namespace Babylon;
+using namespace Babylon::ImageProcessingDetail;
+
+namespace
+{
+    bimg::ImageContainer* MakeImage(bx::AllocatorI* allocator, bimg::TextureFormat::Enum format, uint16_t width, uint16_t height)
+    {
+        bimg::ImageContainer* image = bimg::imageAlloc(allocator, format, width, height, 1, 1, false, false);
+        uint8_t* data = static_cast<uint8_t*>(image->m_data);
+        for (uint32_t index = 0; index < image->m_size; ++index)
+        {
+            data[index] = static_cast<uint8_t>((index * 37) ^ (index >> 7));
+        }
+        return image;
+    }
+
+    // Applies the options one full pass over the image at a time, as images were processed before the passes were fused.
+    bimg::ImageContainer* ProcessImageInSteps(bx::AllocatorI* allocator, const bimg::ImageContainer& input, const ImageProcessingOptions& options)
+    {
+        const bool narrow = options.NarrowTo8Bits && input.m_format == bimg::TextureFormat::RGBA16;
+        const bimg::TextureFormat::Enum format = narrow ? bimg::TextureFormat::RGBA8 : input.m_format;
+        const uint32_t width = input.m_width;
+        const uint32_t height = input.m_height;
+        const size_t rowSize = static_cast<size_t>(width) * MipGenerationDetail::GetChannelCount(format);
+
+        bimg::ImageContainer* image = bimg::imageAlloc(allocator, format, static_cast<uint16_t>(width), static_cast<uint16_t>(height), 1, 1, false, false);
+        uint8_t* data = static_cast<uint8_t*>(image->m_data);
+        if (narrow)
+        {
+            NarrowRow(static_cast<const uint8_t*>(input.m_data), data, static_cast<uint32_t>(rowSize * height));
+        }
+        else
+        {
+            std::memcpy(data, input.m_data, rowSize * height);
+        }
+
+        if (options.FlipY)
+        {
+            for (uint32_t y = 0; y < height / 2; ++y)
+            {
+                std::swap_ranges(data + y * rowSize, data + (y + 1) * rowSize, data + (height - 1 - y) * rowSize);
+            }
+        }
+
+        if (options.PremultiplyAlpha && MipGenerationDetail::GetChannelCount(format) == 4)
+        {
+            for (uint32_t y = 0; y < height; ++y)
+            {
+                PremultiplyRow(data + y * rowSize, width);
+            }
+        }
+
+        if (options.GenerateMips)
+        {
+            bimg::ImageContainer* mips = GenerateMipChain(allocator, *image, options.Filter, options.Srgb);
+            bimg::imageFree(image);
+            image = mips;
+        }
+
+        return image;
+    }
+
+    void CheckSameAsSteps(bimg::TextureFormat::Enum format, uint16_t width, uint16_t height, const ImageProcessingOptions& options)
+    {
+        bx::DefaultAllocator allocator{};
+        bimg::ImageContainer* image = MakeImage(&allocator, format, width, height);
+        bimg::ImageContainer* expected = ProcessImageInSteps(&allocator, *image, options);
+
+        CHECK(ProcessImage(&allocator, &image, options));
+        CHECK(image->m_format == expected->m_format);
+        CHECK(image->m_numMips == expected->m_numMips);
+        CHECK(image->m_size == expected->m_size);
+        CHECK(std::memcmp(image->m_data, expected->m_data, expected->m_size) == 0);
+
+        bimg::imageFree(expected);
+        bimg::imageFree(image);
+    }
+}
+
+TEST(ImageProcessingMultipliesBytesExactly)
+{
+    for (uint32_t value = 0; value < 256; ++value)
+    {
+        for (uint32_t alpha = 0; alpha < 256; ++alpha)
+        {
+            CHECK(MultiplyBytes(value, alpha) == (value * alpha * 2 + 255) / 510);
+        }
+    }
+}
+
+TEST(ImageProcessingPremultipliesRows)
+{
+    // Odd widths go through the SIMD loop and the scalar tail.
+    for (const uint32_t width : {1u, 3u, 4u, 17u, 35u})
+    {
+        std::vector<uint8_t> row(width * 4);
+        for (size_t index = 0; index < row.size(); ++index)
+        {
+            row[index] = static_cast<uint8_t>(index * 71 + 13);
+        }
+        const std::vector<uint8_t> source = row;
+
+        PremultiplyRow(row.data(), width);
+        for (uint32_t x = 0; x < width; ++x)
+        {
+            const uint8_t alpha = source[x * 4 + 3];
+            CHECK(row[x * 4 + 3] == alpha);
+            for (uint32_t channel = 0; channel < 3; ++channel)
+            {
+                CHECK(row[x * 4 + channel] == MultiplyBytes(source[x * 4 + channel], alpha));
+            }
+        }
+    }
+}
+
+TEST(ImageProcessingNarrowsToNearestByte)
+{
+    const std::vector<uint16_t> values{0, 128, 129, 257, 32767, 32896, 65406, 65535};
+    std::vector<uint8_t> narrowed(values.size());
+    NarrowRow(reinterpret_cast<const uint8_t*>(values.data()), narrowed.data(), static_cast<uint32_t>(values.size()));
+    CHECK((narrowed == std::vector<uint8_t>{0, 0, 1, 1, 127, 128, 254, 255}));
+}
+
+TEST(ImageProcessingMatchesSeparatePasses)
+{
+    // Odd sizes leave a partial last band and clamp the last mip row and column. The larger image has its rows split
+    // across threads.
+    const std::pair<uint16_t, uint16_t> sizes[]{{70, 45}, {1, 67}, {300, 257}};
+    for (const auto& [width, height] : sizes)
+    {
+        for (const auto filter : {MipFilter::Box, MipFilter::Kaiser})
+        {
+            CheckSameAsSteps(bimg::TextureFormat::RGBA8, width, height, {true, true, false, true, filter, true});
+            CheckSameAsSteps(bimg::TextureFormat::RGBA16, width, height, {true, true, true, true, filter, false});
+        }
+
+        CheckSameAsSteps(bimg::TextureFormat::RGBA16, width, height, {false, true, true, false});
+        CheckSameAsSteps(bimg::TextureFormat::RG8, width, height, {true, true, false, true});
+    }
+}
+
+TEST(ImageProcessingWorksInPlaceWithoutMips)
+{
+    bx::DefaultAllocator allocator{};
+    for (const uint16_t height : {1, 6, 7})
+    {
+        const ImageProcessingOptions options{true, true, false, false};
+        bimg::ImageContainer* image = MakeImage(&allocator, bimg::TextureFormat::RGBA8, 9, height);
+        bimg::ImageContainer* expected = ProcessImageInSteps(&allocator, *image, options);
+
+        const void* data = image->m_data;
+        CHECK(ProcessImage(&allocator, &image, options));
+        CHECK(image->m_data == data);
+        CHECK(std::memcmp(image->m_data, expected->m_data, expected->m_size) == 0);
+
+        bimg::imageFree(expected);
+        bimg::imageFree(image);
+    }
+}
+
+TEST(ImageProcessingRejectsUnsupportedImages)
+{
+    bx::DefaultAllocator allocator{};
+    const ImageProcessingOptions options{true, true, false, true};
+
+    // 16-bit channels are only supported when narrowed.
+    bimg::ImageContainer* image = MakeImage(&allocator, bimg::TextureFormat::RGBA16, 4, 4);
+    const bimg::ImageContainer* input = image;
+    CHECK(!ProcessImage(&allocator, &image, options));
+    CHECK(image == input);
+    bimg::imageFree(image);
+
+    // Images which already have mips are left to bimg.
+    image = bimg::imageAlloc(&allocator, bimg::TextureFormat::RGBA8, 4, 4, 1, 1, false, true);
+    input = image;
+    CHECK(!ProcessImage(&allocator, &image, options));
+    CHECK(image == input);
+    bimg::imageFree(image);
+}
+
+TEST(PremultiplyAlphaCoversImagesProcessImageRejects)
+{
+    bx::DefaultAllocator allocator{};
+
+    // Every mip of an image which already has mips is premultiplied in place.
+    bimg::ImageContainer* image = bimg::imageAlloc(&allocator, bimg::TextureFormat::RGBA8, 4, 4, 1, 1, false, true);
+    std::memset(image->m_data, 0x80, image->m_size);
+    const void* data = image->m_data;
+    PremultiplyAlpha(&allocator, &image);
+    CHECK(image->m_data == data);
+    const uint8_t* bytes = static_cast<const uint8_t*>(image->m_data);
+    CHECK(bytes[0] == 0x40 && bytes[3] == 0x80);
+    CHECK(bytes[image->m_size - 4] == 0x40 && bytes[image->m_size - 1] == 0x80);
+    bimg::imageFree(image);
+
+    // Wider formats go through floats.
+    image = bimg::imageAlloc(&allocator, bimg::TextureFormat::RGBA16, 1, 1, 1, 1, false, false);
+    uint16_t* channels = static_cast<uint16_t*>(image->m_data);
+    channels[0] = 65535;
+    channels[1] = 65535;
+    channels[2] = 0;
+    channels[3] = 32768;
+    PremultiplyAlpha(&allocator, &image);
+    CHECK(image->m_format == bimg::TextureFormat::RGBA16);
+    channels = static_cast<uint16_t*>(image->m_data);
+    CHECK(channels[0] >= 32767 && channels[0] <= 32769);
+    CHECK(channels[2] == 0 && channels[3] == 32768);
+    bimg::imageFree(image);
+
+    // Formats without alpha are left unchanged.
+    image = MakeImage(&allocator, bimg::TextureFormat::RGB8, 3, 3);
+    bimg::ImageContainer* expected = MakeImage(&allocator, bimg::TextureFormat::RGB8, 3, 3);
+    PremultiplyAlpha(&allocator, &image);
+    CHECK(std::memcmp(image->m_data, expected->m_data, expected->m_size) == 0);
+    bimg::imageFree(expected);
+    bimg::imageFree(image);
+}
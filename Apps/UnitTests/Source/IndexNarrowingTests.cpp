@@ -0,0 +1,72 @@
+#include "UnitTests.h"
+
+#include <IndexNarrowing.h>
+
+#include <cstdint>
+#include <vector>
+
+using Babylon::IndicesFitIn16Bits;
+using Babylon::NarrowIndices;
+
+namespace
+{
+    // Long enough to go through the SIMD loops and the scalar tail.
+    std::vector<uint32_t> MakeIndices(size_t count)
+    {
+        std::vector<uint32_t> indices(count);
+        for (size_t index = 0; index < count; ++index)
+        {
+            indices[index] = static_cast<uint32_t>(index * 997 % 65535);
+        }
+        return indices;
+    }
+}
+
+TEST(IndexNarrowingAcceptsIndicesBelowRestartValue)
+{
+    auto indices = MakeIndices(37);
+    CHECK(IndicesFitIn16Bits(indices.data(), indices.size()));
+
+    indices[5] = 0xFFFE;
+    indices[36] = 0xFFFE;
+    CHECK(IndicesFitIn16Bits(indices.data(), indices.size()));
+
+    CHECK(IndicesFitIn16Bits(indices.data(), 0));
+}
+
+TEST(IndexNarrowingRejectsRestartValue)
+{
+    // In a SIMD lane and in the scalar tail.
+    for (const size_t position : {size_t{2}, size_t{36}})
+    {
+        auto indices = MakeIndices(37);
+        indices[position] = 0xFFFF;
+        CHECK(!IndicesFitIn16Bits(indices.data(), indices.size()));
+    }
+}
+
+TEST(IndexNarrowingRejectsIndicesAbove16Bits)
+{
+    for (const size_t position : {size_t{0}, size_t{17}, size_t{36}})
+    {
+        auto indices = MakeIndices(37);
+        indices[position] = 0x10000;
+        CHECK(!IndicesFitIn16Bits(indices.data(), indices.size()));
+    }
+}
+
+TEST(IndexNarrowingKeepsValues)
+{
+    auto indices = MakeIndices(37);
+    indices[3] = 0x7FFF;
+    indices[4] = 0x8000;
+    indices[8] = 0xFFFE;
+    indices[9] = 0;
+
+    std::vector<uint16_t> narrowed(indices.size());
+    NarrowIndices(indices.data(), indices.size(), narrowed.data());
+    for (size_t index = 0; index < indices.size(); ++index)
+    {
+        CHECK(narrowed[index] == indices[index]);
+    }
+}
@@ -0,0 +1,130 @@
+#include "UnitTests.h"
+
+#include <IndexOptimization.h>
+
+#include <algorithm>
+#include <array>
+#include <cstdint>
+#include <random>
+#include <stdexcept>
+#include <vector>
+
+using Babylon::OptimizeIndices;
+
+namespace
+{
+    constexpr uint32_t GridSize{40};
+
+    // The triangles of a grid of GridSize by GridSize quads, in a random order.
+    std::vector<uint32_t> MakeShuffledGrid()
+    {
+        std::vector<std::array<uint32_t, 3>> triangles{};
+        for (uint32_t y = 0; y < GridSize; ++y)
+        {
+            for (uint32_t x = 0; x < GridSize; ++x)
+            {
+                const uint32_t a = y * (GridSize + 1) + x;
+                const uint32_t b = a + 1;
+                const uint32_t c = a + GridSize + 1;
+                const uint32_t d = c + 1;
+                triangles.push_back({a, b, c});
+                triangles.push_back({b, d, c});
+            }
+        }
+
+        std::mt19937 random{7};
+        std::shuffle(triangles.begin(), triangles.end(), random);
+
+        std::vector<uint32_t> indices{};
+        for (const auto& triangle : triangles)
+        {
+            indices.insert(indices.end(), triangle.begin(), triangle.end());
+        }
+        return indices;
+    }
+
+    std::vector<float> MakeGridPositions()
+    {
+        std::vector<float> positions{};
+        for (uint32_t y = 0; y <= GridSize; ++y)
+        {
+            for (uint32_t x = 0; x <= GridSize; ++x)
+            {
+                positions.insert(positions.end(), {static_cast<float>(x), static_cast<float>(y), 0.0f});
+            }
+        }
+        return positions;
+    }
+
+    std::vector<std::array<uint32_t, 3>> SortedTriangles(const std::vector<uint32_t>& indices, size_t first, size_t count)
+    {
+        std::vector<std::array<uint32_t, 3>> triangles{};
+        for (size_t index = first; index < first + count; index += 3)
+        {
+            triangles.push_back({indices[index], indices[index + 1], indices[index + 2]});
+        }
+        std::sort(triangles.begin(), triangles.end());
+        return triangles;
+    }
+}
+
+TEST(IndexOptimizationReducesCacheMisses)
+{
+    const auto original = MakeShuffledGrid();
+    auto indices = original;
+
+    const auto statistics = OptimizeIndices(indices, {}, {});
+    CHECK(statistics.AcmrAfter < statistics.AcmrBefore);
+    CHECK(statistics.AcmrAfter < 1.0);
+
+    // The triangles, and the winding of each, are unchanged.
+    CHECK(SortedTriangles(indices, 0, indices.size()) == SortedTriangles(original, 0, original.size()));
+}
+
+TEST(IndexOptimizationKeepsTrianglesInTheirRange)
+{
+    const auto original = MakeShuffledGrid();
+    const uint32_t split = static_cast<uint32_t>(original.size() / 3 / 2 * 3);
+    const std::vector<uint32_t> ranges{0, split, split, static_cast<uint32_t>(original.size()) - split};
+    const auto positions = MakeGridPositions();
+
+    auto indices = original;
+    const auto statistics = OptimizeIndices(indices, ranges, positions);
+    CHECK(statistics.AcmrAfter < statistics.AcmrBefore);
+
+    CHECK(SortedTriangles(indices, 0, split) == SortedTriangles(original, 0, split));
+    CHECK(SortedTriangles(indices, split, original.size() - split) == SortedTriangles(original, split, original.size() - split));
+}
+
+TEST(IndexOptimizationRejectsInvalidRanges)
+{
+    auto indices = MakeShuffledGrid();
+    const std::vector<uint32_t> odd{0};
+    const std::vector<uint32_t> partialTriangle{0, 4};
+    const std::vector<uint32_t> outOfBounds{3, static_cast<uint32_t>(indices.size())};
+    const std::vector<float> tooFewPositions(9, 0.0f);
+
+    CHECK_THROWS(OptimizeIndices(indices, odd, {}), std::runtime_error);
+    CHECK_THROWS(OptimizeIndices(indices, partialTriangle, {}), std::runtime_error);
+    CHECK_THROWS(OptimizeIndices(indices, outOfBounds, {}), std::runtime_error);
+    CHECK_THROWS(OptimizeIndices(indices, {}, tooFewPositions), std::runtime_error);
+}
+
+TEST(IndexOptimizationRejectsOutOfRangeIndices)
+{
+    std::vector<uint32_t> restart{0, 1, UINT32_MAX};
+    std::vector<uint32_t> tooManyVertices{0, 1, static_cast<uint32_t>(Babylon::IndexOptimizationMaxVertexCount)};
+    const std::vector<float> positions(9, 0.0f);
+
+    CHECK_THROWS(OptimizeIndices(restart, {}, {}), std::runtime_error);
+    CHECK_THROWS(OptimizeIndices(restart, {}, positions), std::runtime_error);
+    CHECK_THROWS(OptimizeIndices(tooManyVertices, {}, {}), std::runtime_error);
+    CHECK(restart == (std::vector<uint32_t>{0, 1, UINT32_MAX}));
+}
+
+TEST(IndexOptimizationAcceptsNoTriangles)
+{
+    std::vector<uint32_t> indices{};
+    const auto statistics = OptimizeIndices(indices, {}, {});
+    CHECK(statistics.AcmrBefore == 0.0 && statistics.AcmrAfter == 0.0);
+}
@@ -0,0 +1,25 @@
+#include "UnitTests.h"
+
+#include <exception>
+#include <iostream>
+
+int main()
+{
+    size_t failures = 0;
+    for (const auto& test : UnitTests::GetTests())
+    {
+        try
+        {
+            test.Run();
+            std::cout << "[PASSED] " << test.Name << std::endl;
+        }
+        catch (const std::exception& exception)
+        {
+            std::cout << "[FAILED] " << test.Name << ": " << exception.what() << std::endl;
+            failures++;
+        }
+    }
+
+    std::cout << UnitTests::GetTests().size() - failures << " of " << UnitTests::GetTests().size() << " tests passed." << std::endl;
+    return failures == 0 ? 0 : 1;
+}
@@ -0,0 +1,143 @@
+#include "UnitTests.h"
+
+#include <MipGeneration.h>
+
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <vector>
+
+using namespace Babylon;
+using namespace Babylon::MipGenerationDetail;
+
+namespace
+{
+    std::vector<uint8_t> MakeImage(uint32_t width, uint32_t height, uint32_t channels)
+    {
+        std::vector<uint8_t> image(static_cast<size_t>(width) * height * channels);
+        for (size_t index = 0; index < image.size(); ++index)
+        {
+            image[index] = static_cast<uint8_t>((index * 37) ^ (index >> 7));
+        }
+        return image;
+    }
+}
+
+TEST(MipGenerationBoxAveragesTexels)
+{
+    // Odd sizes go through the SIMD loop, the scalar tail and the clamping of the last column and row.
+    constexpr uint32_t width{67};
+    constexpr uint32_t height{33};
+    for (const uint32_t channels : {1u, 2u, 4u})
+    {
+        auto source = MakeImage(width, height, channels);
+        std::vector<uint8_t> destination(static_cast<size_t>(width / 2) * (height / 2) * channels);
+        DownsampleRows({source.data(), width, height}, {destination.data(), width / 2, height / 2}, channels, false, MipFilter::Box, 0, height / 2);
+
+        for (uint32_t y = 0; y < height / 2; ++y)
+        {
+            for (uint32_t x = 0; x < width / 2; ++x)
+            {
+                const uint32_t x1 = std::min(2 * x + 1, width - 1);
+                const uint32_t y1 = std::min(2 * y + 1, height - 1);
+                for (uint32_t channel = 0; channel < channels; ++channel)
+                {
+                    const uint32_t sum = source[(2 * y * width + 2 * x) * channels + channel] + source[(2 * y * width + x1) * channels + channel] +
+                                         source[(y1 * width + 2 * x) * channels + channel] + source[(y1 * width + x1) * channels + channel];
+                    CHECK(destination[(y * (width / 2) + x) * channels + channel] == (sum + 2) / 4);
+                }
+            }
+        }
+    }
+}
+
+TEST(MipGenerationKeepsConstantImages)
+{
+    constexpr uint32_t size{16};
+    std::vector<uint8_t> source(size * size * 4, 128);
+    for (const auto filter : {MipFilter::Box, MipFilter::Kaiser})
+    {
+        for (const bool srgb : {false, true})
+        {
+            std::vector<uint8_t> destination(size / 2 * size / 2 * 4, 0);
+            DownsampleRows({source.data(), size, size}, {destination.data(), size / 2, size / 2}, 4, srgb, filter, 0, size / 2);
+            for (const uint8_t value : destination)
+            {
+                CHECK(value == 128);
+            }
+        }
+    }
+}
+
+TEST(MipGenerationNormalizesKaiserWeights)
+{
+    float total = 0.0f;
+    for (const float weight : GetKaiserWeights())
+    {
+        total += weight;
+    }
+    CHECK(std::abs(total - 1.0f) < 1e-5f);
+
+    // The filter is symmetric around the output texel.
+    const auto& weights = GetKaiserWeights();
+    for (size_t tap = 0; tap < weights.size() / 2; ++tap)
+    {
+        CHECK(std::abs(weights[tap] - weights[weights.size() - 1 - tap]) < 1e-6f);
+    }
+}
+
+TEST(MipGenerationRunsEveryChunkOnce)
+{
+    constexpr uint32_t count{1000};
+    std::vector<std::atomic<uint32_t>> runs(count);
+    ParallelFor(count, 7, [&runs](uint32_t begin, uint32_t end) {
+        for (uint32_t index = begin; index < end; ++index)
+        {
+            runs[index]++;
+        }
+    });
+
+    for (const auto& run : runs)
+    {
+        CHECK(run.load() == 1);
+    }
+}
+
+TEST(MipGenerationBuildsFullChain)
+{
+    bx::DefaultAllocator allocator{};
+    constexpr uint16_t width{8};
+    constexpr uint16_t height{4};
+    bimg::ImageContainer* input = bimg::imageAlloc(&allocator, bimg::TextureFormat::RGBA8, width, height, 1, 1, false, false);
+    std::vector<uint8_t> texels(width * height * 4, 200);
+    texels[0] = 0;
+    std::memcpy(input->m_data, texels.data(), texels.size());
+
+    bimg::ImageContainer* output = GenerateMipChain(&allocator, *input, MipFilter::Box, false);
+    CHECK(output != nullptr);
+    CHECK(output->m_numMips == 4);
+
+    bimg::ImageMip mip{};
+    CHECK(bimg::imageGetRawData(*output, 0, 0, output->m_data, output->m_size, mip));
+    CHECK(std::memcmp(mip.m_data, texels.data(), texels.size()) == 0);
+
+    CHECK(bimg::imageGetRawData(*output, 0, 1, output->m_data, output->m_size, mip));
+    CHECK(mip.m_width == 4 && mip.m_height == 2 && mip.m_data[0] == 150 && mip.m_data[1] == 200);
+
+    CHECK(bimg::imageGetRawData(*output, 0, 3, output->m_data, output->m_size, mip));
+    CHECK(mip.m_width == 1 && mip.m_height == 1);
+
+    bimg::imageFree(output);
+    bimg::imageFree(input);
+}
+
+TEST(MipGenerationRejectsUnsupportedImages)
+{
+    bx::DefaultAllocator allocator{};
+    bimg::ImageContainer* input = bimg::imageAlloc(&allocator, bimg::TextureFormat::RGBA16, 4, 4, 1, 1, false, false);
+    CHECK(!CanGenerateMipChain(*input));
+    CHECK(GenerateMipChain(&allocator, *input, MipFilter::Box, false) == nullptr);
+    bimg::imageFree(input);
+}
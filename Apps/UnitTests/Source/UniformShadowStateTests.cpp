@@ -0,0 +1,59 @@
+#include "UnitTests.h"
+
+#include <UniformShadowState.h>
+
+#include <array>
+
+using Babylon::UniformShadowState;
+
+namespace
+{
+    constexpr bgfx::UniformHandle WorldUniform{1};
+    constexpr bgfx::UniformHandle ColorUniform{2};
+}
+
+TEST(UniformShadowStateSkipsRepeatedValues)
+{
+    UniformShadowState state{};
+    const std::array<float, 4> color{1.0f, 0.5f, 0.25f, 1.0f};
+
+    CHECK(state.Update(0, ColorUniform, color));
+    CHECK(!state.Update(0, ColorUniform, color));
+    CHECK(state.GetStatistics().UniformsSubmitted == 1);
+    CHECK(state.GetStatistics().UniformsElided == 1);
+}
+
+TEST(UniformShadowStateUploadsChangedValues)
+{
+    UniformShadowState state{};
+    std::array<float, 4> color{1.0f, 0.5f, 0.25f, 1.0f};
+
+    CHECK(state.Update(0, ColorUniform, color));
+    color[3] = 0.0f;
+    CHECK(state.Update(0, ColorUniform, color));
+
+    // An array of another length is another value, even when it starts the same.
+    CHECK(state.Update(0, ColorUniform, gsl::make_span(color.data(), 2)));
+}
+
+TEST(UniformShadowStateKeepsViewsAndHandlesApart)
+{
+    UniformShadowState state{};
+    const std::array<float, 4> value{1.0f, 2.0f, 3.0f, 4.0f};
+
+    CHECK(state.Update(0, ColorUniform, value));
+    CHECK(state.Update(1, ColorUniform, value));
+    CHECK(state.Update(0, WorldUniform, value));
+    CHECK(!state.Update(1, ColorUniform, value));
+}
+
+TEST(UniformShadowStateResetForgetsValues)
+{
+    UniformShadowState state{};
+    const std::array<float, 4> value{1.0f, 2.0f, 3.0f, 4.0f};
+
+    CHECK(state.Update(3, WorldUniform, value));
+    state.Reset();
+    CHECK(state.Update(3, WorldUniform, value));
+    CHECK(state.GetStatistics().UniformsSubmitted == 2);
+}
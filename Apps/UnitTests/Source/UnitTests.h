@@ -0,0 +1,71 @@
+#pragma once
+
+#include <functional>
+#include <sstream>
+#include <stdexcept>
+#include <vector>
+
+namespace UnitTests
+{
+    struct Test
+    {
+        const char* Name;
+        std::function<void()> Run;
+    };
+
+    inline std::vector<Test>& GetTests()
+    {
+        static std::vector<Test> tests{};
+        return tests;
+    }
+
+    struct Registration
+    {
+        Registration(const char* name, std::function<void()> run)
+        {
+            GetTests().push_back({name, std::move(run)});
+        }
+    };
+
+    inline void Fail(const char* expression, const char* file, int line)
+    {
+        std::ostringstream message{};
+        message << file << "(" << line << "): check failed: " << expression;
+        throw std::runtime_error{message.str()};
+    }
+}
+
+#define UNIT_TEST_CONCAT_INNER(a, b) a##b
+#define UNIT_TEST_CONCAT(a, b) UNIT_TEST_CONCAT_INNER(a, b)
+
+// Defines a test, run by the UnitTests executable along with all the other tests.
+#define TEST(name)                                                                                          \
+    static void name();                                                                                     \
+    static const UnitTests::Registration UNIT_TEST_CONCAT(name, Registration){#name, name};                 \
+    static void name()
+
+// Fails the current test when the condition is false.
+#define CHECK(condition)                                          \
+    do                                                            \
+    {                                                             \
+        if (!(condition))                                         \
+        {                                                         \
+            UnitTests::Fail(#condition, __FILE__, __LINE__);      \
+        }                                                         \
+    } while (false)
+
+// Fails the current test unless the expression throws the exception type.
+#define CHECK_THROWS(expression, exceptionType)                   \
+    do                                                            \
+    {                                                             \
+        bool thrown = false;                                      \
+        try                                                       \
+        {                                                         \
+            expression;                                           \
+        }                                                         \
+        catch (const exceptionType&)                              \
+        {                                                         \
+            thrown = true;                                        \
+        }                                                         \
+        CHECK(thrown);                                            \
+    } while (false)
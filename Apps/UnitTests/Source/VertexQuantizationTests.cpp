@@ -0,0 +1,84 @@
+#include "UnitTests.h"
+
+#include <VertexQuantization.h>
+
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <limits>
+#include <vector>
+
+using Babylon::CanQuantizeVertices;
+using Babylon::GetQuantizedVertexFormat;
+using Babylon::QuantizeVertices;
+using Babylon::VertexQuantization;
+
+namespace
+{
+    template<typename T>
+    std::vector<T> Quantize(VertexQuantization quantization, const std::vector<float>& values, uint32_t numElements)
+    {
+        const auto format = GetQuantizedVertexFormat(quantization, numElements);
+        const size_t vertexCount = values.size() / numElements;
+        std::vector<uint8_t> bytes(vertexCount * format.ByteStride);
+        QuantizeVertices(quantization, values.data(), vertexCount, numElements, bytes.data());
+
+        std::vector<T> result(bytes.size() / sizeof(T));
+        std::memcpy(result.data(), bytes.data(), bytes.size());
+        return result;
+    }
+}
+
+TEST(VertexQuantizationPadsFormats)
+{
+    const auto half3 = GetQuantizedVertexFormat(VertexQuantization::Half, 3);
+    CHECK(half3.Type == bgfx::AttribType::Half && half3.NumElements == 4 && !half3.Normalized && half3.ByteStride == 8);
+
+    const auto snorm2 = GetQuantizedVertexFormat(VertexQuantization::Snorm16, 2);
+    CHECK(snorm2.Type == bgfx::AttribType::Int16 && snorm2.NumElements == 2 && snorm2.Normalized && snorm2.ByteStride == 4);
+
+    const auto unorm1 = GetQuantizedVertexFormat(VertexQuantization::Unorm8, 1);
+    CHECK(unorm1.Type == bgfx::AttribType::Uint8 && unorm1.NumElements == 4 && unorm1.Normalized && unorm1.ByteStride == 4);
+
+    const auto none3 = GetQuantizedVertexFormat(VertexQuantization::None, 3);
+    CHECK(none3.Type == bgfx::AttribType::Float && none3.NumElements == 3 && none3.ByteStride == 12);
+}
+
+TEST(VertexQuantizationChecksRanges)
+{
+    const std::vector<float> unit{0.0f, 0.25f, 1.0f};
+    const std::vector<float> signedUnit{-1.0f, 0.0f, 1.0f};
+    const std::vector<float> large{-2.0f, 70000.0f};
+
+    CHECK(CanQuantizeVertices(VertexQuantization::Unorm8, unit.data(), unit.size()));
+    CHECK(!CanQuantizeVertices(VertexQuantization::Unorm8, signedUnit.data(), signedUnit.size()));
+    CHECK(CanQuantizeVertices(VertexQuantization::Snorm16, signedUnit.data(), signedUnit.size()));
+    CHECK(!CanQuantizeVertices(VertexQuantization::Snorm16, large.data(), 1));
+    CHECK(CanQuantizeVertices(VertexQuantization::Half, large.data(), 1));
+    CHECK(!CanQuantizeVertices(VertexQuantization::Half, large.data(), large.size()));
+    CHECK(!CanQuantizeVertices(VertexQuantization::None, unit.data(), unit.size()));
+
+    const std::vector<float> notFinite{0.5f, std::numeric_limits<float>::quiet_NaN()};
+    CHECK(!CanQuantizeVertices(VertexQuantization::Half, notFinite.data(), notFinite.size()));
+}
+
+TEST(VertexQuantizationConvertsToHalf)
+{
+    const auto halves = Quantize<uint16_t>(VertexQuantization::Half, {1.0f, -2.0f, 0.5f, 0.0f, 65504.0f, -0.25f}, 3);
+    const std::vector<uint16_t> expected{0x3C00, 0xC000, 0x3800, 0, 0, 0x7BFF, 0xB400, 0};
+    CHECK(halves == expected);
+}
+
+TEST(VertexQuantizationConvertsToSnorm16)
+{
+    const auto values = Quantize<int16_t>(VertexQuantization::Snorm16, {-1.0f, 1.0f, 0.0f, 0.5f}, 2);
+    const std::vector<int16_t> expected{-32767, 32767, 0, 16384};
+    CHECK(values == expected);
+}
+
+TEST(VertexQuantizationConvertsToUnorm8)
+{
+    const auto values = Quantize<uint8_t>(VertexQuantization::Unorm8, {0.0f, 1.0f, 0.5f, 0.2f, 0.6f, 0.0f}, 3);
+    const std::vector<uint8_t> expected{0, 255, 128, 0, 51, 153, 0, 0};
+    CHECK(values == expected);
+}
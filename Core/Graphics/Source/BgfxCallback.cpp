@@ -1,4 +1,5 @@
 #include "BgfxCallback.h"
+#include "PixelSwizzle.h"
 #include <bx/bx.h>
 #include <bx/string.h>
 #include <bx/platform.h>
@@ -10,10 +11,16 @@
 
 namespace Babylon
 {
-    void BgfxCallback::addScreenShotCallback(Napi::Function callback)
+    namespace
+    {
+        // Screenshots are usually taken one at a time, a couple of buffers cover one being delivered while the next is taken.
+        constexpr size_t MaxScreenShotBuffers{2};
+    }
+
+    void BgfxCallback::addScreenShotCallback(JsRuntime& runtime, ScreenShotCallback callback)
     {
         std::scoped_lock lock{ m_ssCallbackAccess };
-        m_screenshotCallbacks.push(Napi::Persistent(callback));
+        m_screenshotCallbacks.push({&runtime, std::move(callback)});
     }
 
     void BgfxCallback::trace(const char* _filePath, uint16_t _line, const char* _format, ...)
@@ -87,30 +94,42 @@ namespace Babylon
 
     void BgfxCallback::screenShot(const char* /*filePath*/, uint32_t width, uint32_t height, uint32_t pitch, const void* data, uint32_t /*size*/, bool yflip)
     {
-        assert(m_screenshotCallbacks.size()); // addScreenShotCallback not called before doing the screenshot call on bgfx
-        auto env = m_screenshotCallbacks.front().Env();
-        auto array = Napi::Uint8Array::New(env, height * pitch);
-        auto bitmap = static_cast<uint8_t*>(array.Data());
-
-        for (uint32_t py = 0; py < height; py++)
+        ScreenShotRequest request{};
+        std::vector<uint8_t> pixels{};
         {
-            const uint8_t* ptr = static_cast<const uint8_t*>(data) + (yflip ? (height - py - 1) : py) * pitch;
-            for (uint32_t px = 0; px < width; px++)
+            std::scoped_lock lock{ m_ssCallbackAccess };
+            assert(m_screenshotCallbacks.size()); // addScreenShotCallback not called before doing the screenshot call on bgfx
+            request = std::move(m_screenshotCallbacks.front());
+            m_screenshotCallbacks.pop();
+
+            if (!m_screenshotBuffers.empty())
             {
-                // bgfx screenshot is BGRA
-                *bitmap++ = ptr[px * 4 + 2];
-                *bitmap++ = ptr[px * 4 + 1];
-                *bitmap++ = ptr[px * 4 + 0];
-                *bitmap++ = ptr[px * 4 + 3];
+                pixels = std::move(m_screenshotBuffers.back());
+                m_screenshotBuffers.pop_back();
             }
         }
 
-        JsRuntime& runtime{ JsRuntime::GetFromJavaScript(env) };
+        // bgfx screenshot is BGRA, with rows padded to the pitch. The buffer only grows, so that one of the size of the
+        // back buffer is reused.
+        const size_t rowSize = static_cast<size_t>(width) * 4;
+        if (pixels.size() < rowSize * height)
+        {
+            pixels.resize(rowSize * height);
+        }
+        for (uint32_t py = 0; py < height; py++)
+        {
+            const uint8_t* row = static_cast<const uint8_t*>(data) + (yflip ? (height - py - 1) : py) * pitch;
+            SwizzleBgraToRgba(row, pixels.data() + py * rowSize, width);
+        }
+
+        request.Runtime->Dispatch([this, callback = std::move(request.Callback), pixels = std::move(pixels), width, height](Napi::Env) mutable {
+            callback(pixels.data(), width, height);
 
-        runtime.Dispatch([this, array = std::move(array)](Napi::Env) {
             std::scoped_lock lock{ m_ssCallbackAccess };
-            m_screenshotCallbacks.front().Call({ array });
-            m_screenshotCallbacks.pop();
+            if (m_screenshotBuffers.size() < MaxScreenShotBuffers)
+            {
+                m_screenshotBuffers.push_back(std::move(pixels));
+            }
         });
     }
 
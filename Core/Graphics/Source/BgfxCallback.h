@@ -2,6 +2,7 @@
 
 #include <vector>
 #include <mutex>
+#include <functional>
 #include <bgfx/bgfx.h>
 #include <bgfx/platform.h>
 #include <napi/napi.h>
@@ -9,11 +10,17 @@
 
 namespace Babylon
 {
+    class JsRuntime;
+
     struct BgfxCallback : public bgfx::CallbackI
     {
         virtual ~BgfxCallback() = default;
 
-        void addScreenShotCallback(Napi::Function callback);
+        // Called on the JavaScript thread with the RGBA8 pixels of the back buffer, top row first. The pixels are only
+        // valid during the call.
+        using ScreenShotCallback = std::function<void(const uint8_t* pixels, uint32_t width, uint32_t height)>;
+
+        void addScreenShotCallback(JsRuntime& runtime, ScreenShotCallback callback);
 
     protected:
         void fatal(const char* filePath, uint16_t line, bgfx::Fatal::Enum code, const char* str) override;
@@ -30,7 +37,16 @@ namespace Babylon
         void captureFrame(const void* _data, uint32_t _size) override;
         void trace(const char* _filePath, uint16_t _line, const char* _format, ...);
 
+        struct ScreenShotRequest
+        {
+            JsRuntime* Runtime;
+            ScreenShotCallback Callback;
+        };
+
         std::mutex m_ssCallbackAccess;
-        std::queue<Napi::FunctionReference> m_screenshotCallbacks;
+        std::queue<ScreenShotRequest> m_screenshotCallbacks;
+
+        // Pixels converted for the screenshots being delivered, and the buffers kept for the next ones.
+        std::vector<std::vector<uint8_t>> m_screenshotBuffers;
     };
 }
\ No newline at end of file
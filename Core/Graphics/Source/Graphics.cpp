@@ -82,6 +82,18 @@ namespace Babylon
         return m_afterRenderTaskCompletionSource.as_task();
     }
 
+    uint32_t Graphics::Impl::GetResetCount()
+    {
+        std::scoped_lock lock{m_bgfxState.Mutex};
+        return m_bgfxState.ResetCount;
+    }
+
+    uint32_t Graphics::Impl::GetFrameNumber()
+    {
+        std::scoped_lock lock{m_bgfxState.Mutex};
+        return m_bgfxState.FrameNumber;
+    }
+
     void Graphics::Impl::StartRenderingCurrentFrame()
     {
         if (m_rendering)
@@ -111,10 +123,11 @@ namespace Babylon
                 bgfx::setPlatformData(m_bgfxState.InitState.platformData);
                 auto& res = m_bgfxState.InitState.resolution;
                 bgfx::reset(res.width, res.height, BGFX_RESET_FLAGS);
+                m_bgfxState.ResetCount++;
                 bgfx::setViewRect(0, 0, 0, static_cast<uint16_t>(res.width), static_cast<uint16_t>(res.height));
 
 #if __APPLE__
-                bgfx::frame();
+                m_bgfxState.FrameNumber = bgfx::frame();
 #else
                 bgfx::touch(0);
 #endif
@@ -153,7 +166,10 @@ namespace Babylon
                 }
             }
 
-            bgfx::frame();
+            const uint32_t frameNumber = bgfx::frame();
+
+            std::scoped_lock lock{m_bgfxState.Mutex};
+            m_bgfxState.FrameNumber = frameNumber;
         }
 
         auto oldRenderTaskCompletionSource = m_afterRenderTaskCompletionSource;
@@ -30,6 +30,12 @@ namespace Babylon
         arcana::task<void, std::exception_ptr> GetBeforeRenderTask();
         arcana::task<void, std::exception_ptr> GetAfterRenderTask();
 
+        // Number of times bgfx has been reset, which discards the view configuration it holds.
+        uint32_t GetResetCount();
+
+        // Number returned by the last call to bgfx::frame, which tells when the reads requested from bgfx complete.
+        uint32_t GetFrameNumber();
+
         void StartRenderingCurrentFrame();
         void FinishRenderingCurrentFrame();
 
@@ -51,6 +57,8 @@ namespace Babylon
             bgfx::Init InitState{};
             bool Initialized{};
             bool Dirty{};
+            uint32_t ResetCount{};
+            uint32_t FrameNumber{};
         } m_bgfxState{};
 
         arcana::task_completion_source<void, std::exception_ptr> m_beforeRenderTaskCompletionSource{};
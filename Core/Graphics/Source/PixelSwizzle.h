@@ -0,0 +1,46 @@
+#pragma once
+
+#include "Simd.h"
+
+#include <cstddef>
+#include <cstdint>
+
+namespace Babylon
+{
+    /// Converts BGRA8 pixels to RGBA8 by swapping their blue and red channels. The source and destination may be the
+    /// same.
+    inline void SwizzleBgraToRgba(const uint8_t* source, uint8_t* destination, size_t pixelCount)
+    {
+        size_t index = 0;
+
+#if defined(BABYLON_SIMD_SSE2)
+        // SSE2 has no byte shuffle, the channels are swapped within each 32-bit pixel instead, blue being its low byte.
+        const __m128i greenAlpha = _mm_set1_epi32(static_cast<int>(0xFF00FF00));
+        const __m128i lowByte = _mm_set1_epi32(0xFF);
+        for (; index + 4 <= pixelCount; index += 4)
+        {
+            const __m128i pixels = _mm_loadu_si128(reinterpret_cast<const __m128i*>(source + index * 4));
+            const __m128i red = _mm_and_si128(_mm_srli_epi32(pixels, 16), lowByte);
+            const __m128i blue = _mm_slli_epi32(_mm_and_si128(pixels, lowByte), 16);
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(destination + index * 4), _mm_or_si128(_mm_and_si128(pixels, greenAlpha), _mm_or_si128(red, blue)));
+        }
+#elif defined(BABYLON_SIMD_NEON)
+        for (; index + 16 <= pixelCount; index += 16)
+        {
+            const uint8x16x4_t pixels = vld4q_u8(source + index * 4);
+            const uint8x16x4_t swizzled{{pixels.val[2], pixels.val[1], pixels.val[0], pixels.val[3]}};
+            vst4q_u8(destination + index * 4, swizzled);
+        }
+#endif
+
+        for (; index < pixelCount; ++index)
+        {
+            const uint8_t blue = source[index * 4 + 0];
+            const uint8_t red = source[index * 4 + 2];
+            destination[index * 4 + 0] = red;
+            destination[index * 4 + 1] = source[index * 4 + 1];
+            destination[index * 4 + 2] = blue;
+            destination[index * 4 + 3] = source[index * 4 + 3];
+        }
+    }
+}
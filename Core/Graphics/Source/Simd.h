@@ -0,0 +1,15 @@
+#pragma once
+
+// Instruction sets used by the SIMD code paths of Graphics and NativeEngine. SSE2 is part of every x64 target,
+// and NEON of every AArch64 target; other targets use the scalar code paths.
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define BABYLON_SIMD_SSE2
+#if defined(__F16C__) || defined(__AVX2__)
+#include <immintrin.h>
+#define BABYLON_SIMD_F16C
+#endif
+#elif defined(__aarch64__) || defined(_M_ARM64)
+#include <arm_neon.h>
+#define BABYLON_SIMD_NEON
+#endif
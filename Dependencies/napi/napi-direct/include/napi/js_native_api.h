@@ -387,6 +387,9 @@ NAPI_EXTERN napi_status napi_get_arraybuffer_info(napi_env env,
                                                   napi_value arraybuffer,
                                                   void** data,
                                                   size_t* byte_length);
+// Only implemented with V8.
+NAPI_EXTERN napi_status napi_detach_arraybuffer(napi_env env,
+                                                napi_value arraybuffer);
 NAPI_EXTERN napi_status napi_is_typedarray(napi_env env,
                                            napi_value value,
                                            bool* result);
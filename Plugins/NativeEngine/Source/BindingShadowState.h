@@ -0,0 +1,101 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+namespace Babylon
+{
+    /// Remembers the textures, vertex streams and index buffer set on the bgfx encoder, so that binding again what
+    /// the encoder already holds can be skipped. Draws are submitted without discarding their bindings, so they
+    /// stay set until they are changed or the encoder state is discarded, at which point Reset must be called.
+    class BindingShadowState final
+    {
+    public:
+        /// Identifies a buffer whose binding cannot be compared, such as a transient buffer. It is always bound.
+        static constexpr uint32_t UncomparableBuffer{UINT32_MAX};
+
+        struct Statistics
+        {
+            uint64_t BindingsSubmitted{};
+            uint64_t BindingsElided{};
+        };
+
+        /// Returns true when the texture differs from the one set on the stage, in which case the binding is
+        /// recorded and must be set by the caller.
+        bool SetTexture(uint8_t stage, uint16_t sampler, uint16_t texture, uint32_t flags)
+        {
+            if (m_textures.size() <= stage)
+            {
+                m_textures.resize(stage + 1);
+            }
+
+            return Update(m_textures[stage], (static_cast<uint32_t>(sampler) << 16) | texture, flags, 0);
+        }
+
+        /// Returns true when the buffer, identified by a value unique among the live buffers, differs from the
+        /// one set on the stream, in which case the binding is recorded and must be set by the caller.
+        bool SetVertexBuffer(uint8_t stream, uint32_t buffer, uint32_t startVertex, uint16_t layout)
+        {
+            if (m_vertexBuffers.size() <= stream)
+            {
+                m_vertexBuffers.resize(stream + 1);
+            }
+
+            return Update(m_vertexBuffers[stream], buffer, startVertex, layout);
+        }
+
+        /// Returns true when the buffer or its range differs from the index buffer set, in which case the binding
+        /// is recorded and must be set by the caller.
+        bool SetIndexBuffer(uint32_t buffer, uint32_t firstIndex, uint32_t indexCount)
+        {
+            return Update(m_indexBuffer, buffer, firstIndex, indexCount);
+        }
+
+        /// Forgets the index buffer, once it is discarded from the encoder.
+        void DiscardIndexBuffer()
+        {
+            m_indexBuffer = {};
+        }
+
+        /// Forgets all the bindings. Must be called whenever the encoder state is discarded.
+        void Reset()
+        {
+            m_textures.clear();
+            m_vertexBuffers.clear();
+            m_indexBuffer = {};
+        }
+
+        const Statistics& GetStatistics() const
+        {
+            return m_statistics;
+        }
+
+    private:
+        struct Binding
+        {
+            uint32_t Resource{UncomparableBuffer};
+            uint32_t Offset{};
+            uint32_t Extra{};
+            bool Valid{false};
+        };
+
+        bool Update(Binding& binding, uint32_t resource, uint32_t offset, uint32_t extra)
+        {
+            if (binding.Valid && resource != UncomparableBuffer && binding.Resource == resource && binding.Offset == offset && binding.Extra == extra)
+            {
+                m_statistics.BindingsElided++;
+                return false;
+            }
+
+            // A binding that cannot be compared leaves the slot unknown for the next one.
+            binding = {resource, offset, extra, resource != UncomparableBuffer};
+            m_statistics.BindingsSubmitted++;
+            return true;
+        }
+
+        std::vector<Binding> m_textures{};
+        std::vector<Binding> m_vertexBuffers{};
+        Binding m_indexBuffer{};
+        Statistics m_statistics{};
+    };
+}
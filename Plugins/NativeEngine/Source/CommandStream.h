@@ -0,0 +1,230 @@
+#pragma once
+
+#include <gsl/gsl>
+
+#include <cstdint>
+#include <cstring>
+#include <stdexcept>
+#include <unordered_map>
+
+namespace Babylon
+{
+    /// Commands understood by NativeEngine::SubmitCommands. Each command is a sequence of
+    /// 32-bit words: the command type followed by its arguments, listed next to each value.
+    /// Native objects (vertex arrays, programs, uniforms, textures and frame buffers) are
+    /// encoded as the two words returned by getCommandHandle; variable length arrays are
+    /// encoded as an element count followed by the elements.
+    enum class CommandType : uint32_t
+    {
+        BindVertexArray,   // vertexArray
+        SetProgram,        // program
+        SetState,          // culling, reverseSide
+        SetDepthTest,      // depthTest
+        SetDepthWrite,     // enable
+        SetColorWrite,     // enable
+        SetBlendMode,      // blendMode (low word, high word)
+        SetInt,            // uniform, value
+        SetIntArray,       // uniform, count, values
+        SetIntArray2,      // uniform, count, values
+        SetIntArray3,      // uniform, count, values
+        SetIntArray4,      // uniform, count, values
+        SetFloatArray,     // uniform, count, values
+        SetFloatArray2,    // uniform, count, values
+        SetFloatArray3,    // uniform, count, values
+        SetFloatArray4,    // uniform, count, values
+        SetMatrices,       // uniform, count, values
+        SetMatrix3x3,      // uniform, 9 values
+        SetMatrix2x2,      // uniform, 4 values
+        SetMatrix,         // uniform, 16 values
+        SetFloat,          // uniform, x
+        SetFloat2,         // uniform, x, y
+        SetFloat3,         // uniform, x, y, z
+        SetFloat4,         // uniform, x, y, z, w
+        SetTexture,        // uniform, texture
+        BindFrameBuffer,   // frameBuffer
+        UnbindFrameBuffer, // frameBuffer
+        DrawIndexed,       // fillMode, elementStart, elementCount
+        Draw,              // fillMode, elementStart, elementCount
+        Clear,             // flags
+        ClearColor,        // r, g, b, a
+        ClearDepth,        // depth
+        ClearStencil,      // stencil
+        SetViewPort,       // x, y, width, height
+        DrawInstanced,     // fillMode, elementStart, elementCount, instanceCount
+    };
+
+    struct VertexArray;
+    struct ProgramData;
+    struct UniformInfo;
+    struct TextureData;
+    struct FrameBufferData;
+
+    /// The native objects command buffers may refer to. Objects are registered with their type when they are created
+    /// and unregistered when they are deleted, so that a handle read from a command buffer is checked instead of being
+    /// dereferenced blindly: a zeroed or stale handle, as found in a fresh or reused buffer, or the handle of an object
+    /// of another type than the command expects, throws rather than crashing.
+    class CommandHandleTable final
+    {
+    public:
+        template<typename T>
+        void Register(const T* object)
+        {
+            m_objects[object] = GetKind(object);
+        }
+
+        void Unregister(const void* object)
+        {
+            m_objects.erase(object);
+        }
+
+        void Clear()
+        {
+            m_objects.clear();
+        }
+
+        bool Contains(const void* object) const
+        {
+            return m_objects.find(object) != m_objects.end();
+        }
+
+        template<typename T>
+        T* Resolve(uint64_t handle) const
+        {
+            if (handle == 0)
+            {
+                throw std::runtime_error{"Command buffer refers to a null native object."};
+            }
+
+            const auto address = static_cast<uintptr_t>(handle);
+            const auto it = m_objects.find(reinterpret_cast<const void*>(address));
+            if (it == m_objects.end())
+            {
+                throw std::runtime_error{"Command buffer refers to a native object that was deleted or never registered."};
+            }
+            if (it->second != GetKind(static_cast<const T*>(nullptr)))
+            {
+                throw std::runtime_error{"Command buffer refers to a native object of another type than the command expects."};
+            }
+
+            return reinterpret_cast<T*>(address);
+        }
+
+    private:
+        enum class Kind : uint8_t
+        {
+            VertexArray,
+            Program,
+            Uniform,
+            Texture,
+            FrameBuffer,
+        };
+
+        static constexpr Kind GetKind(const VertexArray*)
+        {
+            return Kind::VertexArray;
+        }
+
+        static constexpr Kind GetKind(const ProgramData*)
+        {
+            return Kind::Program;
+        }
+
+        static constexpr Kind GetKind(const UniformInfo*)
+        {
+            return Kind::Uniform;
+        }
+
+        static constexpr Kind GetKind(const TextureData*)
+        {
+            return Kind::Texture;
+        }
+
+        static constexpr Kind GetKind(const FrameBufferData*)
+        {
+            return Kind::FrameBuffer;
+        }
+
+        std::unordered_map<const void*, Kind> m_objects{};
+    };
+
+    /// Sequential reader over a buffer of commands encoded by JavaScript. The reader does not
+    /// copy the buffer, so the buffer must outlive the reader.
+    class CommandStream final
+    {
+    public:
+        explicit CommandStream(gsl::span<const uint32_t> words)
+            : m_words{words}
+        {
+        }
+
+        bool HasMore() const
+        {
+            return m_position < static_cast<size_t>(m_words.size());
+        }
+
+        uint32_t ReadUint32()
+        {
+            EnsureAvailable(1);
+            return m_words.data()[m_position++];
+        }
+
+        int32_t ReadInt32()
+        {
+            return static_cast<int32_t>(ReadUint32());
+        }
+
+        uint64_t ReadUint64()
+        {
+            const uint64_t low = ReadUint32();
+            const uint64_t high = ReadUint32();
+            return low | (high << 32);
+        }
+
+        float ReadFloat()
+        {
+            const uint32_t bits = ReadUint32();
+            float value;
+            std::memcpy(&value, &bits, sizeof(value));
+            return value;
+        }
+
+        bool ReadBoolean()
+        {
+            return ReadUint32() != 0;
+        }
+
+        template<typename T>
+        T* ReadPointer(const CommandHandleTable& handles)
+        {
+            return handles.Resolve<T>(ReadUint64());
+        }
+
+        template<typename T>
+        gsl::span<const T> ReadSpan(size_t count)
+        {
+            static_assert(sizeof(T) == sizeof(uint32_t));
+            EnsureAvailable(count);
+            const auto* data = reinterpret_cast<const T*>(m_words.data() + m_position);
+            m_position += count;
+            return gsl::make_span(data, count);
+        }
+
+        template<typename T>
+        gsl::span<const T> ReadSpan()
+        {
+            return ReadSpan<T>(ReadUint32());
+        }
+
+    private:
+        void EnsureAvailable(size_t count) const
+        {
+            if (count > static_cast<size_t>(m_words.size()) - m_position)
+            {
+                throw std::runtime_error{"Command stream ended in the middle of a command."};
+            }
+        }
+
+        gsl::span<const uint32_t> m_words{};
+        size_t m_position{0};
+    };
+}
@@ -0,0 +1,227 @@
+#pragma once
+
+#include "MipGeneration.h"
+
+#include <bimg/bimg.h>
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+#include <vector>
+
+namespace Babylon
+{
+    /// The upload block of a cube texture, which the decoding tasks of the faces write into directly, at the offsets
+    /// bgfx expects: each face in turn, with its mips. The block is allocated when the first level of a face is
+    /// decoded, since its size depends on the dimensions and format of the decoded faces. Thread safe.
+    class CubeTextureAssembly final
+    {
+    public:
+        /// loadedMips is the number of levels loaded separately for each face. When generateMips is set, each face is
+        /// loaded as a single level and the rest of its mip chain is generated in place with the given filter.
+        CubeTextureAssembly(uint8_t loadedMips, bool generateMips, MipFilter filter = MipFilter::Box)
+            : m_loadedMips{loadedMips}
+            , m_generateMips{generateMips}
+            , m_filter{filter}
+        {
+        }
+
+        CubeTextureAssembly(const CubeTextureAssembly&) = delete;
+        CubeTextureAssembly& operator=(const CubeTextureAssembly&) = delete;
+
+        /// Copies the first level of a face to its place in the block. When generating mips, the image may already
+        /// hold its mip chain, otherwise it must be an image the mips can be generated natively for.
+        void Place(const bimg::ImageContainer& image, uint32_t face)
+        {
+            std::vector<PendingImage> pending{};
+            {
+                std::scoped_lock lock{m_mutex};
+                if (m_data == nullptr)
+                {
+                    Allocate(image);
+                    pending = std::move(m_pending);
+                }
+            }
+
+            // The faces and levels write to distinct ranges of the block, without locking.
+            Write(image, face, 0);
+            for (const auto& level : pending)
+            {
+                Write(*level.Image, level.Face, level.Mip);
+            }
+        }
+
+        /// Copies a decoded level of a face to its place in the block and frees the image. Levels other than the first
+        /// one are kept until the first level of a face is placed.
+        void Place(bimg::ImageContainer* image, uint32_t face, uint8_t mip)
+        {
+            ImagePtr owned{image, &bimg::imageFree};
+            if (image == nullptr)
+            {
+                throw std::runtime_error{"Unable to decode cube texture face."};
+            }
+
+            if (mip != 0)
+            {
+                std::scoped_lock lock{m_mutex};
+                if (m_data == nullptr)
+                {
+                    m_pending.push_back({std::move(owned), face, mip});
+                    return;
+                }
+            }
+
+            if (mip == 0)
+            {
+                Place(*image, face);
+            }
+            else
+            {
+                Write(*image, face, mip);
+            }
+        }
+
+        /// Returns an image over the levels of a face in the block, once the face is placed.
+        bimg::ImageContainer GetFace(uint32_t face) const
+        {
+            bimg::ImageContainer image{};
+            image.m_data = m_data.get() + static_cast<size_t>(face) * m_faceSize;
+            image.m_size = m_faceSize;
+            image.m_format = m_format;
+            image.m_width = m_width;
+            image.m_height = m_height;
+            image.m_depth = 1;
+            image.m_numLayers = 1;
+            image.m_numMips = static_cast<uint8_t>(m_mipOffsets.size() - 1);
+            return image;
+        }
+
+        bimg::TextureFormat::Enum GetFormat() const
+        {
+            return m_format;
+        }
+
+        uint32_t GetWidth() const
+        {
+            return m_width;
+        }
+
+        uint32_t GetHeight() const
+        {
+            return m_height;
+        }
+
+        bool HasMips() const
+        {
+            return m_mipOffsets.size() > 2;
+        }
+
+        const uint8_t* GetData() const
+        {
+            return m_data.get();
+        }
+
+        uint32_t GetDataSize() const
+        {
+            return m_faceSize * 6;
+        }
+
+    private:
+        using ImagePtr = std::unique_ptr<bimg::ImageContainer, decltype(&bimg::imageFree)>;
+
+        struct PendingImage
+        {
+            ImagePtr Image;
+            uint32_t Face;
+            uint8_t Mip;
+        };
+
+        static uint32_t GetMipDimension(uint32_t dimension, uint32_t mip)
+        {
+            return std::max(dimension >> mip, 1u);
+        }
+
+        void Allocate(const bimg::ImageContainer& image)
+        {
+            m_format = image.m_format;
+            m_width = image.m_width;
+            m_height = image.m_height;
+
+            uint32_t numMips = m_loadedMips;
+            if (m_generateMips)
+            {
+                numMips = 1;
+                for (uint32_t size = std::max(m_width, m_height); size > 1; size >>= 1)
+                {
+                    ++numMips;
+                }
+            }
+
+            for (uint32_t mip = 0; mip < numMips; ++mip)
+            {
+                m_mipOffsets.push_back(m_faceSize);
+                m_faceSize += bimg::imageGetSize(nullptr, static_cast<uint16_t>(GetMipDimension(m_width, mip)), static_cast<uint16_t>(GetMipDimension(m_height, mip)), 1, false, false, 1, m_format);
+            }
+            m_mipOffsets.push_back(m_faceSize);
+
+            // Not value-initialized: every byte is written by the faces.
+            m_data.reset(new uint8_t[static_cast<size_t>(m_faceSize) * 6]);
+        }
+
+        void Write(const bimg::ImageContainer& image, uint32_t face, uint8_t mip)
+        {
+            const uint32_t numMips = static_cast<uint32_t>(m_mipOffsets.size() - 1);
+            if (image.m_format != m_format || image.m_width != GetMipDimension(m_width, mip) || image.m_height != GetMipDimension(m_height, mip) || mip >= numMips)
+            {
+                throw std::runtime_error{"The faces of the cube texture do not match."};
+            }
+
+            uint8_t* faceData = m_data.get() + static_cast<size_t>(face) * m_faceSize;
+
+            // Only the generated chains are written past the level of the image.
+            const uint32_t copiedMips = m_generateMips ? std::min<uint32_t>(image.m_numMips, numMips) : 1;
+            for (uint32_t level = 0; level < copiedMips; ++level)
+            {
+                bimg::ImageMip source{};
+                bimg::imageGetRawData(image, 0, static_cast<uint8_t>(level), image.m_data, image.m_size, source);
+
+                const uint32_t offset = m_mipOffsets[mip + level];
+                if (source.m_size != m_mipOffsets[mip + level + 1] - offset)
+                {
+                    throw std::runtime_error{"The faces of the cube texture do not match."};
+                }
+                std::memcpy(faceData + offset, source.m_data, source.m_size);
+            }
+
+            if (m_generateMips && copiedMips < numMips)
+            {
+                if (!CanGenerateMipChain(image))
+                {
+                    throw std::runtime_error{"Unable to generate the mips of the cube texture face."};
+                }
+
+                // Generated in place, cube faces are filtered as is.
+                bimg::ImageContainer faceImage = GetFace(face);
+                GenerateMipLevels(faceImage, static_cast<uint8_t>(copiedMips), m_filter, false);
+            }
+        }
+
+        const uint8_t m_loadedMips;
+        const bool m_generateMips;
+        const MipFilter m_filter;
+
+        // Set with the first level, never modified afterward.
+        bimg::TextureFormat::Enum m_format{bimg::TextureFormat::Unknown};
+        uint32_t m_width{};
+        uint32_t m_height{};
+        uint32_t m_faceSize{};
+        std::vector<uint32_t> m_mipOffsets{};
+        std::unique_ptr<uint8_t[]> m_data{};
+
+        std::mutex m_mutex{};
+        std::vector<PendingImage> m_pending{};
+    };
+}
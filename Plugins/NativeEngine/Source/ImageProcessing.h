@@ -0,0 +1,265 @@
+#pragma once
+
+#include "MipGeneration.h"
+
+#include <Simd.h>
+
+#include <bimg/bimg.h>
+#include <bx/allocator.h>
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <functional>
+#include <stdexcept>
+
+namespace Babylon
+{
+    /// Operations applied to a decoded image before it is uploaded.
+    struct ImageProcessingOptions
+    {
+        bool FlipY{};
+        bool PremultiplyAlpha{};
+        bool NarrowTo8Bits{};
+        bool GenerateMips{};
+        MipFilter Filter{MipFilter::Box};
+        bool Srgb{};
+    };
+
+    namespace ImageProcessingDetail
+    {
+        // Rounds value * alpha / 255 exactly, for products of two bytes.
+        inline uint8_t MultiplyBytes(uint32_t value, uint32_t alpha)
+        {
+            const uint32_t product = value * alpha + 128;
+            return static_cast<uint8_t>((product + (product >> 8)) >> 8);
+        }
+
+        inline void PremultiplyRow(uint8_t* row, uint32_t width)
+        {
+            uint32_t x = 0;
+#if defined(BABYLON_SIMD_SSE2)
+            const __m128i zero = _mm_setzero_si128();
+            const __m128i bias = _mm_set1_epi16(128);
+            const __m128i alphaMask = _mm_set1_epi32(static_cast<int32_t>(0xFF000000));
+            for (; x + 4 <= width; x += 4)
+            {
+                const __m128i texels = _mm_loadu_si128(reinterpret_cast<const __m128i*>(row + x * 4));
+                __m128i halves[2]{_mm_unpacklo_epi8(texels, zero), _mm_unpackhi_epi8(texels, zero)};
+                for (auto& half : halves)
+                {
+                    const __m128i alpha = _mm_shufflehi_epi16(_mm_shufflelo_epi16(half, _MM_SHUFFLE(3, 3, 3, 3)), _MM_SHUFFLE(3, 3, 3, 3));
+                    const __m128i product = _mm_add_epi16(_mm_mullo_epi16(half, alpha), bias);
+                    half = _mm_srli_epi16(_mm_add_epi16(product, _mm_srli_epi16(product, 8)), 8);
+                }
+                const __m128i premultiplied = _mm_packus_epi16(halves[0], halves[1]);
+                const __m128i result = _mm_or_si128(_mm_andnot_si128(alphaMask, premultiplied), _mm_and_si128(alphaMask, texels));
+                _mm_storeu_si128(reinterpret_cast<__m128i*>(row + x * 4), result);
+            }
+#elif defined(BABYLON_SIMD_NEON)
+            for (; x + 16 <= width; x += 16)
+            {
+                uint8x16x4_t texels = vld4q_u8(row + x * 4);
+                for (size_t channel = 0; channel < 3; ++channel)
+                {
+                    const uint16x8_t low = vmull_u8(vget_low_u8(texels.val[channel]), vget_low_u8(texels.val[3]));
+                    const uint16x8_t high = vmull_u8(vget_high_u8(texels.val[channel]), vget_high_u8(texels.val[3]));
+                    texels.val[channel] = vcombine_u8(vrshrn_n_u16(vrsraq_n_u16(low, low, 8), 8), vrshrn_n_u16(vrsraq_n_u16(high, high, 8), 8));
+                }
+                vst4q_u8(row + x * 4, texels);
+            }
+#endif
+            for (; x < width; ++x)
+            {
+                uint8_t* texel = row + x * 4;
+                for (size_t channel = 0; channel < 3; ++channel)
+                {
+                    texel[channel] = MultiplyBytes(texel[channel], texel[3]);
+                }
+            }
+        }
+
+        // Converts 16-bit channels to 8-bit channels, rounding to the nearest value.
+        inline void NarrowRow(const uint8_t* source, uint8_t* destination, uint32_t valueCount)
+        {
+            for (uint32_t index = 0; index < valueCount; ++index)
+            {
+                uint16_t value;
+                std::memcpy(&value, source + index * 2, sizeof(value));
+                destination[index] = static_cast<uint8_t>((value * 255u + 32767u) / 65535u);
+            }
+        }
+
+        inline void RunRows(uint32_t count, uint32_t chunkSize, uint32_t texelCount, const std::function<void(uint32_t, uint32_t)>& work)
+        {
+            if (texelCount >= MipGenerationDetail::ParallelTexelCount)
+            {
+                MipGenerationDetail::ParallelFor(count, chunkSize, work);
+            }
+            else
+            {
+                work(0, count);
+            }
+        }
+    }
+
+    /// Flips, premultiplies, narrows and generates the mips of a decoded 2D image with 8-bit channels, or RGBA16 when
+    /// narrowing to 8 bits, in a single pass over bands of rows: each band is written to the upload buffer and reduced
+    /// to the first mip level while its rows are still in the cache. Returns false, leaving the image unchanged, for
+    /// images it does not support.
+    inline bool ProcessImage(bx::AllocatorI* allocator, bimg::ImageContainer** image, const ImageProcessingOptions& options)
+    {
+        using namespace ImageProcessingDetail;
+
+        bimg::ImageContainer* input = *image;
+        if (input->m_depth != 1 || input->m_numLayers != 1 || input->m_cubeMap || input->m_numMips != 1)
+        {
+            return false;
+        }
+
+        const bool narrow = options.NarrowTo8Bits && input->m_format == bimg::TextureFormat::RGBA16;
+        const bimg::TextureFormat::Enum format = narrow ? bimg::TextureFormat::RGBA8 : input->m_format;
+        const uint32_t channels = MipGenerationDetail::GetChannelCount(format);
+        if (channels == 0)
+        {
+            return false;
+        }
+
+        const uint32_t width = input->m_width;
+        const uint32_t height = input->m_height;
+        const size_t rowSize = static_cast<size_t>(width) * channels;
+        // The formats with fewer than four channels have no alpha, premultiplying leaves them unchanged.
+        const bool premultiply = options.PremultiplyAlpha && channels == 4;
+        uint8_t* inputData = static_cast<uint8_t*>(input->m_data);
+
+        if (!narrow && !options.GenerateMips)
+        {
+            // Nothing to allocate: the rows are swapped and premultiplied in place, a pair of rows at a time.
+            if (!options.FlipY && !premultiply)
+            {
+                return true;
+            }
+
+            const std::function<void(uint32_t, uint32_t)> work = [&](uint32_t firstPair, uint32_t endPair) {
+                for (uint32_t top = firstPair; top < endPair; ++top)
+                {
+                    const uint32_t bottom = height - 1 - top;
+                    uint8_t* topRow = inputData + top * rowSize;
+                    uint8_t* bottomRow = inputData + bottom * rowSize;
+                    if (options.FlipY && top != bottom)
+                    {
+                        std::swap_ranges(topRow, topRow + rowSize, bottomRow);
+                    }
+                    if (premultiply)
+                    {
+                        PremultiplyRow(topRow, width);
+                        if (top != bottom)
+                        {
+                            PremultiplyRow(bottomRow, width);
+                        }
+                    }
+                }
+            };
+            RunRows((height + 1) / 2, MipGenerationDetail::RowsPerChunk, width * height, work);
+            return true;
+        }
+
+        bimg::ImageContainer* output = bimg::imageAlloc(allocator, format, static_cast<uint16_t>(width), static_cast<uint16_t>(height), 1, 1, false, options.GenerateMips);
+        uint8_t* outputData = static_cast<uint8_t*>(output->m_data);
+
+        // The first mip level only depends on rows of its band with the box filter, the wider Kaiser filter reads
+        // rows of neighboring bands and waits for the whole level.
+        const bool fuseFirstMip = output->m_numMips > 1 && options.Filter == MipFilter::Box;
+        bimg::ImageMip firstMip{};
+        if (fuseFirstMip)
+        {
+            bimg::imageGetRawData(*output, 0, 1, output->m_data, output->m_size, firstMip);
+        }
+        const MipGenerationDetail::Level level0{outputData, width, height};
+        const MipGenerationDetail::Level level1{const_cast<uint8_t*>(firstMip.m_data), firstMip.m_width, firstMip.m_height};
+
+        const uint32_t bandHeight = MipGenerationDetail::RowsPerChunk;
+        const std::function<void(uint32_t, uint32_t)> work = [&](uint32_t firstBand, uint32_t endBand) {
+            for (uint32_t band = firstBand; band < endBand; ++band)
+            {
+                const uint32_t firstRow = band * bandHeight;
+                const uint32_t endRow = std::min(firstRow + bandHeight, height);
+                for (uint32_t y = firstRow; y < endRow; ++y)
+                {
+                    const uint32_t sourceY = options.FlipY ? height - 1 - y : y;
+                    uint8_t* row = outputData + y * rowSize;
+                    if (narrow)
+                    {
+                        NarrowRow(inputData + sourceY * rowSize * 2, row, static_cast<uint32_t>(rowSize));
+                    }
+                    else
+                    {
+                        std::memcpy(row, inputData + sourceY * rowSize, rowSize);
+                    }
+                    if (premultiply)
+                    {
+                        PremultiplyRow(row, width);
+                    }
+                }
+
+                if (fuseFirstMip)
+                {
+                    const uint32_t endMipRow = std::min((endRow + 1) / 2, level1.Height);
+                    MipGenerationDetail::DownsampleRows(level0, level1, channels, options.Srgb, options.Filter, firstRow / 2, endMipRow);
+                }
+            }
+        };
+        RunRows((height + bandHeight - 1) / bandHeight, 1, width * height, work);
+
+        if (output->m_numMips > 1)
+        {
+            GenerateMipLevels(*output, fuseFirstMip ? 2 : 1, options.Filter, options.Srgb);
+        }
+
+        bimg::imageFree(input);
+        *image = output;
+        return true;
+    }
+
+    /// Premultiplies the color of every texel of an image by its alpha, for the images ProcessImage does not support:
+    /// every mip, layer and face is premultiplied. Formats other than 8-bit RGBA and BGRA go through RGBA32F and back.
+    /// Throws for block compressed formats, and for formats bimg cannot convert back.
+    inline void PremultiplyAlpha(bx::AllocatorI* allocator, bimg::ImageContainer** image)
+    {
+        bimg::ImageContainer* input = *image;
+        if (bimg::isCompressed(input->m_format))
+        {
+            throw std::runtime_error{"Alpha cannot be premultiplied for compressed images."};
+        }
+
+        if (bimg::getBlockInfo(input->m_format).aBits == 0)
+        {
+            return;
+        }
+
+        if (input->m_format == bimg::TextureFormat::RGBA8 || input->m_format == bimg::TextureFormat::BGRA8)
+        {
+            ImageProcessingDetail::PremultiplyRow(static_cast<uint8_t*>(input->m_data), input->m_size / 4);
+            return;
+        }
+
+        if (!bimg::imageConvert(bimg::TextureFormat::RGBA32F, input->m_format) || !bimg::imageConvert(input->m_format, bimg::TextureFormat::RGBA32F))
+        {
+            throw std::runtime_error{"Alpha cannot be premultiplied for the format of the image."};
+        }
+
+        bimg::ImageContainer* rgba = bimg::imageConvert(allocator, bimg::TextureFormat::RGBA32F, *input, true);
+        float* texels = static_cast<float*>(rgba->m_data);
+        for (uint32_t index = 0; index < rgba->m_size / sizeof(float); index += 4)
+        {
+            texels[index + 0] *= texels[index + 3];
+            texels[index + 1] *= texels[index + 3];
+            texels[index + 2] *= texels[index + 3];
+        }
+
+        bimg::ImageContainer* output = bimg::imageConvert(allocator, input->m_format, *rgba, true);
+        bimg::imageFree(rgba);
+        bimg::imageFree(input);
+        *image = output;
+    }
+}
@@ -0,0 +1,90 @@
+#pragma once
+
+#include <Simd.h>
+
+#include <cstddef>
+#include <cstdint>
+
+namespace Babylon
+{
+    /// Returns true when every index is below 65535. 65535 is the primitive restart value of 16-bit
+    /// indices, so it must not appear in narrowed indices even though it fits in 16 bits. An index
+    /// is below 65536 when its high 16 bits are clear, so the bitwise or of all the indices is checked
+    /// rather than their maximum, which sidesteps the lack of unsigned 32-bit max instructions in SSE2.
+    inline bool IndicesFitIn16Bits(const uint32_t* indices, size_t count)
+    {
+        constexpr uint32_t restartIndex{0xFFFF};
+
+        size_t index = 0;
+        uint32_t bits = 0;
+        bool hasRestartIndex = false;
+
+#if defined(BABYLON_SIMD_SSE2)
+        const __m128i restart = _mm_set1_epi32(static_cast<int>(restartIndex));
+        __m128i accumulator = _mm_setzero_si128();
+        __m128i restartFound = _mm_setzero_si128();
+        for (; index + 4 <= count; index += 4)
+        {
+            const __m128i value = _mm_loadu_si128(reinterpret_cast<const __m128i*>(indices + index));
+            accumulator = _mm_or_si128(accumulator, value);
+            restartFound = _mm_or_si128(restartFound, _mm_cmpeq_epi32(value, restart));
+        }
+        accumulator = _mm_or_si128(accumulator, _mm_srli_si128(accumulator, 8));
+        accumulator = _mm_or_si128(accumulator, _mm_srli_si128(accumulator, 4));
+        bits = static_cast<uint32_t>(_mm_cvtsi128_si32(accumulator));
+        hasRestartIndex = _mm_movemask_epi8(restartFound) != 0;
+#elif defined(BABYLON_SIMD_NEON)
+        const uint32x4_t restart = vdupq_n_u32(restartIndex);
+        uint32x4_t accumulator = vdupq_n_u32(0);
+        uint32x4_t restartFound = vdupq_n_u32(0);
+        for (; index + 4 <= count; index += 4)
+        {
+            const uint32x4_t value = vld1q_u32(indices + index);
+            accumulator = vorrq_u32(accumulator, value);
+            restartFound = vorrq_u32(restartFound, vceqq_u32(value, restart));
+        }
+        const uint32x2_t half = vorr_u32(vget_low_u32(accumulator), vget_high_u32(accumulator));
+        bits = vget_lane_u32(half, 0) | vget_lane_u32(half, 1);
+        const uint32x2_t restartHalf = vorr_u32(vget_low_u32(restartFound), vget_high_u32(restartFound));
+        hasRestartIndex = (vget_lane_u32(restartHalf, 0) | vget_lane_u32(restartHalf, 1)) != 0;
+#endif
+
+        for (; index < count; ++index)
+        {
+            bits |= indices[index];
+            hasRestartIndex = hasRestartIndex || indices[index] == restartIndex;
+        }
+
+        return (bits & 0xFFFF0000) == 0 && !hasRestartIndex;
+    }
+
+    /// Converts indices that fit in 16 bits (see IndicesFitIn16Bits) to 16-bit indices.
+    inline void NarrowIndices(const uint32_t* indices, size_t count, uint16_t* narrowed)
+    {
+        size_t index = 0;
+
+#if defined(BABYLON_SIMD_SSE2)
+        for (; index + 8 <= count; index += 8)
+        {
+            // The indices are below 65536, so the signed saturation of SSE2 is avoided by biasing them.
+            const __m128i bias = _mm_set1_epi32(0x8000);
+            const __m128i low = _mm_sub_epi32(_mm_loadu_si128(reinterpret_cast<const __m128i*>(indices + index)), bias);
+            const __m128i high = _mm_sub_epi32(_mm_loadu_si128(reinterpret_cast<const __m128i*>(indices + index + 4)), bias);
+            const __m128i packed = _mm_add_epi16(_mm_packs_epi32(low, high), _mm_set1_epi16(-32768));
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(narrowed + index), packed);
+        }
+#elif defined(BABYLON_SIMD_NEON)
+        for (; index + 8 <= count; index += 8)
+        {
+            const uint16x4_t low = vmovn_u32(vld1q_u32(indices + index));
+            const uint16x4_t high = vmovn_u32(vld1q_u32(indices + index + 4));
+            vst1q_u16(narrowed + index, vcombine_u16(low, high));
+        }
+#endif
+
+        for (; index < count; ++index)
+        {
+            narrowed[index] = static_cast<uint16_t>(indices[index]);
+        }
+    }
+}
@@ -0,0 +1,333 @@
+#pragma once
+
+#include <gsl/gsl>
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstdint>
+#include <stdexcept>
+#include <vector>
+
+namespace Babylon
+{
+    /// Size of the post-transform vertex cache triangles are ordered for. Caches vary between GPUs, and an
+    /// ordering for a small FIFO cache also performs well with larger caches.
+    constexpr uint32_t IndexOptimizationCacheSize{16};
+
+    /// Largest vertex count indices can be optimized for, as the optimization allocates per vertex state.
+    constexpr uint64_t IndexOptimizationMaxVertexCount{1u << 24};
+
+    struct IndexOptimizationStatistics
+    {
+        // Average cache miss ratio: vertices transformed per triangle with a FIFO cache of IndexOptimizationCacheSize
+        // vertices. It ranges from 0.5 for an ideal ordering of a large mesh to 3.
+        double AcmrBefore{};
+        double AcmrAfter{};
+    };
+
+    namespace IndexOptimizationDetail
+    {
+        inline size_t CountCacheMisses(gsl::span<const uint32_t> indices, uint32_t vertexCount, uint32_t cacheSize)
+        {
+            // A vertex is in the cache when it was added less than cacheSize misses ago.
+            std::vector<size_t> cacheTimes(vertexCount, 0);
+            size_t time = cacheSize + 1;
+            size_t misses = 0;
+            for (const uint32_t index : indices)
+            {
+                if (time - cacheTimes[index] > cacheSize)
+                {
+                    cacheTimes[index] = time++;
+                    misses++;
+                }
+            }
+            return misses;
+        }
+
+        /// Reorders the triangles for the vertex cache with Tipsify (Sander, Nehab and Barczak, 2007): the triangles
+        /// around a fanning vertex are emitted together, and the next fanning vertex is picked among the vertices of
+        /// those triangles so that it is still in the cache. Returns the first triangle of each cluster, a cluster
+        /// starting where the ordering has to jump to an unrelated part of the mesh.
+        inline std::vector<size_t> Tipsify(gsl::span<uint32_t> indices, uint32_t vertexCount, uint32_t cacheSize)
+        {
+            const size_t triangleCount = static_cast<size_t>(indices.size()) / 3;
+
+            std::vector<uint32_t> liveTriangles(vertexCount, 0);
+            for (const uint32_t index : indices)
+            {
+                liveTriangles[index]++;
+            }
+
+            // Triangles around each vertex, in a single array.
+            std::vector<size_t> adjacencyOffsets(static_cast<size_t>(vertexCount) + 1, 0);
+            for (uint32_t vertex = 0; vertex < vertexCount; ++vertex)
+            {
+                adjacencyOffsets[vertex + 1] = adjacencyOffsets[vertex] + liveTriangles[vertex];
+            }
+
+            std::vector<uint32_t> adjacency(static_cast<size_t>(indices.size()));
+            {
+                std::vector<size_t> fill(adjacencyOffsets.begin(), adjacencyOffsets.end() - 1);
+                for (size_t corner = 0; corner < static_cast<size_t>(indices.size()); ++corner)
+                {
+                    adjacency[fill[indices[corner]]++] = static_cast<uint32_t>(corner / 3);
+                }
+            }
+
+            std::vector<size_t> cacheTimes(vertexCount, 0);
+            std::vector<bool> emitted(triangleCount, false);
+            std::vector<uint32_t> deadEnds{};
+            std::vector<uint32_t> candidates{};
+            std::vector<uint32_t> output{};
+            output.reserve(static_cast<size_t>(indices.size()));
+            std::vector<size_t> clusters{};
+
+            size_t time = cacheSize + 1;
+            uint32_t cursor = 0;
+            int64_t fanning = indices.empty() ? -1 : indices[0];
+            bool jumped = true;
+
+            while (fanning >= 0)
+            {
+                if (jumped)
+                {
+                    clusters.push_back(output.size() / 3);
+                    jumped = false;
+                }
+
+                candidates.clear();
+                const auto fanningVertex = static_cast<uint32_t>(fanning);
+                for (size_t adjacent = adjacencyOffsets[fanningVertex]; adjacent < adjacencyOffsets[fanningVertex + 1]; ++adjacent)
+                {
+                    const uint32_t triangle = adjacency[adjacent];
+                    if (emitted[triangle])
+                    {
+                        continue;
+                    }
+                    emitted[triangle] = true;
+
+                    for (size_t corner = 0; corner < 3; ++corner)
+                    {
+                        const uint32_t vertex = indices[static_cast<size_t>(triangle) * 3 + corner];
+                        output.push_back(vertex);
+                        deadEnds.push_back(vertex);
+                        candidates.push_back(vertex);
+                        liveTriangles[vertex]--;
+                        if (time - cacheTimes[vertex] > cacheSize)
+                        {
+                            cacheTimes[vertex] = time++;
+                        }
+                    }
+                }
+
+                // The oldest candidate that will still be in the cache once its remaining triangles are emitted.
+                fanning = -1;
+                int64_t bestPriority = -1;
+                for (const uint32_t candidate : candidates)
+                {
+                    if (liveTriangles[candidate] == 0)
+                    {
+                        continue;
+                    }
+
+                    int64_t priority = 0;
+                    const auto age = static_cast<int64_t>(time - cacheTimes[candidate]);
+                    if (age + 2 * static_cast<int64_t>(liveTriangles[candidate]) <= static_cast<int64_t>(cacheSize))
+                    {
+                        priority = age;
+                    }
+
+                    if (priority > bestPriority)
+                    {
+                        bestPriority = priority;
+                        fanning = candidate;
+                    }
+                }
+
+                if (fanning >= 0)
+                {
+                    continue;
+                }
+
+                // Dead end: go back to a recently used vertex with triangles left, or else to the next vertex in order.
+                jumped = true;
+                while (!deadEnds.empty() && fanning < 0)
+                {
+                    const uint32_t vertex = deadEnds.back();
+                    deadEnds.pop_back();
+                    if (liveTriangles[vertex] > 0)
+                    {
+                        fanning = vertex;
+                    }
+                }
+
+                for (; fanning < 0 && cursor < vertexCount; ++cursor)
+                {
+                    if (liveTriangles[cursor] > 0)
+                    {
+                        fanning = cursor;
+                    }
+                }
+            }
+
+            std::copy(output.begin(), output.end(), indices.begin());
+            return clusters;
+        }
+
+        /// Orders the clusters of triangles so that the ones facing away from the center of the mesh, which tend to
+        /// occlude the others, are drawn first (Sander, Nehab and Barczak, 2007). Positions are 3 floats per vertex.
+        inline void SortClustersForOverdraw(gsl::span<uint32_t> indices, const std::vector<size_t>& clusters, gsl::span<const float> positions)
+        {
+            using Vector3 = std::array<double, 3>;
+
+            const auto position = [positions](uint32_t vertex) {
+                const size_t offset = static_cast<size_t>(vertex) * 3;
+                return Vector3{positions[offset], positions[offset + 1], positions[offset + 2]};
+            };
+
+            const size_t triangleCount = static_cast<size_t>(indices.size()) / 3;
+
+            Vector3 meshCenter{};
+            for (const uint32_t index : indices)
+            {
+                const Vector3 p = position(index);
+                for (size_t axis = 0; axis < 3; ++axis)
+                {
+                    meshCenter[axis] += p[axis] / static_cast<double>(indices.size());
+                }
+            }
+
+            struct Cluster
+            {
+                size_t FirstTriangle{};
+                size_t TriangleCount{};
+                double Facing{};
+            };
+
+            std::vector<Cluster> sortedClusters(clusters.size());
+            for (size_t cluster = 0; cluster < clusters.size(); ++cluster)
+            {
+                const size_t firstTriangle = clusters[cluster];
+                const size_t endTriangle = cluster + 1 < clusters.size() ? clusters[cluster + 1] : triangleCount;
+
+                // Area weighted normal and center of the cluster.
+                Vector3 center{};
+                Vector3 normal{};
+                for (size_t triangle = firstTriangle; triangle < endTriangle; ++triangle)
+                {
+                    const Vector3 a = position(indices[triangle * 3]);
+                    const Vector3 b = position(indices[triangle * 3 + 1]);
+                    const Vector3 c = position(indices[triangle * 3 + 2]);
+                    const Vector3 ab{b[0] - a[0], b[1] - a[1], b[2] - a[2]};
+                    const Vector3 ac{c[0] - a[0], c[1] - a[1], c[2] - a[2]};
+                    normal[0] += ab[1] * ac[2] - ab[2] * ac[1];
+                    normal[1] += ab[2] * ac[0] - ab[0] * ac[2];
+                    normal[2] += ab[0] * ac[1] - ab[1] * ac[0];
+                    for (size_t axis = 0; axis < 3; ++axis)
+                    {
+                        center[axis] += (a[axis] + b[axis] + c[axis]) / (3.0 * static_cast<double>(endTriangle - firstTriangle));
+                    }
+                }
+
+                const double length = std::sqrt(normal[0] * normal[0] + normal[1] * normal[1] + normal[2] * normal[2]);
+                double facing = 0;
+                if (length > 0)
+                {
+                    for (size_t axis = 0; axis < 3; ++axis)
+                    {
+                        facing += (center[axis] - meshCenter[axis]) * normal[axis] / length;
+                    }
+                }
+
+                sortedClusters[cluster] = {firstTriangle, endTriangle - firstTriangle, facing};
+            }
+
+            std::stable_sort(sortedClusters.begin(), sortedClusters.end(), [](const Cluster& a, const Cluster& b) { return a.Facing > b.Facing; });
+
+            std::vector<uint32_t> output{};
+            output.reserve(static_cast<size_t>(indices.size()));
+            for (const Cluster& cluster : sortedClusters)
+            {
+                const auto first = indices.begin() + static_cast<std::ptrdiff_t>(cluster.FirstTriangle * 3);
+                output.insert(output.end(), first, first + static_cast<std::ptrdiff_t>(cluster.TriangleCount * 3));
+            }
+            std::copy(output.begin(), output.end(), indices.begin());
+        }
+    }
+
+    /// Reorders the triangles of triangle list indices for the post-transform vertex cache and, when vertex positions
+    /// (3 floats per vertex) are given, to reduce overdraw. Ranges are pairs of first index and index count, such as the
+    /// sub-meshes drawn from the indices; triangles are only moved within their range. When there are no ranges, all
+    /// the indices are reordered as a single range. Returns the ACMR of the ranges before and after reordering.
+    inline IndexOptimizationStatistics OptimizeIndices(gsl::span<uint32_t> indices, gsl::span<const uint32_t> ranges, gsl::span<const float> positions)
+    {
+        const std::array<uint32_t, 2> wholeRange{0, static_cast<uint32_t>(indices.size())};
+        if (ranges.empty())
+        {
+            ranges = wholeRange;
+        }
+
+        if (ranges.size() % 2 != 0)
+        {
+            throw std::runtime_error{"Index ranges must be pairs of first index and index count."};
+        }
+
+        size_t triangleCount = 0;
+        size_t missesBefore = 0;
+        size_t missesAfter = 0;
+        for (size_t range = 0; range < static_cast<size_t>(ranges.size()); range += 2)
+        {
+            const size_t first = ranges[range];
+            const size_t count = ranges[range + 1];
+            if (first > static_cast<size_t>(indices.size()) || count > static_cast<size_t>(indices.size()) - first || count % 3 != 0)
+            {
+                throw std::runtime_error{"Index range must be whole triangles within the indices."};
+            }
+
+            const auto rangeIndices = indices.subspan(static_cast<std::ptrdiff_t>(first), static_cast<std::ptrdiff_t>(count));
+            if (rangeIndices.empty())
+            {
+                continue;
+            }
+
+            // Computed in 64 bits, as the restart index 0xFFFFFFFF would wrap the count to 0.
+            const uint32_t maxIndex = *std::max_element(rangeIndices.begin(), rangeIndices.end());
+            if (maxIndex == UINT32_MAX)
+            {
+                throw std::runtime_error{"Primitive restart indices cannot be optimized."};
+            }
+
+            const uint64_t vertexCount64 = static_cast<uint64_t>(maxIndex) + 1;
+            if (vertexCount64 > IndexOptimizationMaxVertexCount)
+            {
+                throw std::runtime_error{"Indices reference too many vertices to be optimized."};
+            }
+
+            if (!positions.empty() && vertexCount64 * 3 > static_cast<uint64_t>(positions.size()))
+            {
+                throw std::runtime_error{"Indices reference vertices beyond the positions."};
+            }
+
+            const auto vertexCount = static_cast<uint32_t>(vertexCount64);
+
+            triangleCount += count / 3;
+            missesBefore += IndexOptimizationDetail::CountCacheMisses(rangeIndices, vertexCount, IndexOptimizationCacheSize);
+
+            const std::vector<size_t> clusters = IndexOptimizationDetail::Tipsify(rangeIndices, vertexCount, IndexOptimizationCacheSize);
+            if (!positions.empty())
+            {
+                IndexOptimizationDetail::SortClustersForOverdraw(rangeIndices, clusters, positions);
+            }
+
+            missesAfter += IndexOptimizationDetail::CountCacheMisses(rangeIndices, vertexCount, IndexOptimizationCacheSize);
+        }
+
+        if (triangleCount == 0)
+        {
+            return {};
+        }
+
+        return {static_cast<double>(missesBefore) / static_cast<double>(triangleCount), static_cast<double>(missesAfter) / static_cast<double>(triangleCount)};
+    }
+}
@@ -0,0 +1,422 @@
+#pragma once
+
+#include <Simd.h>
+
+#include <arcana/threading/task.h>
+#include <arcana/threading/task_schedulers.h>
+
+#include <bimg/bimg.h>
+#include <bx/allocator.h>
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <cmath>
+#include <condition_variable>
+#include <cstdint>
+#include <cstring>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+
+namespace Babylon
+{
+    /// Filter used to compute each mip level from the previous one.
+    enum class MipFilter : uint32_t
+    {
+        Box,    // Average of 2x2 texels, the fastest.
+        Kaiser, // Kaiser windowed sinc over 6x6 texels, sharper mips with less aliasing.
+    };
+
+    namespace MipGenerationDetail
+    {
+        // Levels with at least this many texels have their rows split across thread pool workers.
+        constexpr uint32_t ParallelTexelCount{256 * 256};
+        constexpr uint32_t RowsPerChunk{32};
+
+        struct ColorTables
+        {
+            // sRGB encoded byte to linear value.
+            std::array<float, 256> ToLinear{};
+
+            // Linear value, in steps of 1/4095, to sRGB encoded byte.
+            std::array<uint8_t, 4096> ToSrgb{};
+        };
+
+        inline const ColorTables& GetColorTables()
+        {
+            static const ColorTables tables = [] {
+                ColorTables result{};
+                for (size_t index = 0; index < result.ToLinear.size(); ++index)
+                {
+                    const float value = static_cast<float>(index) / 255.0f;
+                    result.ToLinear[index] = value <= 0.04045f ? value / 12.92f : std::pow((value + 0.055f) / 1.055f, 2.4f);
+                }
+                for (size_t index = 0; index < result.ToSrgb.size(); ++index)
+                {
+                    const float value = static_cast<float>(index) / 4095.0f;
+                    const float encoded = value <= 0.0031308f ? value * 12.92f : 1.055f * std::pow(value, 1.0f / 2.4f) - 0.055f;
+                    result.ToSrgb[index] = static_cast<uint8_t>(std::lround(encoded * 255.0f));
+                }
+                return result;
+            }();
+            return tables;
+        }
+
+        // Weights of the 6 source texels along each axis around an output texel: a sinc scaled to the output texels,
+        // windowed by a Kaiser window (alpha of 4) over 3 source texels on each side.
+        inline const std::array<float, 6>& GetKaiserWeights()
+        {
+            static const std::array<float, 6> weights = [] {
+                const auto besselI0 = [](double x) {
+                    double sum = 1.0;
+                    double term = 1.0;
+                    for (int k = 1; k < 20; ++k)
+                    {
+                        term *= (x / (2.0 * k)) * (x / (2.0 * k));
+                        sum += term;
+                    }
+                    return sum;
+                };
+
+                constexpr double pi = 3.14159265358979323846;
+                constexpr double alpha = 4.0;
+                constexpr double radius = 3.0;
+
+                std::array<double, 6> unnormalized{};
+                double total = 0.0;
+                for (size_t tap = 0; tap < unnormalized.size(); ++tap)
+                {
+                    const double distance = static_cast<double>(tap) - 2.5;
+                    const double t = pi * distance / 2.0;
+                    const double u = distance / radius;
+                    unnormalized[tap] = (std::sin(t) / t) * besselI0(alpha * std::sqrt(1.0 - u * u)) / besselI0(alpha);
+                    total += unnormalized[tap];
+                }
+
+                std::array<float, 6> result{};
+                for (size_t tap = 0; tap < result.size(); ++tap)
+                {
+                    result[tap] = static_cast<float>(unnormalized[tap] / total);
+                }
+                return result;
+            }();
+            return weights;
+        }
+
+#if defined(BABYLON_SIMD_SSE2)
+        using Float4 = __m128;
+
+        inline Float4 LoadFloat4(const float* values)
+        {
+            return _mm_loadu_ps(values);
+        }
+
+        inline Float4 MultiplyAdd(Float4 accumulator, Float4 values, float weight)
+        {
+            return _mm_add_ps(accumulator, _mm_mul_ps(values, _mm_set1_ps(weight)));
+        }
+
+        inline void StoreFloat4(float* destination, Float4 values)
+        {
+            _mm_storeu_ps(destination, values);
+        }
+#elif defined(BABYLON_SIMD_NEON)
+        using Float4 = float32x4_t;
+
+        inline Float4 LoadFloat4(const float* values)
+        {
+            return vld1q_f32(values);
+        }
+
+        inline Float4 MultiplyAdd(Float4 accumulator, Float4 values, float weight)
+        {
+            return vmlaq_n_f32(accumulator, values, weight);
+        }
+
+        inline void StoreFloat4(float* destination, Float4 values)
+        {
+            vst1q_f32(destination, values);
+        }
+#else
+        struct Float4
+        {
+            std::array<float, 4> Values;
+        };
+
+        inline Float4 LoadFloat4(const float* values)
+        {
+            return {{values[0], values[1], values[2], values[3]}};
+        }
+
+        inline Float4 MultiplyAdd(Float4 accumulator, Float4 values, float weight)
+        {
+            for (size_t lane = 0; lane < 4; ++lane)
+            {
+                accumulator.Values[lane] += values.Values[lane] * weight;
+            }
+            return accumulator;
+        }
+
+        inline void StoreFloat4(float* destination, Float4 values)
+        {
+            std::memcpy(destination, values.Values.data(), sizeof(float) * 4);
+        }
+#endif
+
+        struct Level
+        {
+            uint8_t* Data{};
+            uint32_t Width{};
+            uint32_t Height{};
+        };
+
+        // Averages 2x2 texels of 8-bit linear channels, two output texels at a time for 4 channel formats.
+        inline void BoxRow(const uint8_t* row0, const uint8_t* row1, uint32_t sourceWidth, uint8_t* output, uint32_t outputWidth, uint32_t channels)
+        {
+            uint32_t x = 0;
+#if defined(BABYLON_SIMD_SSE2)
+            if (channels == 4)
+            {
+                const __m128i zero = _mm_setzero_si128();
+                for (; 2 * x + 3 < sourceWidth && x + 1 < outputWidth; x += 2)
+                {
+                    const __m128i a = _mm_loadu_si128(reinterpret_cast<const __m128i*>(row0 + x * 8));
+                    const __m128i b = _mm_loadu_si128(reinterpret_cast<const __m128i*>(row1 + x * 8));
+                    const __m128i low = _mm_add_epi16(_mm_unpacklo_epi8(a, zero), _mm_unpacklo_epi8(b, zero));
+                    const __m128i high = _mm_add_epi16(_mm_unpackhi_epi8(a, zero), _mm_unpackhi_epi8(b, zero));
+                    const __m128i sums = _mm_unpacklo_epi64(_mm_add_epi16(low, _mm_srli_si128(low, 8)), _mm_add_epi16(high, _mm_srli_si128(high, 8)));
+                    const __m128i averages = _mm_srli_epi16(_mm_add_epi16(sums, _mm_set1_epi16(2)), 2);
+                    _mm_storel_epi64(reinterpret_cast<__m128i*>(output + x * 4), _mm_packus_epi16(averages, averages));
+                }
+            }
+#elif defined(BABYLON_SIMD_NEON)
+            if (channels == 4)
+            {
+                for (; 2 * x + 3 < sourceWidth && x + 1 < outputWidth; x += 2)
+                {
+                    const uint8x16_t a = vld1q_u8(row0 + x * 8);
+                    const uint8x16_t b = vld1q_u8(row1 + x * 8);
+                    const uint16x8_t low = vaddl_u8(vget_low_u8(a), vget_low_u8(b));
+                    const uint16x8_t high = vaddl_u8(vget_high_u8(a), vget_high_u8(b));
+                    const uint16x8_t sums = vcombine_u16(vadd_u16(vget_low_u16(low), vget_high_u16(low)), vadd_u16(vget_low_u16(high), vget_high_u16(high)));
+                    vst1_u8(output + x * 4, vrshrn_n_u16(sums, 2));
+                }
+            }
+#endif
+            for (; x < outputWidth; ++x)
+            {
+                const uint32_t column0 = 2 * x * channels;
+                const uint32_t column1 = std::min(2 * x + 1, sourceWidth - 1) * channels;
+                for (uint32_t channel = 0; channel < channels; ++channel)
+                {
+                    const uint32_t sum = row0[column0 + channel] + row0[column1 + channel] + row1[column0 + channel] + row1[column1 + channel];
+                    output[x * channels + channel] = static_cast<uint8_t>((sum + 2) / 4);
+                }
+            }
+        }
+
+        // Filters in linear space with 4 float lanes per texel, for sRGB color and for the Kaiser filter.
+        inline void FilteredRow(const Level& source, uint32_t y, uint8_t* output, uint32_t outputWidth, uint32_t channels, bool srgb, MipFilter filter)
+        {
+            static constexpr std::array<float, 2> boxWeights{0.5f, 0.5f};
+            const auto& tables = GetColorTables();
+            const bool kaiser = filter == MipFilter::Kaiser;
+            const float* weights = kaiser ? GetKaiserWeights().data() : boxWeights.data();
+            const int32_t tapCount = kaiser ? 6 : 2;
+            const int32_t firstTap = kaiser ? -2 : 0;
+
+            // The alpha channel, and formats without color channels, are always linear.
+            const uint32_t srgbChannels = srgb && channels >= 3 ? 3 : 0;
+
+            const auto clampCoordinate = [](int32_t coordinate, uint32_t size) {
+                return static_cast<uint32_t>(std::clamp<int32_t>(coordinate, 0, static_cast<int32_t>(size) - 1));
+            };
+
+            for (uint32_t x = 0; x < outputWidth; ++x)
+            {
+                const float zero[4]{};
+                Float4 accumulator = LoadFloat4(zero);
+                for (int32_t tapY = 0; tapY < tapCount; ++tapY)
+                {
+                    const uint32_t sourceY = clampCoordinate(static_cast<int32_t>(2 * y) + firstTap + tapY, source.Height);
+                    const uint8_t* row = source.Data + static_cast<size_t>(sourceY) * source.Width * channels;
+                    for (int32_t tapX = 0; tapX < tapCount; ++tapX)
+                    {
+                        const uint8_t* texel = row + static_cast<size_t>(clampCoordinate(static_cast<int32_t>(2 * x) + firstTap + tapX, source.Width)) * channels;
+
+                        float values[4]{};
+                        for (uint32_t channel = 0; channel < channels; ++channel)
+                        {
+                            values[channel] = channel < srgbChannels ? tables.ToLinear[texel[channel]] : texel[channel] / 255.0f;
+                        }
+                        accumulator = MultiplyAdd(accumulator, LoadFloat4(values), weights[tapY] * weights[tapX]);
+                    }
+                }
+
+                float values[4];
+                StoreFloat4(values, accumulator);
+                for (uint32_t channel = 0; channel < channels; ++channel)
+                {
+                    const float value = std::clamp(values[channel], 0.0f, 1.0f);
+                    output[x * channels + channel] = channel < srgbChannels
+                                                         ? tables.ToSrgb[static_cast<size_t>(std::lround(value * 4095.0f))]
+                                                         : static_cast<uint8_t>(std::lround(value * 255.0f));
+                }
+            }
+        }
+
+        inline void DownsampleRows(const Level& source, const Level& destination, uint32_t channels, bool srgb, MipFilter filter, uint32_t firstRow, uint32_t endRow)
+        {
+            const bool linearBox = filter == MipFilter::Box && (!srgb || channels < 3);
+            const size_t sourcePitch = static_cast<size_t>(source.Width) * channels;
+            const size_t destinationPitch = static_cast<size_t>(destination.Width) * channels;
+            for (uint32_t y = firstRow; y < endRow; ++y)
+            {
+                uint8_t* output = destination.Data + y * destinationPitch;
+                if (linearBox)
+                {
+                    const uint8_t* row0 = source.Data + 2 * y * sourcePitch;
+                    const uint8_t* row1 = source.Data + std::min(2 * y + 1, source.Height - 1) * sourcePitch;
+                    BoxRow(row0, row1, source.Width, output, destination.Width, channels);
+                }
+                else
+                {
+                    FilteredRow(source, y, output, destination.Width, channels, srgb, filter);
+                }
+            }
+        }
+
+        // Runs the work over [0, count) in chunks, on the calling thread and on thread pool workers. The workers only
+        // help: the calling thread never waits for a chunk that has not started, so a busy thread pool cannot block it.
+        inline void ParallelFor(uint32_t count, uint32_t chunkSize, const std::function<void(uint32_t, uint32_t)>& work)
+        {
+            struct State
+            {
+                std::atomic<uint32_t> Next{0};
+                uint32_t Count{};
+                uint32_t ChunkSize{};
+                const std::function<void(uint32_t, uint32_t)>* Work{};
+
+                std::mutex Mutex{};
+                std::condition_variable Condition{};
+                uint32_t Completed{0};
+            };
+
+            const auto runChunks = [](State& state) {
+                for (;;)
+                {
+                    const uint32_t begin = state.Next.fetch_add(state.ChunkSize);
+                    if (begin >= state.Count)
+                    {
+                        return;
+                    }
+
+                    const uint32_t end = std::min(begin + state.ChunkSize, state.Count);
+                    (*state.Work)(begin, end);
+                    {
+                        std::scoped_lock lock{state.Mutex};
+                        state.Completed += end - begin;
+                    }
+                    state.Condition.notify_all();
+                }
+            };
+
+            auto state = std::make_shared<State>();
+            state->Count = count;
+            state->ChunkSize = chunkSize;
+            state->Work = &work;
+
+            const uint32_t chunkCount = (count + chunkSize - 1) / chunkSize;
+            const uint32_t helperCount = std::min(chunkCount, std::max(std::thread::hardware_concurrency(), 1u)) - 1;
+            for (uint32_t helper = 0; helper < helperCount; ++helper)
+            {
+                arcana::make_task(arcana::threadpool_scheduler, arcana::cancellation::none(), [state, runChunks]() {
+                    runChunks(*state);
+                });
+            }
+
+            runChunks(*state);
+
+            std::unique_lock lock{state->Mutex};
+            state->Condition.wait(lock, [&state]() { return state->Completed == state->Count; });
+        }
+
+        inline uint32_t GetChannelCount(bimg::TextureFormat::Enum format)
+        {
+            switch (format)
+            {
+                case bimg::TextureFormat::R8:
+                    return 1;
+                case bimg::TextureFormat::RG8:
+                    return 2;
+                case bimg::TextureFormat::RGB8:
+                    return 3;
+                case bimg::TextureFormat::RGBA8:
+                case bimg::TextureFormat::BGRA8:
+                    return 4;
+                default:
+                    return 0;
+            }
+        }
+    }
+
+    /// Computes the levels of a mip chain from firstLod on, each from the previous level, in the single allocation
+    /// of the image. The image must be a 2D image with 8 bits per channel.
+    inline void GenerateMipLevels(bimg::ImageContainer& image, uint8_t firstLod, MipFilter filter, bool srgb)
+    {
+        using namespace MipGenerationDetail;
+
+        const uint32_t channels = GetChannelCount(image.m_format);
+        for (uint8_t lod = firstLod; lod < image.m_numMips; ++lod)
+        {
+            bimg::ImageMip sourceMip{};
+            bimg::ImageMip destinationMip{};
+            bimg::imageGetRawData(image, 0, static_cast<uint8_t>(lod - 1), image.m_data, image.m_size, sourceMip);
+            bimg::imageGetRawData(image, 0, lod, image.m_data, image.m_size, destinationMip);
+
+            const Level source{const_cast<uint8_t*>(sourceMip.m_data), sourceMip.m_width, sourceMip.m_height};
+            const Level destination{const_cast<uint8_t*>(destinationMip.m_data), destinationMip.m_width, destinationMip.m_height};
+            const std::function<void(uint32_t, uint32_t)> work = [&](uint32_t firstRow, uint32_t endRow) {
+                DownsampleRows(source, destination, channels, srgb, filter, firstRow, endRow);
+            };
+
+            if (destination.Width * destination.Height >= ParallelTexelCount)
+            {
+                ParallelFor(destination.Height, RowsPerChunk, work);
+            }
+            else
+            {
+                work(0, destination.Height);
+            }
+        }
+    }
+
+    /// Whether the mips of the image can be generated natively: a 2D image with 8 bits per channel.
+    inline bool CanGenerateMipChain(const bimg::ImageContainer& input)
+    {
+        return MipGenerationDetail::GetChannelCount(input.m_format) != 0 && input.m_depth == 1 && input.m_numLayers == 1 && !input.m_cubeMap;
+    }
+
+    /// Generates the mips of a 2D image with 8 bits per channel, all the levels written to a single allocation. Color
+    /// channels are filtered in linear space when srgb is set. Returns nullptr for other images.
+    inline bimg::ImageContainer* GenerateMipChain(bx::AllocatorI* allocator, const bimg::ImageContainer& input, MipFilter filter, bool srgb)
+    {
+        if (!CanGenerateMipChain(input))
+        {
+            return nullptr;
+        }
+
+        bimg::ImageContainer* output = bimg::imageAlloc(allocator, input.m_format, static_cast<uint16_t>(input.m_width), static_cast<uint16_t>(input.m_height), 1, 1, false, true);
+
+        bimg::ImageMip inputMip{};
+        bimg::ImageMip outputMip{};
+        bimg::imageGetRawData(input, 0, 0, input.m_data, input.m_size, inputMip);
+        bimg::imageGetRawData(*output, 0, 0, output->m_data, output->m_size, outputMip);
+        std::memcpy(const_cast<uint8_t*>(outputMip.m_data), inputMip.m_data, inputMip.m_size);
+
+        GenerateMipLevels(*output, 1, filter, srgb);
+        return output;
+    }
+}
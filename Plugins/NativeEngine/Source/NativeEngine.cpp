@@ -1,5 +1,9 @@
 #include "NativeEngine.h"
 #include "ShaderCompiler.h"
+#include "CubeTextureAssembly.h"
+#include "IndexNarrowing.h"
+#include "ImageProcessing.h"
+#include "IndexOptimization.h"
 #include <arcana/threading/task.h>
 #include <arcana/threading/task_schedulers.h>
 
@@ -16,8 +20,8 @@
 #include <bx/math.h>
 
 #include <queue>
-#include <regex>
 #include <sstream>
+#include <optional>
 #include <variant>
 
 namespace Babylon
@@ -69,6 +73,22 @@ namespace Babylon
             return static_cast<bgfx::TextureFormat::Enum>(format);
         }
 
+        // Frees the memory once bgfx has finished its frame, waiting for as many frames as needed.
+        void FreeAfterFrame(Graphics::Impl& graphicsImpl, std::shared_ptr<TextureReadback::RetiredMemory> retired)
+        {
+            if (retired->Data.empty())
+            {
+                return;
+            }
+
+            graphicsImpl.GetAfterRenderTask().then(arcana::inline_scheduler, arcana::cancellation::none(), [&graphicsImpl, retired = std::move(retired)]() mutable {
+                if (graphicsImpl.GetFrameNumber() < retired->Frame)
+                {
+                    FreeAfterFrame(graphicsImpl, std::move(retired));
+                }
+            });
+        }
+
         void FlipY(bimg::ImageContainer* image)
         {
             uint8_t* bytes = static_cast<uint8_t*>(image->m_data);
@@ -88,11 +108,19 @@ namespace Babylon
             }
         }
 
-        void GenerateMips(bx::AllocatorI* allocator, bimg::ImageContainer** image)
+        void GenerateMips(bx::AllocatorI* allocator, bimg::ImageContainer** image, MipFilter filter, bool srgb)
         {
             bimg::ImageContainer* input = *image;
 
-            bimg::ImageContainer* output = bimg::imageGenerateMips(allocator, *input);
+            bimg::ImageContainer* output = GenerateMipChain(allocator, *input, filter, srgb);
+            if (output != nullptr)
+            {
+                bimg::imageFree(input);
+                *image = output;
+                return;
+            }
+
+            output = bimg::imageGenerateMips(allocator, *input);
             if (output == nullptr)
             {
                 bimg::TextureFormat::Enum format = input->m_format;
@@ -111,6 +139,79 @@ namespace Babylon
             *image = output;
         }
 
+        template<typename ElementT>
+        gsl::span<const ElementT> AsSpan(const Napi::TypedArrayOf<ElementT>& array)
+        {
+            return gsl::make_span(array.Data(), array.ElementLength());
+        }
+
+        template<int size>
+        std::array<float, size> GetFloatArguments(const Napi::CallbackInfo& info)
+        {
+            std::array<float, size> values{};
+            for (size_t index = 0; index < static_cast<size_t>(size); ++index)
+            {
+                values[index] = info[index + 1].As<Napi::Number>().FloatValue();
+            }
+            return values;
+        }
+
+        // Builds the layout of a stream made of the given attributes. Returns false when the attributes overlap
+        // or do not fit in the stride, in which case they cannot share a stream.
+        bool BuildVertexLayout(std::vector<VertexArray::VertexAttribute>& attributes, uint32_t byteStride, bgfx::VertexLayout& layout)
+        {
+            std::sort(attributes.begin(), attributes.end(), [](const auto& a, const auto& b) { return a.offset < b.offset; });
+
+            layout.begin();
+            for (const auto& attribute : attributes)
+            {
+                if (layout.has(attribute.attrib) || attribute.offset < layout.m_stride)
+                {
+                    return false;
+                }
+
+                for (uint32_t gap = attribute.offset - layout.m_stride; gap > 0;)
+                {
+                    const auto skip = static_cast<uint8_t>(std::min<uint32_t>(gap, UINT8_MAX));
+                    layout.skip(skip);
+                    gap -= skip;
+                }
+
+                layout.add(attribute.attrib, attribute.numElements, attribute.type, attribute.normalized);
+            }
+
+            if (layout.m_stride > byteStride)
+            {
+                return false;
+            }
+
+            layout.m_stride = static_cast<uint16_t>(byteStride);
+            layout.end();
+            return true;
+        }
+
+        // Remembers the world uniform of a program that can be auto-instanced: the world uniform must only be read
+        // by the vertex shader, and the instance data registers (TexCoord4 to TexCoord7) must not already be used by
+        // vertex attributes.
+        void InitAutoInstancing(ProgramData& programData)
+        {
+            const auto itWorld = programData.VertexUniformInfos.find("world");
+            if (itWorld == programData.VertexUniformInfos.end() || programData.FragmentUniformInfos.count("world") != 0)
+            {
+                return;
+            }
+
+            for (const auto& [name, location] : programData.VertexAttributeLocations)
+            {
+                if (location >= static_cast<uint32_t>(bgfx::Attrib::TexCoord4) && location <= static_cast<uint32_t>(bgfx::Attrib::TexCoord7))
+                {
+                    return;
+                }
+            }
+
+            programData.WorldUniform = itWorld->second.Handle;
+        }
+
         void CreateTextureFromImage(TextureData* texture, bimg::ImageContainer* image)
         {
             auto releaseFn = [](void* /*ptr*/, void* userData) {
@@ -124,32 +225,210 @@ namespace Babylon
             texture->Height = image->m_height;
         }
 
-        void CreateCubeTextureFromImages(TextureData* texture, const std::vector<bimg::ImageContainer*>& images, bool hasMips)
+        // A texture decoded on the thread pool, or mapped from the texture cache.
+        struct LoadedImage
+        {
+            bimg::ImageContainer* Image{};
+            std::shared_ptr<TextureCache::MappedTexture> Cached{};
+
+            // Key of the texture cache entry of the image, 0 without a texture cache.
+            uint64_t CacheKey{};
+        };
+
+        // Packs everything applied to a decoded image into the key of its texture cache entry.
+        uint64_t GetProcessingKey(const ImageProcessingOptions& options, const TextureCompressionFormats& compressionFormats, bool cubeFace)
+        {
+            return (options.FlipY ? 1ull : 0ull) |
+                (options.PremultiplyAlpha ? 2ull : 0ull) |
+                (options.NarrowTo8Bits ? 4ull : 0ull) |
+                (options.GenerateMips ? 8ull : 0ull) |
+                (options.Srgb ? 16ull : 0ull) |
+                (cubeFace ? 32ull : 0ull) |
+                (static_cast<uint64_t>(options.Filter) << 8) |
+                (static_cast<uint64_t>(compressionFormats.Opaque) << 16) |
+                (static_cast<uint64_t>(compressionFormats.Transparent) << 24) |
+                (static_cast<uint64_t>(compressionFormats.Quality) << 32);
+        }
+
+        // Decodes and processes the image of a texture, unless the texture cache has it.
+        LoadedImage LoadTextureImage(bx::AllocatorI* allocator, gsl::span<const uint8_t> data, const ImageProcessingOptions& processingOptions, const TextureCompressionFormats& compressionFormats, TextureCache* cache)
+        {
+            uint64_t key{};
+            if (cache)
+            {
+                key = TextureCache::ComputeKey(data, GetProcessingKey(processingOptions, compressionFormats, false));
+                if (auto cached = cache->Find(key))
+                {
+                    return LoadedImage{nullptr, std::move(cached), key};
+                }
+            }
+
+            bimg::ImageContainer* image = bimg::imageParse(allocator, data.data(), static_cast<uint32_t>(data.size()));
+            if (image == nullptr)
+            {
+                throw std::runtime_error("Unable to decode image."); // exeption will be forwarded to JS
+            }
+            if (!ProcessImage(allocator, &image, processingOptions))
+            {
+                // Formats the single pass pipeline does not handle go through the separate steps.
+                if (processingOptions.FlipY)
+                {
+                    FlipY(image);
+                }
+                if (processingOptions.PremultiplyAlpha)
+                {
+                    PremultiplyAlpha(allocator, &image);
+                }
+                if (processingOptions.GenerateMips)
+                {
+                    GenerateMips(allocator, &image, processingOptions.Filter, processingOptions.Srgb);
+                }
+            }
+            if (compressionFormats.IsEnabled())
+            {
+                CompressImage(allocator, &image, compressionFormats);
+            }
+            if (cache)
+            {
+                cache->Store(key, *image);
+            }
+            return LoadedImage{image, nullptr, key};
+        }
+
+        // Returns the loaded image, kept alive by its owner.
+        StreamedImage ToStreamedImage(const LoadedImage& loaded)
+        {
+            StreamedImage streamed{};
+            if (loaded.Cached)
+            {
+                streamed.Image = loaded.Cached->GetImage();
+                streamed.Owner = loaded.Cached;
+            }
+            else
+            {
+                streamed.Image = *loaded.Image;
+                streamed.Owner = std::shared_ptr<const void>{loaded.Image, &bimg::imageFree};
+            }
+            return streamed;
+        }
+
+        void CreateTextureFromCache(TextureData* texture, std::shared_ptr<TextureCache::MappedTexture> cached)
+        {
+            auto releaseFn = [](void* /*ptr*/, void* userData) {
+                delete static_cast<std::shared_ptr<TextureCache::MappedTexture>*>(userData);
+            };
+
+            // The file stays mapped until bgfx is done with the memory.
+            const TextureCache::MappedTexture& mapped = *cached;
+            auto mem = bgfx::makeRef(mapped.Data, mapped.Size, releaseFn, new std::shared_ptr<TextureCache::MappedTexture>{std::move(cached)});
+
+            texture->Handle = bgfx::createTexture2D(static_cast<uint16_t>(mapped.Width), static_cast<uint16_t>(mapped.Height), (mapped.NumMips > 1), 1, Cast(mapped.Format), BGFX_TEXTURE_NONE | BGFX_SAMPLER_NONE, mem);
+            texture->Width = mapped.Width;
+            texture->Height = mapped.Height;
+        }
+
+        // A texture created by loadTexture, handed from the render thread to the JavaScript thread.
+        struct CreatedTexture
+        {
+            // The image, kept while the texture is streamed.
+            StreamedImage Source{};
+
+            // Description of the levels of the texture, without its data.
+            bimg::ImageContainer Layout{};
+            uint64_t CacheKey{};
+        };
+
+        // Creates the texture from the image, or only from its small mips when it is streamed. The image is kept in
+        // created for its larger mips to be uploaded later when streamed.
+        void CreateTextureFromLoadedImage(TextureData* texture, const LoadedImage& loaded, uint32_t streamingInitialSize, CreatedTexture& created)
+        {
+            const bimg::ImageContainer image = loaded.Cached ? loaded.Cached->GetImage() : *loaded.Image;
+            const uint8_t initialLevel = streamingInitialSize > 0 ? TextureStreamer::GetInitialLevel(image, streamingInitialSize) : 0;
+            created.Layout = image;
+            created.Layout.m_data = nullptr;
+            created.CacheKey = loaded.CacheKey;
+
+            if (initialLevel > 0)
+            {
+                created.Source = ToStreamedImage(loaded);
+                created.Source.InitialLevel = initialLevel;
+
+                texture->Handle = TextureStreamer::CreateTexture(created.Source, initialLevel, BGFX_TEXTURE_NONE | BGFX_SAMPLER_NONE);
+                texture->Width = image.m_width;
+                texture->Height = image.m_height;
+            }
+            else if (loaded.Cached)
+            {
+                CreateTextureFromCache(texture, loaded.Cached);
+            }
+            else
+            {
+                CreateTextureFromImage(texture, loaded.Image);
+            }
+        }
+
+        void CreateCubeTextureFromAssembly(TextureData* texture, std::shared_ptr<CubeTextureAssembly> assembly)
+        {
+            auto releaseFn = [](void* /*ptr*/, void* userData) {
+                delete static_cast<std::shared_ptr<CubeTextureAssembly>*>(userData);
+            };
+
+            // The faces were written into the block by the decoding tasks, it is handed to bgfx as is.
+            const CubeTextureAssembly& faces = *assembly;
+            auto mem = bgfx::makeRef(faces.GetData(), faces.GetDataSize(), releaseFn, new std::shared_ptr<CubeTextureAssembly>{std::move(assembly)});
+
+            texture->Handle = bgfx::createTextureCube(static_cast<uint16_t>(faces.GetWidth()), faces.HasMips(), 1, Cast(faces.GetFormat()), BGFX_TEXTURE_NONE | BGFX_SAMPLER_NONE, mem);
+            texture->Width = faces.GetWidth();
+            texture->Height = faces.GetHeight();
+        }
+
+        // Indices copied out of a JavaScript array to be reordered on the thread pool.
+        struct IndexOptimizationJob
         {
-            const bimg::ImageContainer* firstImage = images.front();
-            uint32_t width = firstImage->m_width;
-            uint32_t height = firstImage->m_height;
-            bgfx::TextureFormat::Enum format = Cast(firstImage->m_format);
+            std::vector<uint32_t> Indices{};
+            std::vector<uint32_t> Ranges{};
+            std::vector<float> Positions{};
+            IndexOptimizationStatistics Statistics{};
+        };
 
-            uint32_t totalSize = 0;
-            for (auto image : images)
+        std::vector<uint32_t> ReadIndices(const Napi::TypedArray& data)
+        {
+            switch (data.TypedArrayType())
             {
-                totalSize += image->m_size;
+                case napi_uint16_array:
+                {
+                    const auto indices = AsSpan(data.As<Napi::Uint16Array>());
+                    return std::vector<uint32_t>(indices.begin(), indices.end());
+                }
+                case napi_uint32_array:
+                {
+                    const auto indices = AsSpan(data.As<Napi::Uint32Array>());
+                    return std::vector<uint32_t>(indices.begin(), indices.end());
+                }
+                default:
+                    throw std::runtime_error{"Indices must be a Uint16Array or a Uint32Array."};
             }
+        }
 
-            // Combine all the faces into one chunk.
-            const bgfx::Memory* mem = bgfx::alloc(totalSize);
-            uint8_t* ptr = mem->data;
-            for (bimg::ImageContainer* image : images)
+        void WriteIndices(const std::vector<uint32_t>& indices, const Napi::TypedArray& data)
+        {
+            if (data.TypedArrayType() == napi_uint16_array)
+            {
+                auto* destination = data.As<Napi::Uint16Array>().Data();
+                std::transform(indices.begin(), indices.end(), destination, [](uint32_t index) { return static_cast<uint16_t>(index); });
+            }
+            else
             {
-                std::memcpy(ptr, image->m_data, image->m_size);
-                ptr += image->m_size;
-                bimg::imageFree(image);
+                std::copy(indices.begin(), indices.end(), data.As<Napi::Uint32Array>().Data());
             }
+        }
 
-            texture->Handle = bgfx::createTextureCube(static_cast<uint16_t>(width), hasMips, 1, format, BGFX_TEXTURE_NONE | BGFX_SAMPLER_NONE, mem);
-            texture->Width = width;
-            texture->Height = height;
+        Napi::Object CreateIndexOptimizationStatistics(Napi::Env env, const IndexOptimizationStatistics& statistics)
+        {
+            auto result = Napi::Object::New(env);
+            result.Set("acmrBefore", statistics.AcmrBefore);
+            result.Set("acmrAfter", statistics.AcmrAfter);
+            return result;
         }
     }
 
@@ -171,14 +450,27 @@ namespace Babylon
                 dynamicCallable(std::get<Handle2T>(m_handle));
             }
         }
+
+        // Identifies the bgfx buffer among the live buffers of both types, for eliding redundant bindings.
+        uint32_t GetHandleBindingId() const
+        {
+            return std::visit([this](auto handle) {
+                return handle.idx == bgfx::kInvalidHandle ? BindingShadowState::UncomparableBuffer : (static_cast<uint32_t>(m_handle.index()) << 16) | handle.idx;
+            }, m_handle);
+        }
     };
 
-    class IndexBufferData final : private VariantHandleHolder<bgfx::IndexBufferHandle, bgfx::DynamicIndexBufferHandle>
+    class IndexBufferData final : private VariantHandleHolder<bgfx::IndexBufferHandle, bgfx::DynamicIndexBufferHandle>, public std::enable_shared_from_this<IndexBufferData>
     {
     public:
         IndexBufferData(const Napi::TypedArray& bytes, uint16_t flags, bool dynamic)
+            : IndexBufferData{bgfx::copy(bytes.As<Napi::Uint8Array>().Data(), static_cast<uint32_t>(bytes.ByteLength())), flags, dynamic}
+        {
+        }
+
+        IndexBufferData(const bgfx::Memory* memory, uint16_t flags, bool dynamic)
+            : m_flags{flags}
         {
-            const bgfx::Memory* memory = bgfx::copy(bytes.As<Napi::Uint8Array>().Data(), static_cast<uint32_t>(bytes.ByteLength()));
             if (!dynamic)
             {
                 m_handle = bgfx::createIndexBuffer(memory, flags);
@@ -189,10 +481,21 @@ namespace Babylon
             }
         }
 
+        // Wraps 16-bit indices allocated by bgfx for the current frame only.
+        IndexBufferData(const bgfx::TransientIndexBuffer& transientBuffer, uint32_t frameIndex)
+            : m_transientBuffer{transientBuffer}
+            , m_transientFrameIndex{frameIndex}
+        {
+            m_handle = bgfx::IndexBufferHandle{bgfx::kInvalidHandle};
+        }
+
         ~IndexBufferData()
         {
             constexpr auto nonDynamic = [](auto handle) {
-                bgfx::destroy(handle);
+                if (handle.idx != bgfx::kInvalidHandle)
+                {
+                    bgfx::destroy(handle);
+                }
             };
             constexpr auto dynamic = [](auto handle) {
                 bgfx::destroy(handle);
@@ -200,21 +503,68 @@ namespace Babylon
             DoForHandleTypes(nonDynamic, dynamic);
         }
 
-        void Update(const Napi::TypedArray& bytes, uint32_t startingIdx)
+        // Writes the first indexCount indices of the array at startingIdx.
+        void Update(const Napi::TypedArray& bytes, uint32_t startingIdx, uint32_t indexCount, StagingBufferRing& stagingBuffers)
         {
-            const bgfx::Memory* memory = bgfx::copy(bytes.As<Napi::Uint8Array>().Data(), static_cast<uint32_t>(bytes.ByteLength()));
+            const size_t byteLength = static_cast<size_t>(indexCount) * bytes.ElementSize();
+            if (byteLength > bytes.ByteLength())
+            {
+                throw std::runtime_error{"Index count exceeds the length of the index array."};
+            }
 
             constexpr auto nonDynamic = [](auto) {
                 throw std::runtime_error("Cannot update a non-dynamic index buffer.");
             };
-            const auto dynamic = [memory, startingIdx](auto handle) {
-                bgfx::update(handle, startingIdx, memory);
+            const auto dynamic = [&bytes, startingIdx, byteLength, &stagingBuffers](auto handle) {
+                bgfx::update(handle, startingIdx, stagingBuffers.Copy(bytes.As<Napi::Uint8Array>().Data(), static_cast<uint32_t>(byteLength)));
             };
             DoForHandleTypes(nonDynamic, dynamic);
         }
 
+        // Recreates a static buffer with the same indices in a different order. The previous buffer is destroyed
+        // by bgfx at the end of the frame, after the draws already submitted with it.
+        void ReplaceIndices(const std::vector<uint32_t>& indices)
+        {
+            auto* handle = std::get_if<bgfx::IndexBufferHandle>(&m_handle);
+            if (handle == nullptr || handle->idx == bgfx::kInvalidHandle)
+            {
+                return;
+            }
+
+            const bgfx::Memory* memory{};
+            if ((m_flags & BGFX_BUFFER_INDEX32) == 0)
+            {
+                memory = bgfx::alloc(static_cast<uint32_t>(indices.size() * sizeof(uint16_t)));
+                NarrowIndices(indices.data(), indices.size(), reinterpret_cast<uint16_t*>(memory->data));
+            }
+            else
+            {
+                memory = bgfx::copy(indices.data(), static_cast<uint32_t>(indices.size() * sizeof(uint32_t)));
+            }
+
+            bgfx::destroy(*handle);
+            m_handle = bgfx::createIndexBuffer(memory, m_flags);
+        }
+
+        // Expires when the buffer is deleted, for work completing after the call that started it.
+        std::weak_ptr<void> GetLifetime() const
+        {
+            return m_lifetime;
+        }
+
+        uint32_t GetBindingId() const
+        {
+            return m_transientBuffer.has_value() ? BindingShadowState::UncomparableBuffer : GetHandleBindingId();
+        }
+
         void SetBgfxIndexBuffer(uint32_t firstIndex, uint32_t numIndices) const
         {
+            if (m_transientBuffer.has_value())
+            {
+                bgfx::setIndexBuffer(&*m_transientBuffer, firstIndex, numIndices);
+                return;
+            }
+
             const auto nonDynamic = [firstIndex, numIndices](auto handle) {
                 bgfx::setIndexBuffer(handle, firstIndex, numIndices);
             };
@@ -223,9 +573,33 @@ namespace Babylon
             };
             DoForHandleTypes(nonDynamic, dynamic);
         }
+
+        bool IsTransient() const
+        {
+            return m_transientBuffer.has_value();
+        }
+
+        // Transient buffers are only valid until the end of the frame they were allocated in.
+        bool IsExpired(uint32_t frameIndex) const
+        {
+            return m_transientBuffer.has_value() && m_transientFrameIndex != frameIndex;
+        }
+
+        // Transient buffers are owned by their JavaScript object, which can be collected while vertex arrays still
+        // refer to them. Those vertex arrays share the ownership.
+        std::shared_ptr<const IndexBufferData> ShareIfTransient() const
+        {
+            return m_transientBuffer.has_value() ? shared_from_this() : nullptr;
+        }
+
+    private:
+        uint16_t m_flags{};
+        std::shared_ptr<void> m_lifetime{std::make_shared<bool>()};
+        std::optional<bgfx::TransientIndexBuffer> m_transientBuffer{};
+        uint32_t m_transientFrameIndex{};
     };
 
-    class VertexBufferData final : VariantHandleHolder<bgfx::VertexBufferHandle, bgfx::DynamicVertexBufferHandle>
+    class VertexBufferData final : VariantHandleHolder<bgfx::VertexBufferHandle, bgfx::DynamicVertexBufferHandle>, public std::enable_shared_from_this<VertexBufferData>
     {
     public:
         VertexBufferData(const Napi::Uint8Array& bytes, bool dynamic)
@@ -241,6 +615,23 @@ namespace Babylon
             }
         }
 
+        // Creates a static vertex buffer that reads the vertices straight from the JavaScript array instead of
+        // copying them. The array is kept alive until bgfx has uploaded it, then released on the JavaScript thread.
+        VertexBufferData(const Napi::Uint8Array& bytes, std::shared_ptr<RuntimeDispatcher> dispatcher)
+            : m_borrowedBytes{std::make_unique<BorrowedBytes>(bytes, std::move(dispatcher))}
+        {
+            m_handle = bgfx::VertexBufferHandle{bgfx::kInvalidHandle};
+        }
+
+        // Wraps vertices allocated by bgfx for the current frame only.
+        VertexBufferData(const bgfx::TransientVertexBuffer& transientBuffer, uint32_t frameIndex)
+            : m_transientBuffer{transientBuffer}
+            , m_transientFrameIndex{frameIndex}
+        {
+            m_handle = bgfx::VertexBufferHandle{bgfx::kInvalidHandle};
+            m_byteStride = transientBuffer.stride;
+        }
+
         ~VertexBufferData()
         {
             constexpr auto nonDynamic = [](auto handle) {
@@ -260,12 +651,43 @@ namespace Babylon
 
         void EnsureFinalized(Napi::Env /*env*/, const bgfx::VertexLayout& layout)
         {
+            if (m_transientBuffer.has_value())
+            {
+                return;
+            }
+
+            if (std::visit([](auto handle) { return handle.idx == bgfx::kInvalidHandle; }, m_handle))
+            {
+                m_byteStride = std::max<uint32_t>(layout.getStride(), 1);
+            }
+
             const auto nonDynamic = [&layout, this](auto handle) {
                 if (handle.idx != bgfx::kInvalidHandle)
                 {
                     return;
                 }
 
+                if (m_borrowedBytes != nullptr)
+                {
+                    const auto* borrowedBytes = m_borrowedBytes.get();
+                    const bgfx::Memory* memory = bgfx::makeRef(
+                        borrowedBytes->Data, borrowedBytes->ByteLength, [](void*, void* userData) {
+                            // Called by bgfx from the render thread, the reference must be released on the JavaScript thread.
+                            auto* bytes = static_cast<BorrowedBytes*>(userData);
+                            const std::shared_ptr<RuntimeDispatcher> dispatcher = bytes->Dispatcher;
+                            if (!dispatcher->Dispatch([bytes](Napi::Env) { delete bytes; }))
+                            {
+                                // The engine is gone and the runtime may be too, the reference is left to its teardown.
+                                bytes->Reference.SuppressDestruct();
+                                delete bytes;
+                            }
+                        },
+                        m_borrowedBytes.release());
+
+                    m_handle = bgfx::createVertexBuffer(memory, layout);
+                    return;
+                }
+
                 const bgfx::Memory* memory = bgfx::makeRef(
                     m_bytes.data(), static_cast<uint32_t>(m_bytes.size()), [](void*, void* userData) {
                         auto* bytes = reinterpret_cast<std::vector<uint8_t>*>(userData);
@@ -281,57 +703,282 @@ namespace Babylon
                     return;
                 }
 
-                const bgfx::Memory* memory = bgfx::makeRef(
-                    m_bytes.data(), static_cast<uint32_t>(m_bytes.size()), [](void*, void* userData) {
-                        auto* bytes = reinterpret_cast<std::vector<uint8_t>*>(userData);
-                        bytes->clear();
-                    },
-                    &m_bytes);
-
-                m_handle = bgfx::createDynamicVertexBuffer(memory, layout);
+                // The bytes are kept, so that updates covering part of a vertex can be completed from them.
+                m_handle = bgfx::createDynamicVertexBuffer(bgfx::copy(m_bytes.data(), static_cast<uint32_t>(m_bytes.size())), layout);
             };
             DoForHandleTypes(nonDynamic, dynamic);
         }
 
-        void Update(const Napi::Uint8Array& bytes, uint32_t offset, uint32_t byteLength)
+        // Creates the buffer for per-instance attributes. bgfx only needs to know the stride of instance data. A copy
+        // of the bytes is kept, for the draws that gather the attributes of several buffers into one. Dynamic buffers
+        // already keep one.
+        void EnsureFinalizedAsInstanceData(Napi::Env env, uint32_t byteStride)
         {
-            constexpr auto nonDynamic = [](auto) {
-                throw std::runtime_error("Cannot update non-dynamic vertex buffer.");
-            };
-            const auto dynamic = [&bytes, offset, byteLength, this](auto handle) {
-                if (handle.idx == bgfx::kInvalidHandle)
+            if (byteStride == 0)
+            {
+                throw std::runtime_error{"Instance data stride must not be 0."};
+            }
+
+            if (m_transientBuffer.has_value())
+            {
+                return;
+            }
+
+            if (!m_keepsInstanceBytes && !IsDynamic() && std::visit([](auto handle) { return handle.idx == bgfx::kInvalidHandle; }, m_handle))
+            {
+                if (m_borrowedBytes != nullptr)
                 {
-                    // Buffer hasn't been finalized yet, all that's necessary is to swap out the bytes.
-                    m_bytes = {bytes.Data() + offset, bytes.Data() + offset + byteLength};
+                    m_instanceBytes.assign(m_borrowedBytes->Data, m_borrowedBytes->Data + m_borrowedBytes->ByteLength);
                 }
                 else
                 {
-                    // Buffer was already created, do a real update operation.
-                    const bgfx::Memory* memory = bgfx::copy(bytes.Data() + offset, byteLength);
-                    bgfx::update(handle, 0, memory);
+                    m_instanceBytes = m_bytes;
+                }
+                m_keepsInstanceBytes = true;
+            }
+
+            bgfx::VertexLayout layout{};
+            layout.begin();
+            for (uint32_t remaining = byteStride; remaining > 0;)
+            {
+                const auto skip = static_cast<uint8_t>(std::min<uint32_t>(remaining, UINT8_MAX));
+                layout.skip(skip);
+                remaining -= skip;
+            }
+            layout.end();
+
+            EnsureFinalized(env, layout);
+        }
+
+        // The bytes of the buffer as seen by the GPU, when it is transient or used for per-instance attributes.
+        gsl::span<const uint8_t> GetInstanceBytes() const
+        {
+            if (m_transientBuffer.has_value())
+            {
+                return gsl::make_span(m_transientBuffer->data, m_transientBuffer->size);
+            }
+
+            const std::vector<uint8_t>& bytes = IsDynamic() ? m_bytes : m_instanceBytes;
+            return gsl::make_span(bytes.data(), bytes.size());
+        }
+
+        bool KeepsInstanceBytes() const
+        {
+            return m_keepsInstanceBytes || IsDynamic() || m_transientBuffer.has_value();
+        }
+
+        // Stride of the layout the buffer was created with.
+        uint32_t GetByteStride() const
+        {
+            return m_byteStride;
+        }
+
+        // Writes byteLength bytes at byteOffset in the buffer.
+        void Update(const uint8_t* data, uint32_t byteLength, uint32_t byteOffset, StagingBufferRing& stagingBuffers)
+        {
+            constexpr auto nonDynamic = [](auto) {
+                throw std::runtime_error("Cannot update non-dynamic vertex buffer.");
+            };
+            const auto dynamic = [data, byteLength, byteOffset, &stagingBuffers, this](auto handle) {
+                UpdateInstanceBytes(data, byteOffset, byteLength);
+                UpdateBytes(data, byteOffset, byteLength);
+
+                if (handle.idx != bgfx::kInvalidHandle)
+                {
+                    // bgfx updates whole vertices, those the update covers only in part are completed from the copy
+                    // of the buffer, as when one attribute of interleaved vertices is written.
+                    const size_t firstByte = byteOffset - byteOffset % m_byteStride;
+                    const size_t endByte = static_cast<size_t>(byteOffset) + byteLength;
+                    const size_t alignedEndByte = std::min(endByte + (m_byteStride - endByte % m_byteStride) % m_byteStride, m_bytes.size());
+                    bgfx::update(handle, byteOffset / m_byteStride, stagingBuffers.Copy(m_bytes.data() + firstByte, static_cast<uint32_t>(alignedEndByte - firstByte)));
                 }
             };
             DoForHandleTypes(nonDynamic, dynamic);
         }
 
-        void SetAsBgfxVertexBuffer(uint8_t index, uint32_t startVertex, bgfx::VertexLayoutHandle layout) const
+        void UpdateVertices(const uint8_t* data, uint32_t byteLength, uint32_t startVertex, uint32_t byteStride, StagingBufferRing& stagingBuffers)
         {
-            const auto nonDynamic = [index, startVertex, layout](auto handle) {
-                bgfx::setVertexBuffer(index, handle, startVertex, UINT32_MAX, layout);
+            constexpr auto nonDynamic = [](auto) {
+                throw std::runtime_error("Cannot update non-dynamic vertex buffer.");
             };
-            const auto dynamic = [index, startVertex, layout](auto handle) {
-                bgfx::setVertexBuffer(index, handle, startVertex, UINT32_MAX, layout);
+            const auto dynamic = [data, byteLength, startVertex, byteStride, &stagingBuffers, this](auto handle) {
+                UpdateInstanceBytes(data, static_cast<size_t>(startVertex) * byteStride, byteLength);
+                UpdateBytes(data, static_cast<size_t>(startVertex) * byteStride, byteLength);
+
+                if (handle.idx != bgfx::kInvalidHandle)
+                {
+                    bgfx::update(handle, startVertex, stagingBuffers.Copy(data, byteLength));
+                }
             };
             DoForHandleTypes(nonDynamic, dynamic);
         }
 
-    private:
-        std::vector<uint8_t> m_bytes{};
-    };
-
-    void NativeEngine::Initialize(Napi::Env env, bool autoRender)
-    {
-        // Initialize the JavaScript side.
+        // Converts the vertices of a static buffer holding a single float attribute to the quantized format, before
+        // the buffer is created. Returns the format the buffer holds, or nothing when the buffer holds the original
+        // vertices: when there is no quantization, the attribute is not tightly packed floats, or a value is out of range.
+        std::optional<QuantizedVertexFormat> Quantize(VertexQuantization quantization, uint32_t byteOffset, uint32_t byteStride, uint32_t numElements, uint32_t type, bool normalized)
+        {
+            if (m_quantizedFormat.has_value())
+            {
+                // The original vertices are gone, the buffer can only be read as it was first recorded.
+                if (byteStride != m_sourceByteStride || byteOffset % byteStride != 0 || numElements != m_sourceNumElements)
+                {
+                    throw std::runtime_error{"Quantized vertex buffer must be recorded with the attribute it was created for."};
+                }
+                return m_quantizedFormat;
+            }
+
+            const auto* staticHandle = std::get_if<bgfx::VertexBufferHandle>(&m_handle);
+            if (quantization == VertexQuantization::None || staticHandle == nullptr || staticHandle->idx != bgfx::kInvalidHandle || m_transientBuffer.has_value() ||
+                type != static_cast<uint32_t>(bgfx::AttribType::Float) || normalized ||
+                numElements == 0 || numElements > 4 || byteStride != numElements * sizeof(float) || byteOffset % byteStride != 0)
+            {
+                return {};
+            }
+
+            const uint8_t* bytes = m_borrowedBytes != nullptr ? m_borrowedBytes->Data : m_bytes.data();
+            const size_t byteLength = m_borrowedBytes != nullptr ? m_borrowedBytes->ByteLength : m_bytes.size();
+            const size_t vertexCount = byteLength / byteStride;
+            const auto* values = reinterpret_cast<const float*>(bytes);
+            if (!CanQuantizeVertices(quantization, values, vertexCount * numElements))
+            {
+                return {};
+            }
+
+            const QuantizedVertexFormat format = GetQuantizedVertexFormat(quantization, numElements);
+            std::vector<uint8_t> quantizedBytes(vertexCount * format.ByteStride);
+            QuantizeVertices(quantization, values, vertexCount, numElements, quantizedBytes.data());
+
+            m_bytes = std::move(quantizedBytes);
+            m_borrowedBytes.reset();
+            m_quantizedFormat = format;
+            m_sourceByteStride = byteStride;
+            m_sourceNumElements = numElements;
+            return m_quantizedFormat;
+        }
+
+        void SetAsBgfxInstanceDataBuffer(uint32_t startInstance, uint32_t numInstances) const
+        {
+            const auto nonDynamic = [startInstance, numInstances](auto handle) {
+                bgfx::setInstanceDataBuffer(handle, startInstance, numInstances);
+            };
+            const auto dynamic = [startInstance, numInstances](auto handle) {
+                bgfx::setInstanceDataBuffer(handle, startInstance, numInstances);
+            };
+            DoForHandleTypes(nonDynamic, dynamic);
+        }
+
+        uint32_t GetBindingId() const
+        {
+            return m_transientBuffer.has_value() ? BindingShadowState::UncomparableBuffer : GetHandleBindingId();
+        }
+
+        void SetAsBgfxVertexBuffer(uint8_t index, uint32_t startVertex, bgfx::VertexLayoutHandle layout) const
+        {
+            if (m_transientBuffer.has_value())
+            {
+                bgfx::setVertexBuffer(index, &*m_transientBuffer, startVertex, UINT32_MAX, layout);
+                return;
+            }
+
+            const auto nonDynamic = [index, startVertex, layout](auto handle) {
+                bgfx::setVertexBuffer(index, handle, startVertex, UINT32_MAX, layout);
+            };
+            const auto dynamic = [index, startVertex, layout](auto handle) {
+                bgfx::setVertexBuffer(index, handle, startVertex, UINT32_MAX, layout);
+            };
+            DoForHandleTypes(nonDynamic, dynamic);
+        }
+
+        bool IsTransient() const
+        {
+            return m_transientBuffer.has_value();
+        }
+
+        // Transient buffers are only valid until the end of the frame they were allocated in.
+        bool IsExpired(uint32_t frameIndex) const
+        {
+            return m_transientBuffer.has_value() && m_transientFrameIndex != frameIndex;
+        }
+
+        // Transient buffers are owned by their JavaScript object, which can be collected while vertex arrays still
+        // refer to them. Those vertex arrays share the ownership.
+        std::shared_ptr<const VertexBufferData> ShareIfTransient() const
+        {
+            return m_transientBuffer.has_value() ? shared_from_this() : nullptr;
+        }
+
+    private:
+        bool IsDynamic() const
+        {
+            return std::holds_alternative<bgfx::DynamicVertexBufferHandle>(m_handle);
+        }
+
+        // Writes to the bytes the buffer is created from, and to the copy dynamic buffers keep once created.
+        void UpdateBytes(const uint8_t* data, size_t byteOffset, size_t byteLength)
+        {
+            if (m_bytes.size() < byteOffset + byteLength)
+            {
+                m_bytes.resize(byteOffset + byteLength);
+            }
+            std::memcpy(m_bytes.data() + byteOffset, data, byteLength);
+        }
+
+        void UpdateInstanceBytes(const uint8_t* data, size_t byteOffset, size_t byteLength)
+        {
+            if (m_keepsInstanceBytes)
+            {
+                if (m_instanceBytes.size() < byteOffset + byteLength)
+                {
+                    m_instanceBytes.resize(byteOffset + byteLength);
+                }
+                std::memcpy(m_instanceBytes.data() + byteOffset, data, byteLength);
+            }
+        }
+
+        // Bytes the buffer is created from. Static buffers release them once bgfx has uploaded them, dynamic buffers
+        // keep them up to date with the updates. This copy, as large as the buffer, is what lets an update start
+        // within a vertex, and also serves the per-instance attributes of dynamic buffers.
+        std::vector<uint8_t> m_bytes{};
+
+        // Copy of the bytes of a static buffer used for per-instance attributes.
+        std::vector<uint8_t> m_instanceBytes{};
+        bool m_keepsInstanceBytes{};
+
+        std::optional<bgfx::TransientVertexBuffer> m_transientBuffer{};
+        uint32_t m_transientFrameIndex{};
+
+        // Stride of the layout the buffer was created with.
+        uint32_t m_byteStride{1};
+
+        struct BorrowedBytes
+        {
+            BorrowedBytes(const Napi::Uint8Array& bytes, std::shared_ptr<RuntimeDispatcher> dispatcher)
+                : Reference{Napi::Persistent(bytes)}
+                , Data{bytes.Data()}
+                , ByteLength{static_cast<uint32_t>(bytes.ByteLength())}
+                , Dispatcher{std::move(dispatcher)}
+            {
+            }
+
+            Napi::Reference<Napi::Uint8Array> Reference;
+            const uint8_t* Data{};
+            uint32_t ByteLength{};
+            std::shared_ptr<RuntimeDispatcher> Dispatcher;
+        };
+
+        // Set until bgfx takes ownership of the borrowed array.
+        std::unique_ptr<BorrowedBytes> m_borrowedBytes{};
+
+        // Set when the vertices were quantized, along with the description of the original float attribute.
+        std::optional<QuantizedVertexFormat> m_quantizedFormat{};
+        uint32_t m_sourceByteStride{};
+        uint32_t m_sourceNumElements{};
+    };
+
+    void NativeEngine::Initialize(Napi::Env env, bool autoRender)
+    {
+        // Initialize the JavaScript side.
         Napi::HandleScope scope{env};
 
         Napi::Function func = DefineClass(
@@ -347,10 +994,27 @@ namespace Babylon
                 InstanceMethod("deleteIndexBuffer", &NativeEngine::DeleteIndexBuffer),
                 InstanceMethod("recordIndexBuffer", &NativeEngine::RecordIndexBuffer),
                 InstanceMethod("updateDynamicIndexBuffer", &NativeEngine::UpdateDynamicIndexBuffer),
+                InstanceMethod("setIndexNarrowing", &NativeEngine::SetIndexNarrowing),
+                InstanceMethod("setTextureCompression", &NativeEngine::SetTextureCompression),
+                InstanceMethod("setMipFilter", &NativeEngine::SetMipFilter),
+                InstanceMethod("setImageNarrowing", &NativeEngine::SetImageNarrowing),
+                InstanceMethod("setVertexBufferBorrowing", &NativeEngine::SetVertexBufferBorrowing),
+                InstanceMethod("setTextureCache", &NativeEngine::SetTextureCache),
+                InstanceMethod("setTextureStreaming", &NativeEngine::SetTextureStreaming),
+                InstanceMethod("setTextureMemoryBudget", &NativeEngine::SetTextureMemoryBudget),
+                InstanceMethod("getTextureMemoryUsage", &NativeEngine::GetTextureMemoryUsage),
+                InstanceMethod("setRenderTargetPooling", &NativeEngine::SetRenderTargetPooling),
+                InstanceMethod("getRenderTargetPoolStatistics", &NativeEngine::GetRenderTargetPoolStatistics),
+                InstanceMethod("optimizeIndices", &NativeEngine::OptimizeIndices),
+                InstanceMethod("setAttributeQuantization", &NativeEngine::SetAttributeQuantization),
                 InstanceMethod("createVertexBuffer", &NativeEngine::CreateVertexBuffer),
                 InstanceMethod("deleteVertexBuffer", &NativeEngine::DeleteVertexBuffer),
+                InstanceMethod("allocTransientVertexBuffer", &NativeEngine::AllocTransientVertexBuffer),
+                InstanceMethod("allocTransientIndexBuffer", &NativeEngine::AllocTransientIndexBuffer),
                 InstanceMethod("recordVertexBuffer", &NativeEngine::RecordVertexBuffer),
                 InstanceMethod("updateDynamicVertexBuffer", &NativeEngine::UpdateDynamicVertexBuffer),
+                InstanceMethod("createInstanceBuffer", &NativeEngine::CreateInstanceBuffer),
+                InstanceMethod("updateInstanceBuffer", &NativeEngine::UpdateInstanceBuffer),
                 InstanceMethod("createProgram", &NativeEngine::CreateProgram),
                 InstanceMethod("getUniforms", &NativeEngine::GetUniforms),
                 InstanceMethod("getAttributes", &NativeEngine::GetAttributes),
@@ -398,6 +1062,7 @@ namespace Babylon
                 InstanceMethod("unbindFramebuffer", &NativeEngine::UnbindFrameBuffer),
                 InstanceMethod("drawIndexed", &NativeEngine::DrawIndexed),
                 InstanceMethod("draw", &NativeEngine::Draw),
+                InstanceMethod("drawInstanced", &NativeEngine::DrawInstanced),
                 InstanceMethod("clear", &NativeEngine::Clear),
                 InstanceMethod("clearColor", &NativeEngine::ClearColor),
                 InstanceMethod("clearDepth", &NativeEngine::ClearDepth),
@@ -406,7 +1071,17 @@ namespace Babylon
                 InstanceMethod("getRenderHeight", &NativeEngine::GetRenderHeight),
                 InstanceMethod("setViewPort", &NativeEngine::SetViewPort),
                 InstanceMethod("getFramebufferData", &NativeEngine::GetFramebufferData),
+                InstanceMethod("readPixelsAsync", &NativeEngine::ReadPixelsAsync),
+                InstanceMethod("readTexturePixelsAsync", &NativeEngine::ReadTexturePixelsAsync),
+                InstanceMethod("releasePixels", &NativeEngine::ReleasePixels),
                 InstanceMethod("getRenderAPI", &NativeEngine::GetRenderAPI),
+                InstanceMethod("submitCommands", &NativeEngine::SubmitCommands),
+                InstanceMethod("getCommandHandle", &NativeEngine::GetCommandHandle),
+                InstanceMethod("getSubmitStatistics", &NativeEngine::GetSubmitStatistics),
+                InstanceMethod("beginBundle", &NativeEngine::BeginBundle),
+                InstanceMethod("endBundle", &NativeEngine::EndBundle),
+                InstanceMethod("executeBundle", &NativeEngine::ExecuteBundle),
+                InstanceMethod("setAutoInstancing", &NativeEngine::SetAutoInstancing),
 
                 InstanceValue("TEXTURE_NEAREST_NEAREST", Napi::Number::From(env, TextureSampling::NEAREST_NEAREST)),
                 InstanceValue("TEXTURE_LINEAR_LINEAR", Napi::Number::From(env, TextureSampling::LINEAR_LINEAR)),
@@ -459,6 +1134,42 @@ namespace Babylon
                 InstanceValue("ALPHA_INTERPOLATE", Napi::Number::From(env, AlphaMode::INTERPOLATE)),
                 InstanceValue("ALPHA_SCREENMODE", Napi::Number::From(env, AlphaMode::SCREENMODE)),
 
+                InstanceValue("COMMAND_BINDVERTEXARRAY", Napi::Number::From(env, static_cast<uint32_t>(CommandType::BindVertexArray))),
+                InstanceValue("COMMAND_SETPROGRAM", Napi::Number::From(env, static_cast<uint32_t>(CommandType::SetProgram))),
+                InstanceValue("COMMAND_SETSTATE", Napi::Number::From(env, static_cast<uint32_t>(CommandType::SetState))),
+                InstanceValue("COMMAND_SETDEPTHTEST", Napi::Number::From(env, static_cast<uint32_t>(CommandType::SetDepthTest))),
+                InstanceValue("COMMAND_SETDEPTHWRITE", Napi::Number::From(env, static_cast<uint32_t>(CommandType::SetDepthWrite))),
+                InstanceValue("COMMAND_SETCOLORWRITE", Napi::Number::From(env, static_cast<uint32_t>(CommandType::SetColorWrite))),
+                InstanceValue("COMMAND_SETBLENDMODE", Napi::Number::From(env, static_cast<uint32_t>(CommandType::SetBlendMode))),
+                InstanceValue("COMMAND_SETINT", Napi::Number::From(env, static_cast<uint32_t>(CommandType::SetInt))),
+                InstanceValue("COMMAND_SETINTARRAY", Napi::Number::From(env, static_cast<uint32_t>(CommandType::SetIntArray))),
+                InstanceValue("COMMAND_SETINTARRAY2", Napi::Number::From(env, static_cast<uint32_t>(CommandType::SetIntArray2))),
+                InstanceValue("COMMAND_SETINTARRAY3", Napi::Number::From(env, static_cast<uint32_t>(CommandType::SetIntArray3))),
+                InstanceValue("COMMAND_SETINTARRAY4", Napi::Number::From(env, static_cast<uint32_t>(CommandType::SetIntArray4))),
+                InstanceValue("COMMAND_SETFLOATARRAY", Napi::Number::From(env, static_cast<uint32_t>(CommandType::SetFloatArray))),
+                InstanceValue("COMMAND_SETFLOATARRAY2", Napi::Number::From(env, static_cast<uint32_t>(CommandType::SetFloatArray2))),
+                InstanceValue("COMMAND_SETFLOATARRAY3", Napi::Number::From(env, static_cast<uint32_t>(CommandType::SetFloatArray3))),
+                InstanceValue("COMMAND_SETFLOATARRAY4", Napi::Number::From(env, static_cast<uint32_t>(CommandType::SetFloatArray4))),
+                InstanceValue("COMMAND_SETMATRICES", Napi::Number::From(env, static_cast<uint32_t>(CommandType::SetMatrices))),
+                InstanceValue("COMMAND_SETMATRIX3X3", Napi::Number::From(env, static_cast<uint32_t>(CommandType::SetMatrix3x3))),
+                InstanceValue("COMMAND_SETMATRIX2X2", Napi::Number::From(env, static_cast<uint32_t>(CommandType::SetMatrix2x2))),
+                InstanceValue("COMMAND_SETMATRIX", Napi::Number::From(env, static_cast<uint32_t>(CommandType::SetMatrix))),
+                InstanceValue("COMMAND_SETFLOAT", Napi::Number::From(env, static_cast<uint32_t>(CommandType::SetFloat))),
+                InstanceValue("COMMAND_SETFLOAT2", Napi::Number::From(env, static_cast<uint32_t>(CommandType::SetFloat2))),
+                InstanceValue("COMMAND_SETFLOAT3", Napi::Number::From(env, static_cast<uint32_t>(CommandType::SetFloat3))),
+                InstanceValue("COMMAND_SETFLOAT4", Napi::Number::From(env, static_cast<uint32_t>(CommandType::SetFloat4))),
+                InstanceValue("COMMAND_SETTEXTURE", Napi::Number::From(env, static_cast<uint32_t>(CommandType::SetTexture))),
+                InstanceValue("COMMAND_BINDFRAMEBUFFER", Napi::Number::From(env, static_cast<uint32_t>(CommandType::BindFrameBuffer))),
+                InstanceValue("COMMAND_UNBINDFRAMEBUFFER", Napi::Number::From(env, static_cast<uint32_t>(CommandType::UnbindFrameBuffer))),
+                InstanceValue("COMMAND_DRAWINDEXED", Napi::Number::From(env, static_cast<uint32_t>(CommandType::DrawIndexed))),
+                InstanceValue("COMMAND_DRAW", Napi::Number::From(env, static_cast<uint32_t>(CommandType::Draw))),
+                InstanceValue("COMMAND_CLEAR", Napi::Number::From(env, static_cast<uint32_t>(CommandType::Clear))),
+                InstanceValue("COMMAND_CLEARCOLOR", Napi::Number::From(env, static_cast<uint32_t>(CommandType::ClearColor))),
+                InstanceValue("COMMAND_CLEARDEPTH", Napi::Number::From(env, static_cast<uint32_t>(CommandType::ClearDepth))),
+                InstanceValue("COMMAND_CLEARSTENCIL", Napi::Number::From(env, static_cast<uint32_t>(CommandType::ClearStencil))),
+                InstanceValue("COMMAND_SETVIEWPORT", Napi::Number::From(env, static_cast<uint32_t>(CommandType::SetViewPort))),
+                InstanceValue("COMMAND_DRAWINSTANCED", Napi::Number::From(env, static_cast<uint32_t>(CommandType::DrawInstanced))),
+
                 InstanceValue(JS_AUTO_RENDER_PROPERTY_NAME, Napi::Boolean::New(env, autoRender))});
 
         JsRuntime::NativeObject::GetFromJavaScript(env).Set(JS_ENGINE_CONSTRUCTOR_NAME, func);
@@ -498,6 +1209,19 @@ namespace Babylon
 
             try
             {
+                // Before any draw of the frame, as completed streams and the memory budget replace the textures draws
+                // refer to. Once streaming is disabled, the remaining levels are uploaded at once.
+                if (!m_textureStreamer.IsEmpty())
+                {
+                    m_textureStreamer.Update(m_textureStreamingBudget > 0 ? m_textureStreamingBudget : UINT32_MAX);
+                }
+                m_textureResidency.Update(m_frameIndex, [this] { return m_frameBufferManager.AcquireViewForBlit(); });
+                m_renderTargetPool.Trim(m_frameIndex);
+                if (!m_textureReadback.IsEmpty())
+                {
+                    m_textureReadback.Update(m_graphicsImpl.GetFrameNumber());
+                }
+
                 if (!m_requestAnimationFrameCallback.IsEmpty())
                 {
                     // We can get here from either the normal RequestAnimationFrame or the XR RequestAnimationFrame,
@@ -506,7 +1230,21 @@ namespace Babylon
                     auto callback{std::move(m_requestAnimationFrameCallback)};
                     callback({});
                 }
-                GetFrameBufferManager().Reset();
+                FlushPendingDrawsForViewChange();
+                m_frameBufferManager.FinishFrame();
+                m_frameBufferManager.Reset(m_graphicsImpl.GetResetCount());
+                m_stagingBuffers.NextFrame();
+                DetachTransientArrayBuffers();
+                m_frameIndex++;
+                m_lastSubmitted = {};
+                m_uniformShadowState.Reset();
+                m_bindingShadowState.Reset();
+
+                // Keeps frames coming until the streamed textures and the reads of pixels are complete.
+                if (!m_textureStreamer.IsEmpty() || !m_textureReadback.IsEmpty())
+                {
+                    ScheduleRender();
+                }
             }
             catch (const std::exception& ex)
             {
@@ -547,12 +1285,29 @@ namespace Babylon
         return m_frameBufferManager;
     }
 
+    void NativeEngine::OnFrameBufferDestroyed(FrameBufferData& frameBuffer)
+    {
+        m_frameBufferManager.OnFrameBufferDestroyed(frameBuffer);
+    }
+
     void NativeEngine::Dispose()
     {
         m_cancelSource.cancel();
+        m_runtimeDispatcher->Disconnect();
+
+        m_pendingDraws = {};
 
         // This collection contains bgfx data, so it must be cleared before bgfx::shutdown is called.
         m_programDataCollection.clear();
+        m_commandHandles->Clear();
+        m_textureStreamer.Clear();
+        m_textureResidency.Clear();
+        m_renderTargetPool.Clear();
+        // bgfx may still write the pixels of the pending reads, the graphics device outlives the engine and frees
+        // their memory once bgfx is done with it.
+        FreeAfterFrame(m_graphicsImpl, std::make_shared<TextureReadback::RetiredMemory>(m_textureReadback.Clear()));
+        m_pixelBuffers.clear();
+        m_transientArrayBuffers.clear();
     }
 
     void NativeEngine::Dispose(const Napi::CallbackInfo& /*info*/)
@@ -581,26 +1336,58 @@ namespace Babylon
 
     Napi::Value NativeEngine::CreateVertexArray(const Napi::CallbackInfo& info)
     {
-        return Napi::External<VertexArray>::New(info.Env(), new VertexArray{});
+        auto* vertexArray = new VertexArray{m_vertexLayoutCache};
+        m_commandHandles->Register(vertexArray);
+        return Napi::External<VertexArray>::New(info.Env(), vertexArray);
     }
 
     void NativeEngine::DeleteVertexArray(const Napi::CallbackInfo& info)
     {
-        delete info[0].As<Napi::External<VertexArray>>().Data();
+        FlushPendingDraws();
+
+        auto* vertexArray = info[0].As<Napi::External<VertexArray>>().Data();
+        if (m_currentVertexArray == vertexArray)
+        {
+            m_currentVertexArray = nullptr;
+        }
+        m_commandHandles->Unregister(vertexArray);
+        delete vertexArray;
     }
 
     void NativeEngine::BindVertexArray(const Napi::CallbackInfo& info)
     {
-        const auto& vertexArray = *(info[0].As<Napi::External<VertexArray>>().Data());
+        ThrowIfRecordingBundle();
+        BindVertexArrayInternal(*(info[0].As<Napi::External<VertexArray>>().Data()));
+    }
+
+    void NativeEngine::BindVertexArrayInternal(const VertexArray& vertexArray)
+    {
+        if (m_pendingDraws.BoundVertexArray != &vertexArray)
+        {
+            FlushPendingDraws();
+        }
+        m_currentVertexArray = &vertexArray;
 
         // a vertex array might not have an index buffer associated with
         m_currentBoundIndexBuffer = vertexArray.indexBuffer.data;
 
+        if (m_currentBoundIndexBuffer != nullptr && m_currentBoundIndexBuffer->IsExpired(m_frameIndex))
+        {
+            throw std::runtime_error{"A transient index buffer can only be used in the frame it was allocated in."};
+        }
+
         const auto& vertexBuffers = vertexArray.vertexBuffers;
         for (uint8_t index = 0; index < vertexBuffers.size(); ++index)
         {
             const auto& vertexBuffer = vertexBuffers[index];
-            vertexBuffer.data->SetAsBgfxVertexBuffer(index, vertexBuffer.startVertex, vertexBuffer.vertexLayoutHandle);
+            if (vertexBuffer.data->IsExpired(m_frameIndex))
+            {
+                throw std::runtime_error{"A transient vertex buffer can only be used in the frame it was allocated in."};
+            }
+            if (m_bindingShadowState.SetVertexBuffer(index, vertexBuffer.data->GetBindingId(), vertexBuffer.startVertex, vertexBuffer.vertexLayoutHandle.idx))
+            {
+                vertexBuffer.data->SetAsBgfxVertexBuffer(index, vertexBuffer.startVertex, vertexBuffer.vertexLayoutHandle);
+            }
         }
     }
 
@@ -609,33 +1396,159 @@ namespace Babylon
         const Napi::TypedArray data = info[0].As<Napi::TypedArray>();
         const bool dynamic = info[1].As<Napi::Boolean>().Value();
 
+        const bool optimize = !info[2].IsUndefined() && info[2].As<Napi::Boolean>().Value();
+        if (optimize && dynamic)
+        {
+            // A dynamic buffer may be updated before the reordered indices are ready, they would overwrite the update.
+            throw std::runtime_error{"Unable to optimize the indices of a dynamic index buffer."};
+        }
+
         const uint16_t flags = data.TypedArrayType() == napi_typedarray_type::napi_uint16_array ? 0 : BGFX_BUFFER_INDEX32;
 
-        return Napi::External<IndexBufferData>::New(info.Env(), new IndexBufferData(data, flags, dynamic));
+        // Dynamic buffers keep their index size, a later update may write indices that do not fit in 16 bits.
+        IndexBufferData* indexBufferData{};
+        if (m_indexNarrowingEnabled && flags == BGFX_BUFFER_INDEX32 && !dynamic)
+        {
+            const auto* indices = reinterpret_cast<const uint32_t*>(data.As<Napi::Uint8Array>().Data());
+            const size_t count = data.ElementLength();
+            if (IndicesFitIn16Bits(indices, count))
+            {
+                const bgfx::Memory* memory = bgfx::alloc(static_cast<uint32_t>(count * sizeof(uint16_t)));
+                NarrowIndices(indices, count, reinterpret_cast<uint16_t*>(memory->data));
+                indexBufferData = new IndexBufferData(memory, 0, dynamic);
+            }
+        }
+
+        if (indexBufferData == nullptr)
+        {
+            indexBufferData = new IndexBufferData(data, flags, dynamic);
+        }
+
+        if (optimize)
+        {
+            // The buffer is usable right away with the original order, and recreated once the triangles are reordered.
+            auto job = std::make_shared<IndexOptimizationJob>();
+            job->Indices = ReadIndices(data);
+
+            auto onOptimizedRef = info[3].IsUndefined() ? Napi::FunctionReference{} : Napi::Persistent(info[3].As<Napi::Function>());
+
+            arcana::make_task(arcana::threadpool_scheduler, m_cancelSource, [job]() {
+                job->Statistics = Babylon::OptimizeIndices(job->Indices, {}, {});
+            }).then(RuntimeScheduler, m_cancelSource, [job, lifetime = indexBufferData->GetLifetime(), indexBufferData, onOptimizedRef = std::move(onOptimizedRef)](arcana::expected<void, std::exception_ptr> result) {
+                // onOptimized is called in every case, with null when the buffer keeps the original order because
+                // the optimization failed or the buffer was deleted meanwhile.
+                const bool optimized = !result.has_error() && !lifetime.expired();
+                if (optimized)
+                {
+                    indexBufferData->ReplaceIndices(job->Indices);
+                }
+
+                if (!onOptimizedRef.IsEmpty())
+                {
+                    const Napi::Env env = onOptimizedRef.Env();
+                    onOptimizedRef.Call({optimized ? Napi::Value{CreateIndexOptimizationStatistics(env, job->Statistics)} : env.Null()});
+                }
+            });
+        }
+
+        return Napi::External<IndexBufferData>::New(info.Env(), indexBufferData);
+    }
+
+    void NativeEngine::OptimizeIndices(const Napi::CallbackInfo& info)
+    {
+        const auto data = info[0].As<Napi::TypedArray>();
+        const auto onSuccess = info[3].As<Napi::Function>();
+        const auto onError = info[4].As<Napi::Function>();
+
+        // The arrays are copied, so that JavaScript is free to use them until the indices are written back.
+        auto job = std::make_shared<IndexOptimizationJob>();
+        job->Indices = ReadIndices(data);
+        if (!info[1].IsUndefined() && !info[1].IsNull())
+        {
+            const auto ranges = AsSpan(info[1].As<Napi::Uint32Array>());
+            job->Ranges.assign(ranges.begin(), ranges.end());
+        }
+        if (!info[2].IsUndefined() && !info[2].IsNull())
+        {
+            const auto positions = AsSpan(info[2].As<Napi::Float32Array>());
+            job->Positions.assign(positions.begin(), positions.end());
+        }
+
+        arcana::make_task(arcana::threadpool_scheduler, m_cancelSource, [job]() {
+            job->Statistics = Babylon::OptimizeIndices(job->Indices, job->Ranges, job->Positions);
+        }).then(RuntimeScheduler, m_cancelSource, [job, dataRef = Napi::Persistent(data), onSuccessRef = Napi::Persistent(onSuccess), onErrorRef = Napi::Persistent(onError)](arcana::expected<void, std::exception_ptr> result) {
+            if (result.has_error())
+            {
+                onErrorRef.Call({});
+                return;
+            }
+
+            WriteIndices(job->Indices, dataRef.Value());
+            onSuccessRef.Call({CreateIndexOptimizationStatistics(onSuccessRef.Env(), job->Statistics)});
+        });
     }
 
     void NativeEngine::DeleteIndexBuffer(const Napi::CallbackInfo& info)
     {
+        FlushPendingDraws();
+
         IndexBufferData* indexBufferData = info[0].As<Napi::External<IndexBufferData>>().Data();
+        if (indexBufferData->IsTransient())
+        {
+            // Released by the garbage collector.
+            return;
+        }
         delete indexBufferData;
     }
 
+    Napi::Value NativeEngine::AllocTransientIndexBuffer(const Napi::CallbackInfo& info)
+    {
+#if !NATIVE_ENGINE_EXTERNAL_ARRAY_BUFFERS
+        // JavaScript could not write to the transient memory, the caller falls back to a dynamic buffer.
+        return info.Env().Undefined();
+#else
+        const uint32_t numIndices = info[0].As<Napi::Number>().Uint32Value();
+        if (bgfx::getAvailTransientIndexBuffer(numIndices) < numIndices)
+        {
+            // Not enough transient memory left in this frame, the caller falls back to a dynamic buffer.
+            return info.Env().Undefined();
+        }
+
+        bgfx::TransientIndexBuffer transientBuffer{};
+        bgfx::allocTransientIndexBuffer(&transientBuffer, numIndices);
+
+        auto buffer = std::make_shared<IndexBufferData>(transientBuffer, m_frameIndex);
+        auto* bufferData = buffer.get();
+        const auto arrayBuffer = Napi::ArrayBuffer::New(info.Env(), transientBuffer.data, transientBuffer.size);
+        m_transientArrayBuffers.push_back(Napi::Persistent(arrayBuffer));
+
+        auto result = Napi::Object::New(info.Env());
+        result.Set("buffer", Napi::External<IndexBufferData>::New(info.Env(), bufferData, [](Napi::Env, IndexBufferData*, std::shared_ptr<IndexBufferData>* owner) { delete owner; }, new std::shared_ptr<IndexBufferData>{std::move(buffer)}));
+        result.Set("data", Napi::Uint16Array::New(info.Env(), numIndices, arrayBuffer, 0));
+        return std::move(result);
+#endif
+    }
+
     void NativeEngine::RecordIndexBuffer(const Napi::CallbackInfo& info)
     {
         VertexArray& vertexArray = *(info[0].As<Napi::External<VertexArray>>().Data());
         const IndexBufferData* indexBufferData = info[1].As<Napi::External<IndexBufferData>>().Data();
 
         vertexArray.indexBuffer.data = indexBufferData;
+        vertexArray.indexBuffer.transientData = indexBufferData->ShareIfTransient();
     }
 
     void NativeEngine::UpdateDynamicIndexBuffer(const Napi::CallbackInfo& info)
     {
+        FlushPendingDraws();
+
         IndexBufferData& indexBufferData = *(info[0].As<Napi::External<IndexBufferData>>().Data());
 
         const Napi::TypedArray data = info[1].As<Napi::TypedArray>();
         const uint32_t startingIdx = info[2].As<Napi::Number>().Uint32Value();
+        const uint32_t indexCount = info[3].IsUndefined() ? static_cast<uint32_t>(data.ElementLength()) : info[3].As<Napi::Number>().Uint32Value();
 
-        indexBufferData.Update(data, startingIdx);
+        indexBufferData.Update(data, startingIdx, indexCount, m_stagingBuffers);
     }
 
     Napi::Value NativeEngine::CreateVertexBuffer(const Napi::CallbackInfo& info)
@@ -643,126 +1556,378 @@ namespace Babylon
         const Napi::Uint8Array data = info[0].As<Napi::Uint8Array>();
         const bool dynamic = info[1].As<Napi::Boolean>().Value();
 
+#if NATIVE_ENGINE_BORROW_VERTEX_BUFFERS
+        // Dynamic buffers keep a copy, since their bytes are replaced by updates made before they are created.
+        if (m_vertexBufferBorrowingEnabled && !dynamic)
+        {
+            return Napi::External<VertexBufferData>::New(info.Env(), new VertexBufferData(data, m_runtimeDispatcher));
+        }
+#endif
+
         return Napi::External<VertexBufferData>::New(info.Env(), new VertexBufferData(data, dynamic));
     }
 
     void NativeEngine::DeleteVertexBuffer(const Napi::CallbackInfo& info)
     {
+        FlushPendingDraws();
+
         auto* vertexBufferData = info[0].As<Napi::External<VertexBufferData>>().Data();
+        if (vertexBufferData->IsTransient())
+        {
+            // Released by the garbage collector.
+            return;
+        }
         delete vertexBufferData;
     }
 
-    void NativeEngine::RecordVertexBuffer(const Napi::CallbackInfo& info)
+    Napi::Value NativeEngine::AllocTransientVertexBuffer(const Napi::CallbackInfo& info)
     {
-        VertexArray& vertexArray = *(info[0].As<Napi::External<VertexArray>>().Data());
-        VertexBufferData* vertexBufferData = info[1].As<Napi::External<VertexBufferData>>().Data();
+#if !NATIVE_ENGINE_EXTERNAL_ARRAY_BUFFERS
+        // JavaScript could not write to the transient memory, the caller falls back to a dynamic buffer.
+        return info.Env().Undefined();
+#else
+        const uint32_t numVertices = info[0].As<Napi::Number>().Uint32Value();
+        const uint32_t byteStride = info[1].As<Napi::Number>().Uint32Value();
+        if (byteStride == 0 || byteStride > UINT16_MAX)
+        {
+            throw std::runtime_error{"Invalid transient vertex buffer stride."};
+        }
 
-        const uint32_t location = info[2].As<Napi::Number>().Uint32Value();
-        const uint32_t byteOffset = info[3].As<Napi::Number>().Uint32Value();
-        const uint32_t byteStride = info[4].As<Napi::Number>().Uint32Value();
-        const uint32_t numElements = info[5].As<Napi::Number>().Uint32Value();
-        const uint32_t type = info[6].As<Napi::Number>().Uint32Value();
-        const bool normalized = info[7].As<Napi::Boolean>().Value();
+        // bgfx only needs the stride to allocate the vertices, the attributes are given by recordVertexBuffer.
+        bgfx::VertexLayout layout{};
+        layout.begin();
+        layout.m_stride = static_cast<uint16_t>(byteStride);
+        layout.end();
 
-        bgfx::VertexLayout vertexLayout{};
-        vertexLayout.begin();
-        const bgfx::Attrib::Enum attrib = static_cast<bgfx::Attrib::Enum>(location);
-        const auto attribType = static_cast<bgfx::AttribType::Enum>(type);
-        vertexLayout.add(attrib, static_cast<uint8_t>(numElements), attribType, normalized);
-        vertexLayout.m_stride = static_cast<uint16_t>(byteStride);
-        vertexLayout.end();
+        if (bgfx::getAvailTransientVertexBuffer(numVertices, layout) < numVertices)
+        {
+            // Not enough transient memory left in this frame, the caller falls back to a dynamic buffer.
+            return info.Env().Undefined();
+        }
 
-        vertexBufferData->EnsureFinalized(info.Env(), vertexLayout);
+        bgfx::TransientVertexBuffer transientBuffer{};
+        bgfx::allocTransientVertexBuffer(&transientBuffer, numVertices, layout);
 
-        vertexArray.vertexBuffers.push_back({vertexBufferData, byteOffset / byteStride, bgfx::createVertexLayout(vertexLayout)});
+        auto buffer = std::make_shared<VertexBufferData>(transientBuffer, m_frameIndex);
+        auto* bufferData = buffer.get();
+        const auto arrayBuffer = Napi::ArrayBuffer::New(info.Env(), transientBuffer.data, transientBuffer.size);
+        m_transientArrayBuffers.push_back(Napi::Persistent(arrayBuffer));
+
+        auto result = Napi::Object::New(info.Env());
+        result.Set("buffer", Napi::External<VertexBufferData>::New(info.Env(), bufferData, [](Napi::Env, VertexBufferData*, std::shared_ptr<VertexBufferData>* owner) { delete owner; }, new std::shared_ptr<VertexBufferData>{std::move(buffer)}));
+        result.Set("data", Napi::Uint8Array::New(info.Env(), transientBuffer.size, arrayBuffer, 0));
+        return std::move(result);
+#endif
     }
 
-    void NativeEngine::UpdateDynamicVertexBuffer(const Napi::CallbackInfo& info)
+    void NativeEngine::DetachTransientArrayBuffers()
     {
-        VertexBufferData& vertexBufferData = *(info[0].As<Napi::External<VertexBufferData>>().Data());
-        const Napi::Uint8Array data = info[1].As<Napi::Uint8Array>();
-        const uint32_t byteOffset = info[2].As<Napi::Number>().Uint32Value();
-
-        uint32_t byteLength = info[2].As<Napi::Number>().Uint32Value();
-        if (byteLength == 0)
+#if NATIVE_ENGINE_EXTERNAL_ARRAY_BUFFERS
+        // bgfx reuses the transient memory in later frames, JavaScript must not write to it past this frame.
+        for (const auto& reference : m_transientArrayBuffers)
         {
-            byteLength = static_cast<uint32_t>(data.ByteLength());
+            const Napi::ArrayBuffer arrayBuffer = reference.Value();
+            if (napi_detach_arraybuffer(arrayBuffer.Env(), arrayBuffer) != napi_ok)
+            {
+                throw std::runtime_error{"Failed to detach the array buffer of a transient buffer."};
+            }
         }
-
-        vertexBufferData.Update(data, byteOffset, byteLength);
+#endif
+        m_transientArrayBuffers.clear();
     }
 
-    Napi::Value NativeEngine::CreateProgram(const Napi::CallbackInfo& info)
+    void NativeEngine::RecordVertexBuffer(const Napi::CallbackInfo& info)
     {
-        const std::string vertexSource{info[0].As<Napi::String>().Utf8Value()};
-        const std::string fragmentSource{info[1].As<Napi::String>().Utf8Value()};
+        VertexArray& vertexArray = *(info[0].As<Napi::External<VertexArray>>().Data());
+        VertexBufferData* vertexBufferData = info[1].As<Napi::External<VertexBufferData>>().Data();
 
-        std::unique_ptr<ProgramData> programData{std::make_unique<ProgramData>()};
-        ShaderCompiler::BgfxShaderInfo shaderInfo{m_shaderCompiler.Compile(vertexSource, fragmentSource)};
+        const uint32_t location = info[2].As<Napi::Number>().Uint32Value();
+        uint32_t byteOffset = info[3].As<Napi::Number>().Uint32Value();
+        uint32_t byteStride = info[4].As<Napi::Number>().Uint32Value();
+        uint32_t numElements = info[5].As<Napi::Number>().Uint32Value();
+        uint32_t type = info[6].As<Napi::Number>().Uint32Value();
+        bool normalized = info[7].As<Napi::Boolean>().Value();
+        const uint32_t divisor = info[8].IsUndefined() ? 0 : info[8].As<Napi::Number>().Uint32Value();
+
+        if (divisor != 0)
+        {
+            RecordInstanceAttribute(info.Env(), vertexArray, vertexBufferData, location, byteOffset, byteStride, numElements, type, divisor);
+            return;
+        }
 
-        static auto InitUniformInfos{[](bgfx::ShaderHandle shader, const std::unordered_map<std::string, uint8_t>& uniformStages, std::unordered_map<std::string, UniformInfo>& uniformInfos) {
-            auto numUniforms = bgfx::getShaderUniforms(shader);
-            std::vector<bgfx::UniformHandle> uniforms{numUniforms};
-            bgfx::getShaderUniforms(shader, uniforms.data(), gsl::narrow_cast<uint16_t>(uniforms.size()));
+        const VertexQuantization quantization = location < m_attributeQuantization.size() ? m_attributeQuantization[location] : VertexQuantization::None;
+        if (const auto quantizedFormat = vertexBufferData->Quantize(quantization, byteOffset, byteStride, numElements, type, normalized))
+        {
+            byteOffset = byteOffset / byteStride * quantizedFormat->ByteStride;
+            byteStride = quantizedFormat->ByteStride;
+            numElements = quantizedFormat->NumElements;
+            type = static_cast<uint32_t>(quantizedFormat->Type);
+            normalized = quantizedFormat->Normalized;
+        }
 
-            for (uint8_t index = 0; index < numUniforms; index++)
+        const uint32_t startVertex = byteOffset / byteStride;
+        const VertexArray::VertexAttribute attribute{
+            static_cast<bgfx::Attrib::Enum>(location),
+            static_cast<uint8_t>(numElements),
+            static_cast<bgfx::AttribType::Enum>(type),
+            normalized,
+            byteOffset % byteStride};
+
+        // Attributes interleaved in the same buffer are read through a single stream.
+        auto& vertexBuffers = vertexArray.vertexBuffers;
+        const auto stream = std::find_if(vertexBuffers.begin(), vertexBuffers.end(), [&](const VertexArray::VertexBuffer& vertexBuffer) {
+            return vertexBuffer.data == vertexBufferData && vertexBuffer.byteStride == byteStride && vertexBuffer.startVertex == startVertex;
+        });
+
+        if (stream != vertexBuffers.end())
+        {
+            auto attributes = stream->attributes;
+            attributes.push_back(attribute);
+
+            bgfx::VertexLayout vertexLayout{};
+            if (BuildVertexLayout(attributes, byteStride, vertexLayout))
             {
-                bgfx::UniformInfo info{};
-                bgfx::getUniformInfo(uniforms[index], info);
-                auto itStage = uniformStages.find(info.name);
-                uniformInfos[info.name] = {itStage == uniformStages.end() ? uint8_t{} : itStage->second, uniforms[index]};
-                bool YFlip{false};
-                if (!bgfx::getCaps()->originBottomLeft)
-                {
-                    YFlip = (!strcmp(info.name, "projection")) || (!strcmp(info.name, "viewProjection"));
-                }
-                uniformInfos[info.name].YFlip = YFlip;
+                m_vertexLayoutCache->Release(stream->vertexLayoutHandle);
+                stream->vertexLayoutHandle = m_vertexLayoutCache->Acquire(vertexLayout);
+                stream->attributes = std::move(attributes);
+                return;
             }
-        }};
+        }
 
-        auto vertexShader = bgfx::createShader(bgfx::copy(shaderInfo.VertexBytes.data(), static_cast<uint32_t>(shaderInfo.VertexBytes.size())));
-        InitUniformInfos(vertexShader, shaderInfo.VertexUniformStages, programData->VertexUniformInfos);
-        programData->VertexAttributeLocations = std::move(shaderInfo.VertexAttributeLocations);
+        std::vector<VertexArray::VertexAttribute> attributes{attribute};
+        bgfx::VertexLayout vertexLayout{};
+        if (!BuildVertexLayout(attributes, byteStride, vertexLayout))
+        {
+            throw std::runtime_error{"Vertex attribute does not fit in the vertex stride."};
+        }
 
-        auto fragmentShader = bgfx::createShader(bgfx::copy(shaderInfo.FragmentBytes.data(), static_cast<uint32_t>(shaderInfo.FragmentBytes.size())));
-        InitUniformInfos(fragmentShader, shaderInfo.FragmentUniformStages, programData->FragmentUniformInfos);
+        vertexBufferData->EnsureFinalized(info.Env(), vertexLayout);
 
-        programData->Program = bgfx::createProgram(vertexShader, fragmentShader, true);
-        auto* rawProgramData = programData.get();
-        auto ticket = m_programDataCollection.insert(std::move(programData));
-        auto finalizer = [ticket = std::move(ticket)](Napi::Env, ProgramData*) {};
-        return Napi::External<ProgramData>::New(info.Env(), rawProgramData, std::move(finalizer));
+        vertexBuffers.push_back({vertexBufferData, startVertex, byteStride, std::move(attributes), m_vertexLayoutCache->Acquire(vertexLayout), vertexBufferData->ShareIfTransient()});
     }
 
-    Napi::Value NativeEngine::GetUniforms(const Napi::CallbackInfo& info)
+    void NativeEngine::RecordInstanceAttribute(Napi::Env env, VertexArray& vertexArray, VertexBufferData* vertexBufferData, uint32_t location, uint32_t byteOffset, uint32_t byteStride, uint32_t numElements, uint32_t type, uint32_t divisor)
     {
-        const auto program = info[0].As<Napi::External<ProgramData>>().Data();
-        const auto names = info[1].As<Napi::Array>();
-
-        auto length = names.Length();
-        auto uniforms = Napi::Array::New(info.Env(), length);
-        for (uint32_t index = 0; index < length; ++index)
+        // bgfx reads per-instance attributes from up to 5 float4 instance data registers, all from one buffer.
+        constexpr uint32_t maxInstanceRegisters{5};
+        if (divisor != 1)
         {
-            const auto name = names[index].As<Napi::String>().Utf8Value();
+            throw std::runtime_error{"Per-instance attributes with a divisor greater than 1 are not supported."};
+        }
+        if (type != static_cast<uint32_t>(bgfx::AttribType::Float) || numElements == 0 || numElements > 4)
+        {
+            throw std::runtime_error{"Per-instance attributes must be 1 to 4 floats."};
+        }
 
-            auto vertexFound = program->VertexUniformInfos.find(name);
-            auto fragmentFound = program->FragmentUniformInfos.find(name);
+        vertexBufferData->EnsureFinalizedAsInstanceData(env, byteStride);
+
+        auto& attributes = vertexArray.instanceAttributes;
+        attributes.erase(std::remove_if(attributes.begin(), attributes.end(), [location](const VertexArray::InstanceAttribute& attribute) {
+            return attribute.location == location;
+        }), attributes.end());
+        attributes.push_back({vertexBufferData, location, byteOffset / byteStride, byteStride, byteOffset % byteStride, numElements * 4});
+        attributes.back().transientData = vertexBufferData->ShareIfTransient();
+
+        // The attributes are read straight from their buffer when each one starts a register of the records bgfx
+        // reads. Otherwise they are gathered into transient instance data, one register per attribute.
+        const auto& first = attributes.front();
+        bool direct = first.data->GetByteStride() == first.byteStride && first.byteStride % 16 == 0 && !first.data->IsTransient();
+        uint32_t registerMask = 0;
+        for (const auto& attribute : attributes)
+        {
+            const uint32_t instanceRegister = attribute.offset / 16;
+            direct = direct && attribute.data == first.data && attribute.startInstance == first.startInstance && attribute.byteStride == first.byteStride &&
+                     attribute.offset % 16 == 0 && instanceRegister < maxInstanceRegisters && (registerMask & (1u << instanceRegister)) == 0;
+            registerMask |= instanceRegister < maxInstanceRegisters ? 1u << instanceRegister : 0;
+        }
 
-            if (vertexFound != program->VertexUniformInfos.end())
-            {
-                uniforms[index] = Napi::External<UniformInfo>::New(info.Env(), &vertexFound->second);
-            }
-            else if (fragmentFound != program->FragmentUniformInfos.end())
+        if (!direct)
+        {
+            if (attributes.size() > maxInstanceRegisters)
             {
-                uniforms[index] = Napi::External<UniformInfo>::New(info.Env(), &fragmentFound->second);
+                throw std::runtime_error{"At most 5 per-instance attributes are supported."};
             }
-            else
+
+            for (const auto& attribute : attributes)
             {
-                uniforms[index] = info.Env().Null();
+                if (!attribute.data->KeepsInstanceBytes())
+                {
+                    throw std::runtime_error{"Per-instance attributes must come from a single buffer when it was first used as vertex data."};
+                }
             }
         }
 
-        return std::move(uniforms);
+        for (uint32_t index = 0; index < attributes.size(); ++index)
+        {
+            attributes[index].instanceRegister = direct ? attributes[index].offset / 16 : index;
+        }
+        vertexArray.directInstanceData = direct;
+    }
+
+    void NativeEngine::UpdateDynamicVertexBuffer(const Napi::CallbackInfo& info)
+    {
+        FlushPendingDraws();
+
+        VertexBufferData& vertexBufferData = *(info[0].As<Napi::External<VertexBufferData>>().Data());
+        const Napi::Uint8Array data = info[1].As<Napi::Uint8Array>();
+        const uint32_t byteOffset = info[2].As<Napi::Number>().Uint32Value();
+
+        const uint32_t dataLength = static_cast<uint32_t>(data.ByteLength());
+        const uint32_t byteLength = info[3].IsUndefined() ? 0 : info[3].As<Napi::Number>().Uint32Value();
+
+        // Same as ThinEngine.updateDynamicVertexBuffer: without a byte length, the whole array is written at byteOffset in
+        // the buffer. With one, the byteLength bytes at byteOffset in the array are written at the start of the buffer.
+        if (byteLength == 0 || (byteLength >= dataLength && byteOffset == 0))
+        {
+            vertexBufferData.Update(data.Data(), dataLength, byteOffset, m_stagingBuffers);
+        }
+        else
+        {
+            if (byteLength > dataLength || byteOffset > dataLength - byteLength)
+            {
+                throw std::runtime_error{"Update range exceeds the length of the vertex data."};
+            }
+            vertexBufferData.Update(data.Data() + byteOffset, byteLength, 0, m_stagingBuffers);
+        }
+    }
+
+    Napi::Value NativeEngine::CreateInstanceBuffer(const Napi::CallbackInfo& info)
+    {
+        const Napi::TypedArray data = info[0].As<Napi::TypedArray>();
+        const uint32_t byteStride = info[1].As<Napi::Number>().Uint32Value();
+
+        const auto bytes = Napi::Uint8Array::New(info.Env(), data.ByteLength(), data.ArrayBuffer(), data.ByteOffset());
+        auto* vertexBufferData = new VertexBufferData(bytes, true);
+        vertexBufferData->EnsureFinalizedAsInstanceData(info.Env(), byteStride);
+
+        return Napi::External<VertexBufferData>::New(info.Env(), vertexBufferData);
+    }
+
+    void NativeEngine::UpdateInstanceBuffer(const Napi::CallbackInfo& info)
+    {
+        VertexBufferData& vertexBufferData = *(info[0].As<Napi::External<VertexBufferData>>().Data());
+        const Napi::TypedArray data = info[1].As<Napi::TypedArray>();
+        const uint32_t startInstance = info[2].As<Napi::Number>().Uint32Value();
+        const uint32_t byteStride = info[3].As<Napi::Number>().Uint32Value();
+
+        const auto* bytes = static_cast<const uint8_t*>(data.ArrayBuffer().Data()) + data.ByteOffset();
+        vertexBufferData.UpdateVertices(bytes, static_cast<uint32_t>(data.ByteLength()), startInstance, byteStride, m_stagingBuffers);
+    }
+
+    Napi::Value NativeEngine::CreateProgram(const Napi::CallbackInfo& info)
+    {
+        const std::string vertexSource{info[0].As<Napi::String>().Utf8Value()};
+        const std::string fragmentSource{info[1].As<Napi::String>().Utf8Value()};
+
+        std::unique_ptr<ProgramData> programData{CreateProgramData(vertexSource, fragmentSource)};
+        InitAutoInstancing(*programData);
+
+        // The uniforms are registered with the program, the maps holding them no longer change.
+        auto* rawProgramData = programData.get();
+        m_commandHandles->Register(rawProgramData);
+        for (const auto& [name, uniform] : rawProgramData->VertexUniformInfos)
+        {
+            m_commandHandles->Register(&uniform);
+        }
+        for (const auto& [name, uniform] : rawProgramData->FragmentUniformInfos)
+        {
+            m_commandHandles->Register(&uniform);
+        }
+
+        auto ticket = m_programDataCollection.insert(std::move(programData));
+        auto finalizer = [ticket = std::move(ticket), commandHandles = std::weak_ptr<CommandHandleTable>{m_commandHandles}](Napi::Env, ProgramData* program) {
+            // The engine, and the table with it, may be gone already.
+            if (const auto handles = commandHandles.lock())
+            {
+                handles->Unregister(program);
+                for (const auto& [name, uniform] : program->VertexUniformInfos)
+                {
+                    handles->Unregister(&uniform);
+                }
+                for (const auto& [name, uniform] : program->FragmentUniformInfos)
+                {
+                    handles->Unregister(&uniform);
+                }
+            }
+        };
+        return Napi::External<ProgramData>::New(info.Env(), rawProgramData, std::move(finalizer));
+    }
+
+    std::unique_ptr<ProgramData> NativeEngine::CreateProgramData(std::string_view vertexSource, std::string_view fragmentSource, const std::vector<std::string>& instanceAttributes, const std::string& perInstanceUniform)
+    {
+        std::unique_ptr<ProgramData> programData{std::make_unique<ProgramData>()};
+        ShaderCompiler::BgfxShaderInfo shaderInfo{m_shaderCompiler.Compile(vertexSource, fragmentSource, instanceAttributes, perInstanceUniform)};
+
+        static auto InitUniformInfos{[](bgfx::ShaderHandle shader, const std::unordered_map<std::string, uint8_t>& uniformStages, const std::unordered_map<std::string, uint16_t>& registerCounts, ProgramData& programData, std::unordered_map<std::string, UniformInfo>& uniformInfos) {
+            auto numUniforms = bgfx::getShaderUniforms(shader);
+            std::vector<bgfx::UniformHandle> uniforms{numUniforms};
+            bgfx::getShaderUniforms(shader, uniforms.data(), gsl::narrow_cast<uint16_t>(uniforms.size()));
+
+            for (uint8_t index = 0; index < numUniforms; index++)
+            {
+                bgfx::UniformInfo info{};
+                bgfx::getUniformInfo(uniforms[index], info);
+                auto itStage = uniformStages.find(info.name);
+                uniformInfos[info.name] = {itStage == uniformStages.end() ? uint8_t{} : itStage->second, uniforms[index]};
+                bool YFlip{false};
+                if (!bgfx::getCaps()->originBottomLeft)
+                {
+                    YFlip = (!strcmp(info.name, "projection")) || (!strcmp(info.name, "viewProjection"));
+                }
+                uniformInfos[info.name].YFlip = YFlip;
+
+                if (info.type != bgfx::UniformType::Sampler)
+                {
+                    auto itRegisterCount = registerCounts.find(info.name);
+                    const uint16_t registersPerElement = info.type == bgfx::UniformType::Mat4 ? 4 : info.type == bgfx::UniformType::Mat3 ? 3 : 1;
+                    const uint16_t registerCount = itRegisterCount == registerCounts.end() ? static_cast<uint16_t>(std::max<uint16_t>(info.num, 1) * registersPerElement) : itRegisterCount->second;
+                    programData.AddUniform(uniforms[index], info.type, registerCount, YFlip);
+                }
+            }
+        }};
+
+        auto vertexShader = bgfx::createShader(bgfx::copy(shaderInfo.VertexBytes.data(), static_cast<uint32_t>(shaderInfo.VertexBytes.size())));
+        InitUniformInfos(vertexShader, shaderInfo.VertexUniformStages, shaderInfo.UniformRegisterCounts, *programData, programData->VertexUniformInfos);
+        programData->VertexAttributeLocations = std::move(shaderInfo.VertexAttributeLocations);
+
+        auto fragmentShader = bgfx::createShader(bgfx::copy(shaderInfo.FragmentBytes.data(), static_cast<uint32_t>(shaderInfo.FragmentBytes.size())));
+        InitUniformInfos(fragmentShader, shaderInfo.FragmentUniformStages, shaderInfo.UniformRegisterCounts, *programData, programData->FragmentUniformInfos);
+
+        programData->Program = bgfx::createProgram(vertexShader, fragmentShader, true);
+        programData->VertexSource = vertexSource;
+        programData->FragmentSource = fragmentSource;
+        return programData;
+    }
+
+    Napi::Value NativeEngine::GetUniforms(const Napi::CallbackInfo& info)
+    {
+        const auto program = info[0].As<Napi::External<ProgramData>>().Data();
+        const auto names = info[1].As<Napi::Array>();
+
+        auto length = names.Length();
+        auto uniforms = Napi::Array::New(info.Env(), length);
+        for (uint32_t index = 0; index < length; ++index)
+        {
+            const auto name = names[index].As<Napi::String>().Utf8Value();
+
+            auto vertexFound = program->VertexUniformInfos.find(name);
+            auto fragmentFound = program->FragmentUniformInfos.find(name);
+
+            if (vertexFound != program->VertexUniformInfos.end())
+            {
+                uniforms[index] = Napi::External<UniformInfo>::New(info.Env(), &vertexFound->second);
+            }
+            else if (fragmentFound != program->FragmentUniformInfos.end())
+            {
+                uniforms[index] = Napi::External<UniformInfo>::New(info.Env(), &fragmentFound->second);
+            }
+            else
+            {
+                uniforms[index] = info.Env().Null();
+            }
+        }
+
+        return std::move(uniforms);
     }
 
     Napi::Value NativeEngine::GetAttributes(const Napi::CallbackInfo& info)
@@ -787,15 +1952,24 @@ namespace Babylon
 
     void NativeEngine::SetProgram(const Napi::CallbackInfo& info)
     {
-        auto program = info[0].As<Napi::External<ProgramData>>().Data();
-        m_currentProgram = program;
+        ThrowIfRecordingBundle();
+        SetProgramInternal(info[0].As<Napi::External<ProgramData>>().Data());
     }
 
     void NativeEngine::SetState(const Napi::CallbackInfo& info)
     {
+        ThrowIfRecordingBundle();
         const auto culling = info[0].As<Napi::Boolean>().Value();
         const auto reverseSide = info[2].As<Napi::Boolean>().Value();
 
+        SetStateInternal(culling, reverseSide);
+
+        // TODO: zOffset
+        //const auto zOffset = info[1].As<Napi::Number>().FloatValue();
+    }
+
+    void NativeEngine::SetStateInternal(bool culling, bool reverseSide)
+    {
         m_engineState &= ~BGFX_STATE_CULL_MASK;
         if (reverseSide)
         {
@@ -815,9 +1989,6 @@ namespace Babylon
                 m_engineState |= BGFX_STATE_CULL_CCW;
             }
         }
-
-        // TODO: zOffset
-        //const auto zOffset = info[1].As<Napi::Number>().FloatValue();
     }
 
     void NativeEngine::SetZOffset(const Napi::CallbackInfo& /*info*/)
@@ -835,8 +2006,12 @@ namespace Babylon
 
     void NativeEngine::SetDepthTest(const Napi::CallbackInfo& info)
     {
-        const auto depthTest = info[0].As<Napi::Number>().Uint32Value();
+        ThrowIfRecordingBundle();
+        SetDepthTestInternal(info[0].As<Napi::Number>().Uint32Value());
+    }
 
+    void NativeEngine::SetDepthTestInternal(uint32_t depthTest)
+    {
         m_engineState &= ~BGFX_STATE_DEPTH_TEST_MASK;
         m_engineState |= depthTest;
     }
@@ -848,42 +2023,52 @@ namespace Babylon
 
     void NativeEngine::SetDepthWrite(const Napi::CallbackInfo& info)
     {
-        const auto enable = info[0].As<Napi::Boolean>().Value();
+        ThrowIfRecordingBundle();
+        SetDepthWriteInternal(info[0].As<Napi::Boolean>().Value());
+    }
 
+    void NativeEngine::SetDepthWriteInternal(bool enable)
+    {
         m_engineState &= ~BGFX_STATE_WRITE_Z;
         m_engineState |= enable ? BGFX_STATE_WRITE_Z : 0;
     }
 
     void NativeEngine::SetColorWrite(const Napi::CallbackInfo& info)
     {
-        const auto enable = info[0].As<Napi::Boolean>().Value();
+        ThrowIfRecordingBundle();
+        SetColorWriteInternal(info[0].As<Napi::Boolean>().Value());
+    }
 
+    void NativeEngine::SetColorWriteInternal(bool enable)
+    {
         m_engineState &= ~(BGFX_STATE_WRITE_RGB | BGFX_STATE_WRITE_A);
         m_engineState |= enable ? (BGFX_STATE_WRITE_RGB | BGFX_STATE_WRITE_A) : 0;
     }
 
     void NativeEngine::SetBlendMode(const Napi::CallbackInfo& info)
     {
-        const auto blendMode = info[0].As<Napi::Number>().Int64Value();
+        ThrowIfRecordingBundle();
+        SetBlendModeInternal(static_cast<uint64_t>(info[0].As<Napi::Number>().Int64Value()));
+    }
 
+    void NativeEngine::SetBlendModeInternal(uint64_t blendMode)
+    {
         m_engineState &= ~BGFX_STATE_BLEND_MASK;
         m_engineState |= blendMode;
     }
 
     void NativeEngine::SetInt(const Napi::CallbackInfo& info)
     {
+        ThrowIfRecordingBundle();
         const auto uniformInfo = info[0].As<Napi::External<UniformInfo>>().Data();
         const auto value = info[1].As<Napi::Number>().FloatValue();
-        m_currentProgram->SetUniform(uniformInfo->Handle, gsl::make_span(&value, 1), uniformInfo->YFlip);
+        SetUniformValue(uniformInfo->Handle, gsl::make_span(&value, 1));
     }
 
-    template<int size, typename arrayType>
-    void NativeEngine::SetTypeArrayN(const Napi::CallbackInfo& info)
+    template<int size, typename elementType>
+    void NativeEngine::SetTypeArrayN(const UniformInfo& uniformInfo, gsl::span<const elementType> array)
     {
-        const auto uniformInfo = info[0].As<Napi::External<UniformInfo>>().Data();
-        const auto array = info[1].As<arrayType>();
-
-        size_t elementLength = array.ElementLength();
+        const size_t elementLength = static_cast<size_t>(array.size());
 
         m_scratch.clear();
         for (size_t index = 0; index < elementLength; index += size)
@@ -897,30 +2082,26 @@ namespace Babylon
             m_scratch.insert(m_scratch.end(), values, values + 4);
         }
 
-        m_currentProgram->SetUniform(uniformInfo->Handle, m_scratch, uniformInfo->YFlip, elementLength / size);
+        SetUniformValue(uniformInfo.Handle, m_scratch, elementLength / size);
     }
 
     template<int size>
-    void NativeEngine::SetFloatN(const Napi::CallbackInfo& info)
+    void NativeEngine::SetFloatN(const UniformInfo& uniformInfo, const float* values)
     {
-        const auto uniformInfo = info[0].As<Napi::External<UniformInfo>>().Data();
-        const float values[] = {
-            info[1].As<Napi::Number>().FloatValue(),
-            (size > 1) ? info[2].As<Napi::Number>().FloatValue() : 0.f,
-            (size > 2) ? info[3].As<Napi::Number>().FloatValue() : 0.f,
-            (size > 3) ? info[4].As<Napi::Number>().FloatValue() : 0.f,
+        const float paddedValues[] = {
+            values[0],
+            (size > 1) ? values[1] : 0.f,
+            (size > 2) ? values[2] : 0.f,
+            (size > 3) ? values[3] : 0.f,
         };
 
-        m_currentProgram->SetUniform(uniformInfo->Handle, values, uniformInfo->YFlip);
+        SetUniformValue(uniformInfo.Handle, paddedValues);
     }
 
     template<int size>
-    void NativeEngine::SetMatrixN(const Napi::CallbackInfo& info)
+    void NativeEngine::SetMatrixN(const UniformInfo& uniformInfo, gsl::span<const float> matrix)
     {
-        const auto uniformInfo = info[0].As<Napi::External<UniformInfo>>().Data();
-        const auto matrix = info[1].As<Napi::Float32Array>();
-
-        const size_t elementLength = matrix.ElementLength();
+        const size_t elementLength = static_cast<size_t>(matrix.size());
         assert(elementLength == size * size);
 
         if constexpr (size < 4)
@@ -936,103 +2117,121 @@ namespace Babylon
                 }
             }
 
-            m_currentProgram->SetUniform(uniformInfo->Handle, gsl::make_span(matrixValues.data(), 16), uniformInfo->YFlip);
+            SetUniformValue(uniformInfo.Handle, gsl::make_span(matrixValues.data(), 16));
         }
         else
         {
-            m_currentProgram->SetUniform(uniformInfo->Handle, gsl::make_span(matrix.Data(), elementLength), uniformInfo->YFlip);
+            SetUniformValue(uniformInfo.Handle, gsl::make_span(matrix.data(), elementLength));
         }
     }
 
     void NativeEngine::SetIntArray(const Napi::CallbackInfo& info)
     {
-        SetTypeArrayN<1, Napi::Int32Array>(info);
+        ThrowIfRecordingBundle();
+        SetTypeArrayN<1>(*info[0].As<Napi::External<UniformInfo>>().Data(), AsSpan(info[1].As<Napi::Int32Array>()));
     }
 
     void NativeEngine::SetIntArray2(const Napi::CallbackInfo& info)
     {
-        SetTypeArrayN<2, Napi::Int32Array>(info);
+        ThrowIfRecordingBundle();
+        SetTypeArrayN<2>(*info[0].As<Napi::External<UniformInfo>>().Data(), AsSpan(info[1].As<Napi::Int32Array>()));
     }
 
     void NativeEngine::SetIntArray3(const Napi::CallbackInfo& info)
     {
-        SetTypeArrayN<3, Napi::Int32Array>(info);
+        ThrowIfRecordingBundle();
+        SetTypeArrayN<3>(*info[0].As<Napi::External<UniformInfo>>().Data(), AsSpan(info[1].As<Napi::Int32Array>()));
     }
 
     void NativeEngine::SetIntArray4(const Napi::CallbackInfo& info)
     {
-        SetTypeArrayN<4, Napi::Int32Array>(info);
+        ThrowIfRecordingBundle();
+        SetTypeArrayN<4>(*info[0].As<Napi::External<UniformInfo>>().Data(), AsSpan(info[1].As<Napi::Int32Array>()));
     }
 
     void NativeEngine::SetFloatArray(const Napi::CallbackInfo& info)
     {
-        SetTypeArrayN<1, Napi::Float32Array>(info);
+        ThrowIfRecordingBundle();
+        SetTypeArrayN<1>(*info[0].As<Napi::External<UniformInfo>>().Data(), AsSpan(info[1].As<Napi::Float32Array>()));
     }
 
     void NativeEngine::SetFloatArray2(const Napi::CallbackInfo& info)
     {
-        SetTypeArrayN<2, Napi::Float32Array>(info);
+        ThrowIfRecordingBundle();
+        SetTypeArrayN<2>(*info[0].As<Napi::External<UniformInfo>>().Data(), AsSpan(info[1].As<Napi::Float32Array>()));
     }
 
     void NativeEngine::SetFloatArray3(const Napi::CallbackInfo& info)
     {
-        SetTypeArrayN<3, Napi::Float32Array>(info);
+        ThrowIfRecordingBundle();
+        SetTypeArrayN<3>(*info[0].As<Napi::External<UniformInfo>>().Data(), AsSpan(info[1].As<Napi::Float32Array>()));
     }
 
     void NativeEngine::SetFloatArray4(const Napi::CallbackInfo& info)
     {
-        SetTypeArrayN<4, Napi::Float32Array>(info);
+        ThrowIfRecordingBundle();
+        SetTypeArrayN<4>(*info[0].As<Napi::External<UniformInfo>>().Data(), AsSpan(info[1].As<Napi::Float32Array>()));
     }
 
     void NativeEngine::SetMatrices(const Napi::CallbackInfo& info)
     {
+        ThrowIfRecordingBundle();
         const auto uniformInfo = info[0].As<Napi::External<UniformInfo>>().Data();
         const auto matricesArray = info[1].As<Napi::Float32Array>();
 
         const size_t elementLength = matricesArray.ElementLength();
         assert(elementLength % 16 == 0);
 
-        m_currentProgram->SetUniform(uniformInfo->Handle, gsl::span(matricesArray.Data(), elementLength), uniformInfo->YFlip, elementLength / 16);
+        SetUniformValue(uniformInfo->Handle, gsl::span(matricesArray.Data(), elementLength), elementLength / 16);
     }
 
     void NativeEngine::SetMatrix2x2(const Napi::CallbackInfo& info)
     {
-        SetMatrixN<2>(info);
+        ThrowIfRecordingBundle();
+        SetMatrixN<2>(*info[0].As<Napi::External<UniformInfo>>().Data(), AsSpan(info[1].As<Napi::Float32Array>()));
     }
 
     void NativeEngine::SetMatrix3x3(const Napi::CallbackInfo& info)
     {
-        SetMatrixN<3>(info);
+        ThrowIfRecordingBundle();
+        SetMatrixN<3>(*info[0].As<Napi::External<UniformInfo>>().Data(), AsSpan(info[1].As<Napi::Float32Array>()));
     }
 
     void NativeEngine::SetMatrix(const Napi::CallbackInfo& info)
     {
-        SetMatrixN<4>(info);
+        ThrowIfRecordingBundle();
+        SetMatrixN<4>(*info[0].As<Napi::External<UniformInfo>>().Data(), AsSpan(info[1].As<Napi::Float32Array>()));
     }
 
     void NativeEngine::SetFloat(const Napi::CallbackInfo& info)
     {
-        SetFloatN<1>(info);
+        ThrowIfRecordingBundle();
+        SetFloatN<1>(*info[0].As<Napi::External<UniformInfo>>().Data(), GetFloatArguments<1>(info).data());
     }
 
     void NativeEngine::SetFloat2(const Napi::CallbackInfo& info)
     {
-        SetFloatN<2>(info);
+        ThrowIfRecordingBundle();
+        SetFloatN<2>(*info[0].As<Napi::External<UniformInfo>>().Data(), GetFloatArguments<2>(info).data());
     }
 
     void NativeEngine::SetFloat3(const Napi::CallbackInfo& info)
     {
-        SetFloatN<3>(info);
+        ThrowIfRecordingBundle();
+        SetFloatN<3>(*info[0].As<Napi::External<UniformInfo>>().Data(), GetFloatArguments<3>(info).data());
     }
 
     void NativeEngine::SetFloat4(const Napi::CallbackInfo& info)
     {
-        SetFloatN<4>(info);
+        ThrowIfRecordingBundle();
+        SetFloatN<4>(*info[0].As<Napi::External<UniformInfo>>().Data(), GetFloatArguments<4>(info).data());
     }
 
     Napi::Value NativeEngine::CreateTexture(const Napi::CallbackInfo& info)
     {
-        return Napi::External<TextureData>::New(info.Env(), new TextureData());
+        auto* texture = new TextureData();
+        m_commandHandles->Register(texture);
+        return Napi::External<TextureData>::New(info.Env(), texture);
     }
 
     Napi::Value NativeEngine::CreateDepthTexture(const Napi::CallbackInfo& info)
@@ -1062,42 +2261,82 @@ namespace Babylon
         const auto invertY = info[3].As<Napi::Boolean>().Value();
         const auto onSuccess = info[4].As<Napi::Function>();
         const auto onError = info[5].As<Napi::Function>();
+        const auto srgb = !info[6].IsUndefined() && info[6].As<Napi::Boolean>().Value();
+        const auto premultiplyAlpha = !info[7].IsUndefined() && info[7].As<Napi::Boolean>().Value();
+        const auto onCompleteRef = std::make_shared<Napi::FunctionReference>(info[8].IsUndefined() ? Napi::FunctionReference{} : Napi::Persistent(info[8].As<Napi::Function>()));
 
         const auto dataSpan = gsl::make_span(static_cast<uint8_t*>(data.ArrayBuffer().Data()) + data.ByteOffset(), data.ByteLength());
+        const auto compressionFormats = SelectTextureCompressionFormats(m_textureCompression, *bgfx::getCaps());
+        const ImageProcessingOptions processingOptions{invertY, premultiplyAlpha, m_imageNarrowingEnabled, generateMips, m_mipFilter, srgb};
+        const uint32_t streamingInitialSize = m_textureStreamingBudget > 0 ? m_textureStreamingInitialSize : 0;
+        const auto created = std::make_shared<CreatedTexture>();
 
         arcana::make_task(arcana::threadpool_scheduler, m_cancelSource,
-            [this, dataSpan, generateMips, invertY]() {
-                bimg::ImageContainer* image = bimg::imageParse(&m_allocator, dataSpan.data(), static_cast<uint32_t>(dataSpan.size()));
-                if (image == nullptr)
-                {
-                    throw std::runtime_error("Unable to decode image."); // exeption will be forwarded to JS
-                }
-                if (invertY)
-                {
-                    FlipY(image);
-                }
-                if (generateMips)
-                {
-                    GenerateMips(&m_allocator, &image);
-                }
-                return image;
+            [this, dataSpan, processingOptions, compressionFormats, cache = m_textureCache]() {
+                return LoadTextureImage(&m_allocator, dataSpan, processingOptions, compressionFormats, cache.get());
             })
-            .then(arcana::inline_scheduler, arcana::cancellation::none(), [this, texture](bimg::ImageContainer* image) {
+            .then(arcana::inline_scheduler, arcana::cancellation::none(), [this, texture, streamingInitialSize, created](LoadedImage loaded) {
                 ScheduleRender();
-                return m_graphicsImpl.GetAfterRenderTask().then(arcana::inline_scheduler, m_cancelSource, [texture, image] {
-                    CreateTextureFromImage(texture, image);
+                return m_graphicsImpl.GetAfterRenderTask().then(arcana::inline_scheduler, m_cancelSource, [texture, loaded, streamingInitialSize, created] {
+                    CreateTextureFromLoadedImage(texture, loaded, streamingInitialSize, *created);
                 });
             })
-            .then(RuntimeScheduler, m_cancelSource, [onSuccessRef = Napi::Persistent(onSuccess), onErrorRef = Napi::Persistent(onError)](arcana::expected<void, std::exception_ptr> result) {
+            .then(RuntimeScheduler, m_cancelSource, [this, texture, created, onSuccessRef = Napi::Persistent(onSuccess), onErrorRef = Napi::Persistent(onError), onCompleteRef](arcana::expected<void, std::exception_ptr> result) {
                 if (result.has_error())
                 {
                     onErrorRef.Call({});
+                    return;
                 }
-                else
+
+                texture->LastUsedFrame = m_frameIndex;
+                if (created->Source.InitialLevel == 0)
                 {
+                    m_textureResidency.Track(texture, created->Layout, CreateTextureReloader(texture, created->CacheKey));
+
                     onSuccessRef.Call({});
+                    if (!onCompleteRef->IsEmpty())
+                    {
+                        onCompleteRef->Call({});
+                    }
+                    return;
                 }
+
+                // The initial texture is accounted but never reduced, the complete one replaces it.
+                const StreamedImage& source = created->Source;
+                m_textureResidency.Track(texture, TextureStreamer::GetLevelsSize(source.Image, source.InitialLevel));
+                m_textureStreamer.Add(texture, source, BGFX_TEXTURE_NONE | BGFX_SAMPLER_NONE, [this, texture, onCompleteRef, layout = created->Layout, cacheKey = created->CacheKey](bgfx::TextureHandle handle) {
+                    bgfx::destroy(texture->Handle);
+                    texture->Handle = handle;
+
+                    texture->LastUsedFrame = m_frameIndex;
+                    m_textureResidency.Track(texture, layout, CreateTextureReloader(texture, cacheKey));
+
+                    if (!onCompleteRef->IsEmpty())
+                    {
+                        onCompleteRef->Call({});
+                    }
+                });
+                ScheduleRender();
+                onSuccessRef.Call({});
+            });
+    }
+
+    TextureResidency::Reloader NativeEngine::CreateTextureReloader(TextureData* texture, uint64_t cacheKey)
+    {
+        // Reduced textures are restored from the texture cache, so that no copy of their image is kept in memory.
+        if (cacheKey == 0 || !m_textureCache || !TextureResidency::IsSupported())
+        {
+            return {};
+        }
+
+        return [this, texture, cacheKey, cache = std::weak_ptr<TextureCache>{m_textureCache}](uint64_t request) {
+            arcana::make_task(arcana::threadpool_scheduler, m_cancelSource, [cacheKey, cache]() {
+                const auto locked = cache.lock();
+                return locked ? std::shared_ptr<TextureCache::MappedTexture>{locked->Find(cacheKey)} : nullptr;
+            }).then(RuntimeScheduler, m_cancelSource, [this, texture, request](std::shared_ptr<TextureCache::MappedTexture> cached) {
+                m_textureResidency.Restore(texture, request, cached ? ToStreamedImage(LoadedImage{nullptr, std::move(cached)}) : StreamedImage{});
             });
+        };
     }
 
     void NativeEngine::LoadCubeTexture(const Napi::CallbackInfo& info)
@@ -1108,29 +2347,49 @@ namespace Babylon
         const auto onSuccess = info[3].As<Napi::Function>();
         const auto onError = info[4].As<Napi::Function>();
 
-        std::array<arcana::task<bimg::ImageContainer*, std::exception_ptr>, 6> tasks;
+        const auto assembly = std::make_shared<CubeTextureAssembly>(uint8_t{1}, generateMips, m_mipFilter);
+        std::vector<arcana::task<void, std::exception_ptr>> tasks{};
         for (uint32_t face = 0; face < data.Length(); face++)
         {
             const auto typedArray = data[face].As<Napi::TypedArray>();
             const auto dataSpan = gsl::make_span(static_cast<uint8_t*>(typedArray.ArrayBuffer().Data()) + typedArray.ByteOffset(), typedArray.ByteLength());
-            tasks[face] = arcana::make_task(arcana::threadpool_scheduler, m_cancelSource, [this, dataSpan, generateMips]() {
+            tasks.push_back(arcana::make_task(arcana::threadpool_scheduler, m_cancelSource, [this, dataSpan, face, generateMips, mipFilter = m_mipFilter, cache = m_textureCache, assembly]() {
+                uint64_t key{};
+                if (cache)
+                {
+                    const ImageProcessingOptions processingOptions{false, false, false, generateMips, mipFilter, false};
+                    key = TextureCache::ComputeKey(dataSpan, GetProcessingKey(processingOptions, {}, true));
+                    if (const auto cached = cache->Find(key))
+                    {
+                        assembly->Place(cached->GetImage(), face);
+                        return;
+                    }
+                }
+
                 bimg::ImageContainer* image = bimg::imageParse(&m_allocator, dataSpan.data(), static_cast<uint32_t>(dataSpan.size()));
-                if (generateMips)
+                if (generateMips && image != nullptr && !CanGenerateMipChain(*image))
                 {
-                    GenerateMips(&m_allocator, &image);
+                    GenerateMips(&m_allocator, &image, mipFilter, false);
                 }
-                return image;
-            });
+
+                // The mips are generated in place, in the upload block of the cube.
+                assembly->Place(image, face, 0);
+                if (cache)
+                {
+                    cache->Store(key, assembly->GetFace(face));
+                }
+            }));
         }
 
-        arcana::when_all(gsl::make_span(tasks))
-            .then(arcana::inline_scheduler, arcana::cancellation::none(), [this, texture, generateMips](std::vector<bimg::ImageContainer*> images) {
+        arcana::when_all<std::exception_ptr>(tasks)
+            .then(arcana::inline_scheduler, arcana::cancellation::none(), [this, texture, assembly]() {
                 ScheduleRender();
-                return m_graphicsImpl.GetAfterRenderTask().then(arcana::inline_scheduler, m_cancelSource, [texture, generateMips, images = std::move(images)] {
-                    CreateCubeTextureFromImages(texture, images, generateMips);
+                return m_graphicsImpl.GetAfterRenderTask().then(arcana::inline_scheduler, m_cancelSource, [texture, assembly] {
+                    CreateCubeTextureFromAssembly(texture, assembly);
                 });
             })
-            .then(RuntimeScheduler, m_cancelSource, [this, onSuccessRef = Napi::Persistent(onSuccess)]() {
+            .then(RuntimeScheduler, m_cancelSource, [this, texture, assembly, onSuccessRef = Napi::Persistent(onSuccess)]() {
+                m_textureResidency.Track(texture, assembly->GetDataSize());
                 onSuccessRef.Call({Napi::Value::From(Env(), true)});
             })
             .then(arcana::inline_scheduler, m_cancelSource, [this, onErrorRef = Napi::Persistent(onError)](arcana::expected<void, std::exception_ptr> result) {
@@ -1149,7 +2408,9 @@ namespace Babylon
         const auto onError = info[3].As<Napi::Function>();
 
         const auto numMips = data.Length();
-        std::vector<arcana::task<bimg::ImageContainer*, std::exception_ptr>> tasks(6 * numMips);
+        const auto assembly = std::make_shared<CubeTextureAssembly>(static_cast<uint8_t>(numMips), false);
+        std::vector<arcana::task<void, std::exception_ptr>> tasks{};
+        tasks.reserve(6 * numMips);
         for (uint32_t mip = 0; mip < numMips; mip++)
         {
             const auto faceData = data[mip].As<Napi::Array>();
@@ -1157,22 +2418,26 @@ namespace Babylon
             {
                 const auto typedArray = faceData[face].As<Napi::TypedArray>();
                 const auto dataSpan = gsl::make_span(static_cast<uint8_t*>(typedArray.ArrayBuffer().Data()) + typedArray.ByteOffset(), typedArray.ByteLength());
-                tasks[(face * numMips) + mip] = arcana::make_task(arcana::threadpool_scheduler, m_cancelSource, [this, dataSpan]() {
+                tasks.push_back(arcana::make_task(arcana::threadpool_scheduler, m_cancelSource, [this, dataSpan, face, mip, assembly]() {
                     bimg::ImageContainer* image = bimg::imageParse(&m_allocator, dataSpan.data(), static_cast<uint32_t>(dataSpan.size()));
-                    FlipY(image);
-                    return image;
-                });
+                    if (image != nullptr)
+                    {
+                        FlipY(image);
+                    }
+                    assembly->Place(image, face, static_cast<uint8_t>(mip));
+                }));
             }
         }
 
-        arcana::when_all(gsl::make_span(tasks))
-            .then(arcana::inline_scheduler, arcana::cancellation::none(), [this, texture](std::vector<bimg::ImageContainer*> images) {
+        arcana::when_all<std::exception_ptr>(tasks)
+            .then(arcana::inline_scheduler, arcana::cancellation::none(), [this, texture, assembly]() {
                 ScheduleRender();
-                return m_graphicsImpl.GetAfterRenderTask().then(arcana::inline_scheduler, m_cancelSource, [texture, images = std::move(images)] {
-                    CreateCubeTextureFromImages(texture, images, true);
+                return m_graphicsImpl.GetAfterRenderTask().then(arcana::inline_scheduler, m_cancelSource, [texture, assembly] {
+                    CreateCubeTextureFromAssembly(texture, assembly);
                 });
             })
-            .then(RuntimeScheduler, m_cancelSource, [this, onSuccessRef = Napi::Persistent(onSuccess)]() {
+            .then(RuntimeScheduler, m_cancelSource, [this, texture, assembly, onSuccessRef = Napi::Persistent(onSuccess)]() {
+                m_textureResidency.Track(texture, assembly->GetDataSize());
                 onSuccessRef.Call({Napi::Value::From(Env(), true)});
             })
             .then(arcana::inline_scheduler, m_cancelSource, [this, onErrorRef = Napi::Persistent(onError)](arcana::expected<void, std::exception_ptr> result) {
@@ -1244,15 +2509,33 @@ namespace Babylon
 
     void NativeEngine::SetTexture(const Napi::CallbackInfo& info)
     {
+        ThrowIfRecordingBundle();
         const auto uniformInfo = info[0].As<Napi::External<UniformInfo>>().Data();
         const auto texture = info[1].As<Napi::External<TextureData>>().Data();
 
-        bgfx::setTexture(uniformInfo->Stage, uniformInfo->Handle, texture->Handle, texture->Flags);
+        SetTextureInternal(*uniformInfo, *texture);
+    }
+
+    void NativeEngine::SetTextureInternal(const UniformInfo& uniformInfo, const TextureData& texture)
+    {
+        texture.LastUsedFrame = m_frameIndex;
+
+        if (m_bindingShadowState.SetTexture(uniformInfo.Stage, uniformInfo.Handle.idx, texture.Handle.idx, texture.Flags))
+        {
+            // The pending draws were made with the previous texture.
+            FlushPendingDraws();
+            bgfx::setTexture(uniformInfo.Stage, uniformInfo.Handle, texture.Handle, texture.Flags);
+        }
     }
 
     void NativeEngine::DeleteTexture(const Napi::CallbackInfo& info)
     {
+        FlushPendingDraws();
+
         const auto texture = info[0].As<Napi::External<TextureData>>().Data();
+        m_textureStreamer.Remove(texture);
+        m_textureResidency.Untrack(texture);
+        m_commandHandles->Unregister(texture);
         delete texture;
     }
 
@@ -1267,70 +2550,93 @@ namespace Babylon
         bool generateDepth = info[6].As<Napi::Boolean>();
         bool generateMips = info[7].As<Napi::Boolean>();
 
-        bgfx::FrameBufferHandle frameBufferHandle{};
         if (generateStencilBuffer && !generateDepth)
         {
             throw std::exception{/* Does this case even make any sense? */};
         }
-        else if (!generateStencilBuffer && !generateDepth)
+
+        RenderTargetDescription description{width, height, format};
+        if (generateDepth)
         {
-            frameBufferHandle = bgfx::createFrameBuffer(width, height, format, BGFX_TEXTURE_RT);
+            description.DepthStencilFormat = generateStencilBuffer ? bgfx::TextureFormat::D24S8 : bgfx::TextureFormat::D32;
+            description.HasMips = generateMips;
         }
-        else
-        {
-            auto depthStencilFormat = bgfx::TextureFormat::D32;
-            if (generateStencilBuffer)
-            {
-                depthStencilFormat = bgfx::TextureFormat::D24S8;
-            }
-
-            assert(bgfx::isTextureValid(0, false, 1, format, BGFX_TEXTURE_RT));
-            assert(bgfx::isTextureValid(0, false, 1, depthStencilFormat, BGFX_TEXTURE_RT));
 
-            std::array<bgfx::TextureHandle, 2> textures{
-                bgfx::createTexture2D(width, height, generateMips, 1, format, BGFX_TEXTURE_RT),
-                bgfx::createTexture2D(width, height, generateMips, 1, depthStencilFormat, BGFX_TEXTURE_RT)};
-            std::array<bgfx::Attachment, textures.size()> attachments{};
-            for (size_t idx = 0; idx < attachments.size(); ++idx)
-            {
-                attachments[idx].init(textures[idx]);
-            }
-            frameBufferHandle = bgfx::createFrameBuffer(static_cast<uint8_t>(attachments.size()), attachments.data(), true);
-        }
+        const bgfx::FrameBufferHandle frameBufferHandle = m_renderTargetPool.Acquire(description);
 
+        // The color attachment is destroyed with the frame buffer, which may outlive the texture in the pool.
         texture->Handle = bgfx::getTexture(frameBufferHandle);
+        texture->OwnsHandle = false;
+        texture->Width = width;
+        texture->Height = height;
+        texture->Format = format;
 
-        return Napi::External<FrameBufferData>::New(info.Env(), m_frameBufferManager.CreateNew(frameBufferHandle, width, height));
+        auto frameBufferData = m_frameBufferManager.CreateNew(frameBufferHandle, width, height);
+        frameBufferData->PoolDescription = description;
+        return Napi::External<FrameBufferData>::New(info.Env(), frameBufferData);
     }
 
     void NativeEngine::DeleteFrameBuffer(const Napi::CallbackInfo& info)
     {
+        FlushPendingDraws();
+
         const auto frameBufferData = info[0].As<Napi::External<FrameBufferData>>().Data();
+        OnFrameBufferDestroyed(*frameBufferData);
+        if (frameBufferData->PoolDescription)
+        {
+            // Reusing it within the frame is safe, as views are executed in the order they are handed out: the
+            // draws submitted so far come before the passes of the next render target.
+            m_renderTargetPool.Release(*frameBufferData->PoolDescription, frameBufferData->FrameBuffer, m_frameIndex);
+            frameBufferData->FrameBuffer = BGFX_INVALID_HANDLE;
+        }
         delete frameBufferData;
     }
 
     void NativeEngine::BindFrameBuffer(const Napi::CallbackInfo& info)
     {
+        ThrowIfRecordingBundle();
+        FlushPendingDrawsForViewChange();
         const auto frameBufferData = info[0].As<Napi::External<FrameBufferData>>().Data();
         m_frameBufferManager.Bind(frameBufferData);
     }
 
     void NativeEngine::UnbindFrameBuffer(const Napi::CallbackInfo& info)
     {
+        ThrowIfRecordingBundle();
+        FlushPendingDrawsForViewChange();
         const auto frameBufferData = info[0].As<Napi::External<FrameBufferData>>().Data();
         m_frameBufferManager.Unbind(frameBufferData);
     }
 
     void NativeEngine::DrawIndexed(const Napi::CallbackInfo& info)
     {
+        ThrowIfRecordingBundle();
         const auto fillMode = info[0].As<Napi::Number>().Int32Value();
         const auto elementStart = info[1].As<Napi::Number>().Int32Value();
         const auto elementCount = info[2].As<Napi::Number>().Int32Value();
+
+        DrawIndexedInternal(fillMode, elementStart, elementCount);
+    }
+
+    void NativeEngine::DrawIndexedInternal(int32_t fillMode, int32_t elementStart, int32_t elementCount)
+    {
+        if (m_autoInstancingEnabled && CanBatchDraw())
+        {
+            BatchDraw(fillMode, elementStart, elementCount);
+            return;
+        }
+
+        FlushPendingDraws();
+        SubmitDraw(*m_currentProgram, m_currentBoundIndexBuffer, fillMode, elementStart, elementCount, m_engineState);
+    }
+
+    void NativeEngine::SubmitDraw(ProgramData& program, const IndexBufferData* indexBuffer, int32_t fillMode, int32_t elementStart, int32_t elementCount, uint64_t engineState)
+    {
         // TODO: handle viewport
 
-        if (m_currentBoundIndexBuffer)
+        if (indexBuffer && m_bindingShadowState.SetIndexBuffer(indexBuffer->GetBindingId(), static_cast<uint32_t>(elementStart), static_cast<uint32_t>(elementCount)))
         {
-            m_currentBoundIndexBuffer->SetBgfxIndexBuffer(elementStart, elementCount);
+            indexBuffer->SetBgfxIndexBuffer(elementStart, elementCount);
         }
 
         // TODO: support other fill modes
@@ -1351,116 +2657,676 @@ namespace Babylon
                 break;
         }
 
-        if (m_frameBufferManager.IsRenderingToTarget() && (!bgfx::getCaps()->originBottomLeft))
-        {
-            // UV coordinates system are different between OpenGL and Direct3D/Metal
-            // This is not an issue with loaded textures (png/jpg...) because
-            // texel rows bytes are also using a different convention
-            // see https://www.puredevsoftware.com/blog/2018/03/17/texture-coordinates-d3d-vs-opengl/
-            // for render to texture, as the texel bytes are not reversed, sampling a RTT for
-            // post process or shadows will result in inversion on V axis (Y)
-            // to compensate for that, any matrix that is used to project onto clip-space has
-            // to be flipped.
-            // The involved matrices are determined by name and a boolean YFlip is set to true.
-            // When rendering to texture, those matrices are flipped and set as uniform datas.
-            // But because flipping clip-space coordinates also flips triangles winding,
-            // Culling also has to be flipped.
-            for (const auto& it : m_currentProgram->Uniforms)
-            {
-                const ProgramData::UniformValue& value = it.second;
-                if (value.YFlip)
-                {
-                    float tmpMatrix[16];
-                    static const float flipMatrix[16] = {1.f, 0.f, 0.f, 0.f,
-                        0.f, -1.f, 0.f, 0.f,
-                        0.f, 0.f, 1.f, 0.f,
-                        0.f, 0.f, 0.f, 1.f};
-                    bx::mtxMul(tmpMatrix, value.Data.data(), flipMatrix);
-                    bgfx::setUniform({it.first}, tmpMatrix, value.ElementLength);
-                }
-                else
-                {
-                    bgfx::setUniform({it.first}, value.Data.data(), value.ElementLength);
-                }
+        // UV coordinates system are different between OpenGL and Direct3D/Metal
+        // This is not an issue with loaded textures (png/jpg...) because
+        // texel rows bytes are also using a different convention
+        // see https://www.puredevsoftware.com/blog/2018/03/17/texture-coordinates-d3d-vs-opengl/
+        // for render to texture, as the texel bytes are not reversed, sampling a RTT for
+        // post process or shadows will result in inversion on V axis (Y)
+        // to compensate for that, any matrix that is used to project onto clip-space has
+        // to be flipped.
+        // The involved matrices are determined by name and a boolean YFlip is set to true.
+        // When rendering to texture, those matrices are flipped and set as uniform datas.
+        // But because flipping clip-space coordinates also flips triangles winding,
+        // Culling also has to be flipped.
+        const bool yFlip = m_frameBufferManager.IsRenderingToTarget() && (!bgfx::getCaps()->originBottomLeft);
+        const bgfx::ViewId viewId = m_frameBufferManager.AcquireViewForDraw();
+        const uint64_t state = engineState | fillModeState;
+        if (&program != m_lastSubmitted.Program || yFlip != m_lastSubmitted.YFlip || viewId != m_lastSubmitted.ViewId)
+        {
+            // bgfx keeps uniform values per handle and handles are shared between programs, so every value
+            // of the program has to be checked against the values last uploaded on the view.
+            program.MarkUniformsDirty();
+            m_lastSubmitted = {&program, viewId, yFlip};
+        }
+
+        for (auto& value : program.Uniforms)
+        {
+            if (!value.Dirty)
+            {
+                continue;
             }
-            // change culling
-            uint64_t m_engineStateYFlipped = m_engineState;
-            if (m_engineStateYFlipped & ~BGFX_STATE_CULL_MASK)
+
+            const auto data = (yFlip && value.YFlip) ? value.FlippedData(program.UniformData) : value.Data(program.UniformData);
+            if (m_uniformShadowState.Update(viewId, value.Handle, data))
             {
-                m_engineStateYFlipped ^= BGFX_STATE_CULL_MASK;
+                bgfx::setUniform(value.Handle, data.data(), value.ElementLength);
             }
-            bgfx::setState(m_engineStateYFlipped | fillModeState);
+
+            value.Dirty = false;
         }
-        else
+
+        if (yFlip)
         {
-            for (const auto& it : m_currentProgram->Uniforms)
+            if (state != m_flippedState.Source)
             {
-                const ProgramData::UniformValue& value = it.second;
-                bgfx::setUniform({it.first}, value.Data.data(), value.ElementLength);
+                // change culling
+                m_flippedState.Source = state;
+                m_flippedState.Flipped = (state & BGFX_STATE_CULL_MASK) ? (state ^ BGFX_STATE_CULL_MASK) : state;
             }
-            bgfx::setState(m_engineState | fillModeState);
+            bgfx::setState(m_flippedState.Flipped);
+        }
+        else
+        {
+            bgfx::setState(state);
         }
 
 #if (ANDROID)
         // TODO : find why we need to discard state on Android
-        bgfx::submit(m_frameBufferManager.GetBound().ViewId, m_currentProgram->Program, 0, false);
+        // The instance data is still discarded, so that the draws that follow an instanced one do not read it.
+        bgfx::submit(viewId, program.Program, 0, BGFX_DISCARD_INSTANCE_DATA);
 #else
-        bgfx::submit(m_frameBufferManager.GetBound().ViewId, m_currentProgram->Program, 0, BGFX_DISCARD_INSTANCE_DATA | BGFX_DISCARD_STATE | BGFX_DISCARD_TRANSFORM);
+        bgfx::submit(viewId, program.Program, 0, BGFX_DISCARD_INSTANCE_DATA | BGFX_DISCARD_STATE | BGFX_DISCARD_TRANSFORM);
 #endif
+
+        m_frameBufferManager.OnDrawSubmitted();
     }
 
     void NativeEngine::Draw(const Napi::CallbackInfo& info)
     {
-        bgfx::discard(BGFX_DISCARD_INDEX_BUFFER);
-        m_currentBoundIndexBuffer = nullptr;
-        DrawIndexed(info);
-    }
+        ThrowIfRecordingBundle();
+        const auto fillMode = info[0].As<Napi::Number>().Int32Value();
+        const auto elementStart = info[1].As<Napi::Number>().Int32Value();
+        const auto elementCount = info[2].As<Napi::Number>().Int32Value();
 
-    void NativeEngine::Clear(const Napi::CallbackInfo& info)
-    {
-        m_frameBufferManager.GetBound().ViewClearState.UpdateFlags(info);
+        DrawInternal(fillMode, elementStart, elementCount);
     }
 
-    void NativeEngine::ClearColor(const Napi::CallbackInfo& info)
+    void NativeEngine::DrawInternal(int32_t fillMode, int32_t elementStart, int32_t elementCount)
     {
-        m_frameBufferManager.GetBound().ViewClearState.UpdateColor(info);
+        FlushPendingDraws();
+        bgfx::discard(BGFX_DISCARD_INDEX_BUFFER);
+        m_bindingShadowState.DiscardIndexBuffer();
+        m_currentBoundIndexBuffer = nullptr;
+        DrawIndexedInternal(fillMode, elementStart, elementCount);
     }
 
-    void NativeEngine::ClearStencil(const Napi::CallbackInfo& info)
+    void NativeEngine::DrawInstanced(const Napi::CallbackInfo& info)
     {
-        m_frameBufferManager.GetBound().ViewClearState.UpdateStencil(info);
-    }
+        ThrowIfRecordingBundle();
+        const auto fillMode = info[0].As<Napi::Number>().Int32Value();
+        const auto elementStart = info[1].As<Napi::Number>().Int32Value();
+        const auto elementCount = info[2].As<Napi::Number>().Int32Value();
+        const auto instanceCount = info[3].As<Napi::Number>().Uint32Value();
 
-    void NativeEngine::ClearDepth(const Napi::CallbackInfo& info)
-    {
-        m_frameBufferManager.GetBound().ViewClearState.UpdateDepth(info);
+        DrawInstancedInternal(fillMode, elementStart, elementCount, instanceCount);
     }
 
-    Napi::Value NativeEngine::GetRenderWidth(const Napi::CallbackInfo& info)
+    void NativeEngine::DrawInstancedInternal(int32_t fillMode, int32_t elementStart, int32_t elementCount, uint32_t instanceCount)
     {
-        return Napi::Value::From(info.Env(), bgfx::getStats()->width);
-    }
+        if (m_currentVertexArray == nullptr || m_currentVertexArray->instanceAttributes.empty())
+        {
+            throw std::runtime_error{"The bound vertex array has no per-instance attributes."};
+        }
 
-    Napi::Value NativeEngine::GetRenderHeight(const Napi::CallbackInfo& info)
-    {
-        return Napi::Value::From(info.Env(), bgfx::getStats()->height);
-    }
+        FlushPendingDraws();
 
-    void NativeEngine::SetViewPort(const Napi::CallbackInfo& info)
+        const VertexArray& vertexArray = *m_currentVertexArray;
+        for (const auto& attribute : vertexArray.instanceAttributes)
+        {
+            if (attribute.data->IsExpired(m_frameIndex))
+            {
+                throw std::runtime_error{"A transient vertex buffer can only be used in the frame it was allocated in."};
+            }
+        }
+
+        ProgramData& program = GetInstanceVariant(*m_currentProgram, vertexArray);
+
+        if (vertexArray.directInstanceData)
+        {
+            const auto& attribute = vertexArray.instanceAttributes.front();
+            attribute.data->SetAsBgfxInstanceDataBuffer(attribute.startInstance, instanceCount);
+            SubmitDraw(program, m_currentBoundIndexBuffer, fillMode, elementStart, elementCount, m_engineState);
+            return;
+        }
+
+        // The attributes are gathered into transient instance data, one register each, as many instances at a time
+        // as the transient memory left for the frame allows.
+        const auto instanceStride = static_cast<uint16_t>(vertexArray.instanceAttributes.size() * 16);
+        for (uint32_t firstInstance = 0; firstInstance < instanceCount;)
+        {
+            const uint32_t batchCount = bgfx::getAvailInstanceDataBuffer(instanceCount - firstInstance, instanceStride);
+            if (batchCount == 0)
+            {
+                throw std::runtime_error{"Out of transient memory for per-instance attributes."};
+            }
+
+            bgfx::InstanceDataBuffer instanceData{};
+            bgfx::allocInstanceDataBuffer(&instanceData, batchCount, instanceStride);
+            std::memset(instanceData.data, 0, static_cast<size_t>(batchCount) * instanceStride);
+            for (const auto& attribute : vertexArray.instanceAttributes)
+            {
+                const auto bytes = attribute.data->GetInstanceBytes();
+                uint8_t* destination = instanceData.data + attribute.instanceRegister * 16;
+                for (uint32_t instance = 0; instance < batchCount; ++instance)
+                {
+                    // Instances past the end of the buffer read zeros.
+                    const size_t source = (static_cast<size_t>(attribute.startInstance) + firstInstance + instance) * attribute.byteStride + attribute.offset;
+                    if (source + attribute.byteSize > static_cast<size_t>(bytes.size()))
+                    {
+                        break;
+                    }
+                    std::memcpy(destination + static_cast<size_t>(instance) * instanceStride, bytes.data() + source, attribute.byteSize);
+                }
+            }
+
+            bgfx::setInstanceDataBuffer(&instanceData);
+            SubmitDraw(program, m_currentBoundIndexBuffer, fillMode, elementStart, elementCount, m_engineState);
+            firstInstance += batchCount;
+        }
+    }
+
+    ProgramData& NativeEngine::GetInstanceVariant(ProgramData& program, const VertexArray& vertexArray)
+    {
+        // The names the program knows the per-instance attributes by, for each register they are read from. The
+        // program reads world0..world3 from i_data0..i_data3 and is used as is when that is all it needs.
+        std::vector<std::string> instanceAttributes{};
+        bool isDefault = true;
+        for (const auto& attribute : vertexArray.instanceAttributes)
+        {
+            const auto& locations = program.VertexAttributeLocations;
+            const auto it = std::find_if(locations.begin(), locations.end(), [&attribute](const auto& entry) { return entry.second == attribute.location; });
+            if (it == locations.end())
+            {
+                // Not read by the program.
+                continue;
+            }
+
+            if (instanceAttributes.size() <= attribute.instanceRegister)
+            {
+                instanceAttributes.resize(attribute.instanceRegister + 1);
+            }
+            instanceAttributes[attribute.instanceRegister] = it->first;
+            isDefault = isDefault && it->first == "world" + std::to_string(attribute.instanceRegister);
+        }
+
+        if (isDefault)
+        {
+            return program;
+        }
+
+        std::string key{};
+        for (const auto& name : instanceAttributes)
+        {
+            key += name;
+            key += ';';
+        }
+
+        auto itVariant = program.InstanceVariants.find(key);
+        if (itVariant == program.InstanceVariants.end())
+        {
+            std::unique_ptr<ProgramData> variant{};
+            try
+            {
+                variant = CreateProgramData(program.VertexSource, program.FragmentSource, instanceAttributes);
+
+                // The other attributes must keep their locations, which the vertex array was recorded with.
+                for (const auto& [name, location] : program.VertexAttributeLocations)
+                {
+                    const auto itLocation = variant->VertexAttributeLocations.find(name);
+                    const bool perInstance = std::find(instanceAttributes.begin(), instanceAttributes.end(), name) != instanceAttributes.end();
+                    if (!perInstance && (itLocation == variant->VertexAttributeLocations.end() || itLocation->second != location))
+                    {
+                        variant.reset();
+                        break;
+                    }
+                }
+            }
+            catch (const std::exception&)
+            {
+                variant.reset();
+            }
+
+            itVariant = program.InstanceVariants.emplace(std::move(key), std::move(variant)).first;
+        }
+
+        if (itVariant->second == nullptr)
+        {
+            throw std::runtime_error{"The program cannot read the per-instance attributes of the vertex array from the instance data registers."};
+        }
+
+        ProgramData& variant = *itVariant->second;
+        for (const auto& value : program.Uniforms)
+        {
+            if (value.ElementLength > 0)
+            {
+                variant.SetUniform(value.Handle, value.Data(program.UniformData), value.ElementLength);
+            }
+        }
+
+        return variant;
+    }
+
+    void NativeEngine::SetUniformValue(bgfx::UniformHandle handle, gsl::span<const float> data, size_t elementLength)
+    {
+        if (m_executingBundle.Bundle != nullptr)
+        {
+            const auto& patchableUniforms = m_executingBundle.Bundle->PatchableUniforms;
+            if (std::any_of(patchableUniforms.begin(), patchableUniforms.end(), [handle](bgfx::UniformHandle patchable) { return patchable.idx == handle.idx; }))
+            {
+                // The value given to executeBundle replaces the recorded one.
+                return;
+            }
+        }
+
+        UpdateUniformValue(handle, data, elementLength);
+    }
+
+    void NativeEngine::UpdateUniformValue(bgfx::UniformHandle handle, gsl::span<const float> data, size_t elementLength)
+    {
+        if (m_pendingDraws.Program != nullptr && m_currentProgram == m_pendingDraws.Program && handle.idx != m_currentProgram->WorldUniform.idx && !m_currentProgram->HasUniformValue(handle, data, elementLength))
+        {
+            // The pending draws were made with the previous value.
+            FlushPendingDraws();
+        }
+
+        m_currentProgram->SetUniform(handle, data, elementLength);
+    }
+
+    bool NativeEngine::CanBatchDraw() const
+    {
+        return m_currentVertexArray != nullptr &&
+               m_currentBoundIndexBuffer != nullptr &&
+               m_currentVertexArray->instanceAttributes.empty() &&
+               bgfx::isValid(m_currentProgram->WorldUniform) &&
+               m_currentProgram->GetUniformData(m_currentProgram->WorldUniform).size() == 16;
+    }
+
+    void NativeEngine::BatchDraw(int32_t fillMode, int32_t elementStart, int32_t elementCount)
+    {
+        const bgfx::ViewId viewId = m_frameBufferManager.AcquireViewForDraw();
+
+        auto& pending = m_pendingDraws;
+        if (pending.Program != m_currentProgram ||
+            pending.BoundVertexArray != m_currentVertexArray ||
+            pending.IndexBuffer != m_currentBoundIndexBuffer ||
+            pending.FillMode != fillMode ||
+            pending.ElementStart != elementStart ||
+            pending.ElementCount != elementCount ||
+            pending.EngineState != m_engineState ||
+            pending.ViewId != viewId)
+        {
+            FlushPendingDraws();
+
+            pending.Program = m_currentProgram;
+            pending.BoundVertexArray = m_currentVertexArray;
+            pending.IndexBuffer = m_currentBoundIndexBuffer;
+            pending.FillMode = fillMode;
+            pending.ElementStart = elementStart;
+            pending.ElementCount = elementCount;
+            pending.EngineState = m_engineState;
+            pending.ViewId = viewId;
+        }
+
+        const auto world = m_currentProgram->GetUniformData(m_currentProgram->WorldUniform);
+        pending.WorldMatrices.insert(pending.WorldMatrices.end(), world.begin(), world.end());
+    }
+
+    void NativeEngine::FlushPendingDraws()
+    {
+        auto& pending = m_pendingDraws;
+        if (pending.Program == nullptr)
+        {
+            return;
+        }
+
+        ProgramData& program = *pending.Program;
+        const bgfx::UniformHandle worldUniform = program.WorldUniform;
+        const auto drawCount = static_cast<uint32_t>(pending.WorldMatrices.size() / 16);
+        constexpr uint16_t instanceStride = 16 * sizeof(float);
+
+        uint32_t submittedCount = 0;
+        if (drawCount > 1 && EnsureInstancedProgram(program))
+        {
+            ProgramData& instancedProgram = *program.InstancedProgram;
+            for (const auto& value : program.Uniforms)
+            {
+                if (value.ElementLength > 0)
+                {
+                    instancedProgram.SetUniform(value.Handle, value.Data(program.UniformData), value.ElementLength);
+                }
+            }
+
+            while (submittedCount < drawCount)
+            {
+                const uint32_t instanceCount = bgfx::getAvailInstanceDataBuffer(drawCount - submittedCount, instanceStride);
+                if (instanceCount == 0)
+                {
+                    // Out of transient memory for this frame, submit the remaining draws one by one.
+                    break;
+                }
+
+                bgfx::InstanceDataBuffer instanceDataBuffer{};
+                bgfx::allocInstanceDataBuffer(&instanceDataBuffer, instanceCount, instanceStride);
+                std::memcpy(instanceDataBuffer.data, pending.WorldMatrices.data() + submittedCount * 16, instanceCount * instanceStride);
+
+                // Discarded by the submit on every renderer, so that the draws submitted one by one below or after the
+                // batch do not read the world0..world3 stream.
+                bgfx::setInstanceDataBuffer(&instanceDataBuffer);
+                SubmitDraw(instancedProgram, pending.IndexBuffer, pending.FillMode, pending.ElementStart, pending.ElementCount, pending.EngineState);
+
+                submittedCount += instanceCount;
+                m_mergedDrawCount += instanceCount - 1;
+                ++m_instancedDrawCount;
+            }
+        }
+
+        if (submittedCount < drawCount)
+        {
+            // The world uniform may already hold the value for the next draw, so it is restored afterwards.
+            const auto currentWorld = program.GetUniformData(worldUniform);
+            const std::vector<float> savedWorld{currentWorld.begin(), currentWorld.end()};
+
+            for (; submittedCount < drawCount; ++submittedCount)
+            {
+                program.SetUniform(worldUniform, gsl::make_span(pending.WorldMatrices.data() + submittedCount * 16, 16));
+                SubmitDraw(program, pending.IndexBuffer, pending.FillMode, pending.ElementStart, pending.ElementCount, pending.EngineState);
+            }
+
+            program.SetUniform(worldUniform, savedWorld);
+        }
+
+        pending.Program = nullptr;
+        pending.WorldMatrices.clear();
+    }
+
+    void NativeEngine::FlushPendingDrawsForViewChange()
+    {
+        FlushPendingDraws();
+
+        // Changing the view or its clear values discards everything set on the encoder, including the bindings.
+        m_bindingShadowState.Reset();
+    }
+
+    bool NativeEngine::EnsureInstancedProgram(ProgramData& program)
     {
+        if (program.InstancedProgram == nullptr && bgfx::isValid(program.WorldUniform))
+        {
+            try
+            {
+                // The world uniform is replaced by the world0 to world3 attributes, read from i_data0 to i_data3.
+                program.InstancedProgram = CreateProgramData(program.VertexSource, program.FragmentSource, {}, "world");
+            }
+            catch (const std::exception&)
+            {
+                // The program is not auto-instanced if its instanced variant cannot be compiled.
+                program.WorldUniform = BGFX_INVALID_HANDLE;
+            }
+        }
+
+        return program.InstancedProgram != nullptr;
+    }
+
+    void NativeEngine::SetIndexNarrowing(const Napi::CallbackInfo& info)
+    {
+        m_indexNarrowingEnabled = info[0].As<Napi::Boolean>().Value();
+    }
+
+    void NativeEngine::SetTextureCompression(const Napi::CallbackInfo& info)
+    {
+        const uint32_t preset = info[0].As<Napi::Number>().Uint32Value();
+        if (preset > static_cast<uint32_t>(TextureCompressionPreset::Quality))
+        {
+            throw std::runtime_error{"Invalid texture compression preset."};
+        }
+
+        m_textureCompression = static_cast<TextureCompressionPreset>(preset);
+    }
+
+    void NativeEngine::SetMipFilter(const Napi::CallbackInfo& info)
+    {
+        const uint32_t filter = info[0].As<Napi::Number>().Uint32Value();
+        if (filter > static_cast<uint32_t>(MipFilter::Kaiser))
+        {
+            throw std::runtime_error{"Invalid mip filter."};
+        }
+
+        m_mipFilter = static_cast<MipFilter>(filter);
+    }
+
+    void NativeEngine::SetImageNarrowing(const Napi::CallbackInfo& info)
+    {
+        m_imageNarrowingEnabled = info[0].As<Napi::Boolean>().Value();
+    }
+
+    void NativeEngine::SetVertexBufferBorrowing(const Napi::CallbackInfo& info)
+    {
+        m_vertexBufferBorrowingEnabled = info[0].As<Napi::Boolean>().Value();
+    }
+
+    void NativeEngine::SetTextureCache(const Napi::CallbackInfo& info)
+    {
+        // Loads in flight keep the previous cache alive until they complete.
+        m_textureCache.reset();
+
+        const std::string directory = info[0].IsUndefined() || info[0].IsNull() ? std::string{} : info[0].As<Napi::String>().Utf8Value();
+        if (directory.empty())
+        {
+            return;
+        }
+
+        const double maxBytes = info[1].As<Napi::Number>().DoubleValue();
+        if (!(maxBytes > 0))
+        {
+            throw std::runtime_error{"Invalid texture cache size."};
+        }
+
+        m_textureCache = std::make_shared<TextureCache>(directory, static_cast<uint64_t>(maxBytes));
+    }
+
+    void NativeEngine::SetTextureStreaming(const Napi::CallbackInfo& info)
+    {
+        const uint32_t budget = info[0].As<Napi::Number>().Uint32Value();
+        const uint32_t initialSize = info[1].IsUndefined() ? 128 : info[1].As<Napi::Number>().Uint32Value();
+        if (budget > 0 && initialSize == 0)
+        {
+            throw std::runtime_error{"Invalid texture streaming initial size."};
+        }
+
+        // Applies to the textures already streaming too.
+        m_textureStreamingBudget = budget;
+        m_textureStreamingInitialSize = initialSize;
+    }
+
+    void NativeEngine::SetTextureMemoryBudget(const Napi::CallbackInfo& info)
+    {
+        const double budget = info[0].As<Napi::Number>().DoubleValue();
+        if (!(budget >= 0))
+        {
+            throw std::runtime_error{"Invalid texture memory budget."};
+        }
+
+        // Only the textures loaded from now on can be reduced, the image of the others is not kept.
+        m_textureResidency.SetBudget(static_cast<uint64_t>(budget));
+        ScheduleRender();
+    }
+
+    Napi::Value NativeEngine::GetTextureMemoryUsage(const Napi::CallbackInfo& info)
+    {
+        return Napi::Value::From(info.Env(), static_cast<double>(m_textureResidency.GetTotalBytes()));
+    }
+
+    void NativeEngine::SetRenderTargetPooling(const Napi::CallbackInfo& info)
+    {
+        m_renderTargetPool.SetMaxIdleFrames(info[0].As<Napi::Number>().Uint32Value());
+    }
+
+    Napi::Value NativeEngine::GetRenderTargetPoolStatistics(const Napi::CallbackInfo& info)
+    {
+        const auto& statistics = m_renderTargetPool.GetStatistics();
+
+        auto result = Napi::Object::New(info.Env());
+        result.Set("hits", static_cast<double>(statistics.Hits));
+        result.Set("misses", static_cast<double>(statistics.Misses));
+        result.Set("trimmed", static_cast<double>(statistics.Trimmed));
+        return std::move(result);
+    }
+
+    void NativeEngine::SetAttributeQuantization(const Napi::CallbackInfo& info)
+    {
+        const uint32_t location = info[0].As<Napi::Number>().Uint32Value();
+        const uint32_t quantization = info[1].As<Napi::Number>().Uint32Value();
+        if (location >= m_attributeQuantization.size() || quantization > static_cast<uint32_t>(VertexQuantization::Unorm8))
+        {
+            throw std::runtime_error{"Invalid attribute quantization."};
+        }
+
+        m_attributeQuantization[location] = static_cast<VertexQuantization>(quantization);
+    }
+
+    void NativeEngine::SetAutoInstancing(const Napi::CallbackInfo& info)
+    {
+        FlushPendingDraws();
+        m_autoInstancingEnabled = info[0].As<Napi::Boolean>().Value();
+    }
+
+    void NativeEngine::Clear(const Napi::CallbackInfo& info)
+    {
+        ThrowIfRecordingBundle();
+        FlushPendingDrawsForViewChange();
+        m_frameBufferManager.PrepareClear();
+        m_frameBufferManager.GetBound().ViewClearState.UpdateFlags(info);
+    }
+
+    void NativeEngine::ClearColor(const Napi::CallbackInfo& info)
+    {
+        ThrowIfRecordingBundle();
+        FlushPendingDrawsForViewChange();
+        m_frameBufferManager.PrepareClear();
+        m_frameBufferManager.GetBound().ViewClearState.UpdateColor(info);
+    }
+
+    void NativeEngine::ClearStencil(const Napi::CallbackInfo& info)
+    {
+        ThrowIfRecordingBundle();
+        FlushPendingDrawsForViewChange();
+        m_frameBufferManager.PrepareClear();
+        m_frameBufferManager.GetBound().ViewClearState.UpdateStencil(info);
+    }
+
+    void NativeEngine::ClearDepth(const Napi::CallbackInfo& info)
+    {
+        ThrowIfRecordingBundle();
+        FlushPendingDrawsForViewChange();
+        m_frameBufferManager.PrepareClear();
+        m_frameBufferManager.GetBound().ViewClearState.UpdateDepth(info);
+    }
+
+    Napi::Value NativeEngine::GetRenderWidth(const Napi::CallbackInfo& info)
+    {
+        return Napi::Value::From(info.Env(), bgfx::getStats()->width);
+    }
+
+    Napi::Value NativeEngine::GetRenderHeight(const Napi::CallbackInfo& info)
+    {
+        return Napi::Value::From(info.Env(), bgfx::getStats()->height);
+    }
+
+    void NativeEngine::SetViewPort(const Napi::CallbackInfo& info)
+    {
+        ThrowIfRecordingBundle();
         const auto x = info[0].As<Napi::Number>().FloatValue();
         const auto y = info[1].As<Napi::Number>().FloatValue();
         const auto width = info[2].As<Napi::Number>().FloatValue();
         const auto height = info[3].As<Napi::Number>().FloatValue();
 
+        SetViewPortInternal(x, y, width, height);
+    }
+
+    void NativeEngine::ReadPixelsInternal(const Napi::CallbackInfo& info, bgfx::TextureHandle texture, bgfx::TextureFormat::Enum format, uint16_t width, uint16_t height)
+    {
+        const uint32_t x = info[1].As<Napi::Number>().Uint32Value();
+        const uint32_t y = info[2].As<Napi::Number>().Uint32Value();
+        const uint32_t readWidth = info[3].As<Napi::Number>().Uint32Value();
+        const uint32_t readHeight = info[4].As<Napi::Number>().Uint32Value();
+        const auto callbackRef = std::make_shared<Napi::FunctionReference>(Napi::Persistent(info[5].As<Napi::Function>()));
+
+        if (!TextureReadback::IsSupported())
+        {
+            throw std::runtime_error{"Reading pixels back is not supported by the renderer."};
+        }
+        if (!TextureReadback::IsFormatSupported(format))
+        {
+            throw std::runtime_error{"Unable to read pixels of a texture that is not an RGBA8 or BGRA8 render target."};
+        }
+        // Compared against the room left after the offsets, the end of the region could wrap around.
+        if (readWidth == 0 || readHeight == 0 || x > width || y > height || readWidth > width - x || readHeight > height - y)
+        {
+            throw std::runtime_error{"Invalid region to read pixels from."};
+        }
+
+        // In a view of its own, so that the blit comes after the draws submitted so far.
+        FlushPendingDrawsForViewChange();
+        const bgfx::ViewId viewId = m_frameBufferManager.AcquireViewForBlit();
+
+        m_textureReadback.Read(viewId, texture, format, height, static_cast<uint16_t>(x), static_cast<uint16_t>(y), static_cast<uint16_t>(readWidth), static_cast<uint16_t>(readHeight),
+            [this, callbackRef](const ReadbackPixels& pixels) {
+                const Napi::Env env = callbackRef->Env();
+                const uint32_t size = pixels.GetSize();
+                Napi::ArrayBuffer buffer = AcquirePixelBuffer(env, size);
+                pixels.CopyTo(static_cast<uint8_t*>(buffer.Data()));
+                callbackRef->Call({Napi::Uint8Array::New(env, size, buffer, 0)});
+            });
+        ScheduleRender();
+    }
+
+    void NativeEngine::ReadBackBufferPixels(Napi::Function callback, uint32_t x, uint32_t y, uint32_t readWidth, uint32_t readHeight)
+    {
+        FlushPendingDraws();
+
+        // bgfx copies the back buffer when the frame is presented, the region is cut from the copy on the JavaScript
+        // thread. A region of 0 by 0 is the whole back buffer, whatever its size is then.
+        const auto callbackRef = std::make_shared<Napi::FunctionReference>(Napi::Persistent(callback));
+        m_graphicsImpl.Callback.addScreenShotCallback(m_runtime, [this, lifetime = std::weak_ptr<void>{m_lifetime}, callbackRef, x, y, readWidth, readHeight](const uint8_t* pixels, uint32_t width, uint32_t height) {
+            const Napi::Env env = callbackRef->Env();
+            const uint32_t regionWidth = readWidth == 0 ? width : readWidth;
+            const uint32_t regionHeight = readHeight == 0 ? height : readHeight;
+            if (x > width || y > height || regionWidth > width - x || regionHeight > height - y)
+            {
+                // The back buffer was resized since the read was requested.
+                callbackRef->Call({env.Null()});
+                return;
+            }
+
+            const size_t rowSize = static_cast<size_t>(regionWidth) * 4;
+            const uint32_t size = static_cast<uint32_t>(rowSize * regionHeight);
+            // Once the engine is gone, its buffers handed back by releasePixels are too.
+            Napi::ArrayBuffer buffer = lifetime.expired() ? Napi::ArrayBuffer::New(env, size) : AcquirePixelBuffer(env, size);
+            auto* destination = static_cast<uint8_t*>(buffer.Data());
+            for (uint32_t row = 0; row < regionHeight; ++row)
+            {
+                std::memcpy(destination + row * rowSize, pixels + (static_cast<size_t>(y + row) * width + x) * 4, rowSize);
+            }
+            callbackRef->Call({Napi::Uint8Array::New(env, size, buffer, 0)});
+        });
+        bgfx::requestScreenShot(BGFX_INVALID_HANDLE, "GetImageData");
+    }
+
+    Napi::ArrayBuffer NativeEngine::AcquirePixelBuffer(Napi::Env env, uint32_t size)
+    {
+        // Reuses a buffer handed back by releasePixels when one has the right size.
+        const auto it = std::find_if(m_pixelBuffers.begin(), m_pixelBuffers.end(), [size](const Napi::Reference<Napi::ArrayBuffer>& buffer) {
+            return buffer.Value().ByteLength() == size;
+        });
+        if (it == m_pixelBuffers.end())
+        {
+            return Napi::ArrayBuffer::New(env, size);
+        }
+
+        Napi::ArrayBuffer buffer = it->Value();
+        m_pixelBuffers.erase(it);
+        return buffer;
+    }
+
+    void NativeEngine::SetViewPortInternal(float x, float y, float width, float height)
+    {
+        FlushPendingDrawsForViewChange();
+
         const auto backbufferWidth = bgfx::getStats()->width;
         const auto backbufferHeight = bgfx::getStats()->height;
         const float yOrigin = bgfx::getCaps()->originBottomLeft ? y : (1.f - y - height);
 
-        m_frameBufferManager.GetBound().UseViewId(m_frameBufferManager.GetNewViewId());
-        const bgfx::ViewId viewId = m_frameBufferManager.GetBound().ViewId;
-        bgfx::setViewFrameBuffer(viewId, m_frameBufferManager.GetBound().FrameBuffer);
-        bgfx::setViewRect(viewId,
+        m_frameBufferManager.SetViewPort(
             static_cast<uint16_t>(x * backbufferWidth),
             static_cast<uint16_t>(yOrigin * backbufferHeight),
             static_cast<uint16_t>(width * backbufferWidth),
@@ -1469,11 +3335,53 @@ namespace Babylon
 
     void NativeEngine::GetFramebufferData(const Napi::CallbackInfo& info)
     {
-        bgfx::FrameBufferHandle fbh = BGFX_INVALID_HANDLE;
-        const auto callback = info[0].As<Napi::Function>();
+        ReadBackBufferPixels(info[0].As<Napi::Function>(), 0, 0, 0, 0);
+    }
+
+    void NativeEngine::ReadPixelsAsync(const Napi::CallbackInfo& info)
+    {
+        if (info[0].IsNull() || info[0].IsUndefined())
+        {
+            const uint32_t x = info[1].As<Napi::Number>().Uint32Value();
+            const uint32_t y = info[2].As<Napi::Number>().Uint32Value();
+            const uint32_t readWidth = info[3].As<Napi::Number>().Uint32Value();
+            const uint32_t readHeight = info[4].As<Napi::Number>().Uint32Value();
+            const uint32_t width = bgfx::getStats()->width;
+            const uint32_t height = bgfx::getStats()->height;
+            if (readWidth == 0 || readHeight == 0 || x > width || y > height || readWidth > width - x || readHeight > height - y)
+            {
+                throw std::runtime_error{"Invalid region to read pixels from."};
+            }
+
+            ReadBackBufferPixels(info[5].As<Napi::Function>(), x, y, readWidth, readHeight);
+            return;
+        }
+
+        const auto frameBufferData = info[0].As<Napi::External<FrameBufferData>>().Data();
+        if (!frameBufferData->PoolDescription)
+        {
+            throw std::runtime_error{"Unable to read pixels of a frame buffer not created by createFramebuffer."};
+        }
 
-        m_graphicsImpl.Callback.addScreenShotCallback(callback);
-        bgfx::requestScreenShot(fbh, "GetImageData");
+        ReadPixelsInternal(info, bgfx::getTexture(frameBufferData->FrameBuffer), frameBufferData->PoolDescription->Format, frameBufferData->Width, frameBufferData->Height);
+    }
+
+    void NativeEngine::ReadTexturePixelsAsync(const Napi::CallbackInfo& info)
+    {
+        const auto texture = info[0].As<Napi::External<TextureData>>().Data();
+        ReadPixelsInternal(info, texture->Handle, texture->Format, static_cast<uint16_t>(texture->Width), static_cast<uint16_t>(texture->Height));
+    }
+
+    void NativeEngine::ReleasePixels(const Napi::CallbackInfo& info)
+    {
+        // A few buffers are enough for reads made every frame, the oldest ones are left to the garbage collector.
+        constexpr size_t maxPixelBuffers{8};
+        if (m_pixelBuffers.size() == maxPixelBuffers)
+        {
+            m_pixelBuffers.erase(m_pixelBuffers.begin());
+        }
+
+        m_pixelBuffers.push_back(Napi::Persistent(info[0].As<Napi::TypedArray>().ArrayBuffer()));
     }
 
     Napi::Value NativeEngine::GetRenderAPI(const Napi::CallbackInfo& info)
@@ -1481,6 +3389,382 @@ namespace Babylon
         return Napi::Value::From(info.Env(), static_cast<int>(bgfx::getRendererType()));
     }
 
+    void NativeEngine::SubmitCommands(const Napi::CallbackInfo& info)
+    {
+        // The buffer is owned and reused by JavaScript; only the first byteLength bytes hold commands for this call.
+        const auto buffer = info[0].As<Napi::ArrayBuffer>();
+        const auto byteLength = info[1].IsUndefined() ? buffer.ByteLength() : static_cast<size_t>(info[1].As<Napi::Number>().Uint32Value());
+        if (byteLength > buffer.ByteLength() || byteLength % sizeof(uint32_t) != 0)
+        {
+            throw std::runtime_error{"Invalid command buffer length."};
+        }
+
+        const auto commands = gsl::make_span(static_cast<const uint32_t*>(buffer.Data()), byteLength / sizeof(uint32_t));
+        if (m_recordingBundle != nullptr)
+        {
+            m_recordingBundle->Commands.insert(m_recordingBundle->Commands.end(), commands.begin(), commands.end());
+            return;
+        }
+
+        ExecuteCommands(commands);
+    }
+
+    void NativeEngine::ExecuteCommands(gsl::span<const uint32_t> commands)
+    {
+        CommandStream stream{commands};
+        while (stream.HasMore())
+        {
+            const auto commandType = static_cast<CommandType>(stream.ReadUint32());
+            switch (commandType)
+            {
+                case CommandType::BindVertexArray:
+                    BindVertexArrayInternal(*stream.ReadPointer<VertexArray>(*m_commandHandles));
+                    break;
+                case CommandType::SetProgram:
+                    SetProgramInternal(stream.ReadPointer<ProgramData>(*m_commandHandles));
+                    break;
+                case CommandType::SetState:
+                {
+                    const auto culling = stream.ReadBoolean();
+                    const auto reverseSide = stream.ReadBoolean();
+                    SetStateInternal(culling, reverseSide);
+                    break;
+                }
+                case CommandType::SetDepthTest:
+                    SetDepthTestInternal(stream.ReadUint32());
+                    break;
+                case CommandType::SetDepthWrite:
+                    SetDepthWriteInternal(stream.ReadBoolean());
+                    break;
+                case CommandType::SetColorWrite:
+                    SetColorWriteInternal(stream.ReadBoolean());
+                    break;
+                case CommandType::SetBlendMode:
+                    SetBlendModeInternal(stream.ReadUint64());
+                    break;
+                case CommandType::SetInt:
+                {
+                    const auto& uniformInfo = *stream.ReadPointer<UniformInfo>(*m_commandHandles);
+                    const auto value = static_cast<float>(stream.ReadInt32());
+                    SetUniformValue(uniformInfo.Handle, gsl::make_span(&value, 1));
+                    break;
+                }
+                case CommandType::SetIntArray:
+                {
+                    const auto& uniformInfo = *stream.ReadPointer<UniformInfo>(*m_commandHandles);
+                    SetTypeArrayN<1>(uniformInfo, stream.ReadSpan<int32_t>());
+                    break;
+                }
+                case CommandType::SetIntArray2:
+                {
+                    const auto& uniformInfo = *stream.ReadPointer<UniformInfo>(*m_commandHandles);
+                    SetTypeArrayN<2>(uniformInfo, stream.ReadSpan<int32_t>());
+                    break;
+                }
+                case CommandType::SetIntArray3:
+                {
+                    const auto& uniformInfo = *stream.ReadPointer<UniformInfo>(*m_commandHandles);
+                    SetTypeArrayN<3>(uniformInfo, stream.ReadSpan<int32_t>());
+                    break;
+                }
+                case CommandType::SetIntArray4:
+                {
+                    const auto& uniformInfo = *stream.ReadPointer<UniformInfo>(*m_commandHandles);
+                    SetTypeArrayN<4>(uniformInfo, stream.ReadSpan<int32_t>());
+                    break;
+                }
+                case CommandType::SetFloatArray:
+                {
+                    const auto& uniformInfo = *stream.ReadPointer<UniformInfo>(*m_commandHandles);
+                    SetTypeArrayN<1>(uniformInfo, stream.ReadSpan<float>());
+                    break;
+                }
+                case CommandType::SetFloatArray2:
+                {
+                    const auto& uniformInfo = *stream.ReadPointer<UniformInfo>(*m_commandHandles);
+                    SetTypeArrayN<2>(uniformInfo, stream.ReadSpan<float>());
+                    break;
+                }
+                case CommandType::SetFloatArray3:
+                {
+                    const auto& uniformInfo = *stream.ReadPointer<UniformInfo>(*m_commandHandles);
+                    SetTypeArrayN<3>(uniformInfo, stream.ReadSpan<float>());
+                    break;
+                }
+                case CommandType::SetFloatArray4:
+                {
+                    const auto& uniformInfo = *stream.ReadPointer<UniformInfo>(*m_commandHandles);
+                    SetTypeArrayN<4>(uniformInfo, stream.ReadSpan<float>());
+                    break;
+                }
+                case CommandType::SetMatrices:
+                {
+                    const auto& uniformInfo = *stream.ReadPointer<UniformInfo>(*m_commandHandles);
+                    const auto matrices = stream.ReadSpan<float>();
+                    if (matrices.size() % 16 != 0)
+                    {
+                        throw std::runtime_error{"Command stream sets matrices from a number of floats that is not a multiple of 16."};
+                    }
+                    SetUniformValue(uniformInfo.Handle, matrices, static_cast<size_t>(matrices.size()) / 16);
+                    break;
+                }
+                case CommandType::SetMatrix3x3:
+                {
+                    const auto& uniformInfo = *stream.ReadPointer<UniformInfo>(*m_commandHandles);
+                    SetMatrixN<3>(uniformInfo, stream.ReadSpan<float>(9));
+                    break;
+                }
+                case CommandType::SetMatrix2x2:
+                {
+                    const auto& uniformInfo = *stream.ReadPointer<UniformInfo>(*m_commandHandles);
+                    SetMatrixN<2>(uniformInfo, stream.ReadSpan<float>(4));
+                    break;
+                }
+                case CommandType::SetMatrix:
+                {
+                    const auto& uniformInfo = *stream.ReadPointer<UniformInfo>(*m_commandHandles);
+                    SetMatrixN<4>(uniformInfo, stream.ReadSpan<float>(16));
+                    break;
+                }
+                case CommandType::SetFloat:
+                {
+                    const auto& uniformInfo = *stream.ReadPointer<UniformInfo>(*m_commandHandles);
+                    SetFloatN<1>(uniformInfo, stream.ReadSpan<float>(1).data());
+                    break;
+                }
+                case CommandType::SetFloat2:
+                {
+                    const auto& uniformInfo = *stream.ReadPointer<UniformInfo>(*m_commandHandles);
+                    SetFloatN<2>(uniformInfo, stream.ReadSpan<float>(2).data());
+                    break;
+                }
+                case CommandType::SetFloat3:
+                {
+                    const auto& uniformInfo = *stream.ReadPointer<UniformInfo>(*m_commandHandles);
+                    SetFloatN<3>(uniformInfo, stream.ReadSpan<float>(3).data());
+                    break;
+                }
+                case CommandType::SetFloat4:
+                {
+                    const auto& uniformInfo = *stream.ReadPointer<UniformInfo>(*m_commandHandles);
+                    SetFloatN<4>(uniformInfo, stream.ReadSpan<float>(4).data());
+                    break;
+                }
+                case CommandType::SetTexture:
+                {
+                    const auto& uniformInfo = *stream.ReadPointer<UniformInfo>(*m_commandHandles);
+                    SetTextureInternal(uniformInfo, *stream.ReadPointer<TextureData>(*m_commandHandles));
+                    break;
+                }
+                case CommandType::BindFrameBuffer:
+                    FlushPendingDrawsForViewChange();
+                    m_frameBufferManager.Bind(stream.ReadPointer<FrameBufferData>(*m_commandHandles));
+                    break;
+                case CommandType::UnbindFrameBuffer:
+                    FlushPendingDrawsForViewChange();
+                    m_frameBufferManager.Unbind(stream.ReadPointer<FrameBufferData>(*m_commandHandles));
+                    break;
+                case CommandType::DrawIndexed:
+                case CommandType::Draw:
+                {
+                    const auto fillMode = stream.ReadInt32();
+                    const auto elementStart = stream.ReadInt32();
+                    const auto elementCount = stream.ReadInt32();
+                    if (commandType == CommandType::DrawIndexed)
+                    {
+                        DrawIndexedInternal(fillMode, elementStart, elementCount);
+                    }
+                    else
+                    {
+                        DrawInternal(fillMode, elementStart, elementCount);
+                    }
+                    break;
+                }
+                case CommandType::DrawInstanced:
+                {
+                    const auto fillMode = stream.ReadInt32();
+                    const auto elementStart = stream.ReadInt32();
+                    const auto elementCount = stream.ReadInt32();
+                    DrawInstancedInternal(fillMode, elementStart, elementCount, stream.ReadUint32());
+                    break;
+                }
+                case CommandType::Clear:
+                    FlushPendingDrawsForViewChange();
+                    m_frameBufferManager.PrepareClear();
+                    m_frameBufferManager.GetBound().ViewClearState.UpdateFlags(static_cast<uint16_t>(stream.ReadUint32()));
+                    break;
+                case CommandType::ClearColor:
+                {
+                    FlushPendingDrawsForViewChange();
+                    m_frameBufferManager.PrepareClear();
+                    const auto color = stream.ReadSpan<float>(4);
+                    m_frameBufferManager.GetBound().ViewClearState.UpdateColor(color[0], color[1], color[2], color[3]);
+                    break;
+                }
+                case CommandType::ClearDepth:
+                    FlushPendingDrawsForViewChange();
+                    m_frameBufferManager.PrepareClear();
+                    m_frameBufferManager.GetBound().ViewClearState.UpdateDepth(stream.ReadFloat());
+                    break;
+                case CommandType::ClearStencil:
+                    FlushPendingDrawsForViewChange();
+                    m_frameBufferManager.PrepareClear();
+                    m_frameBufferManager.GetBound().ViewClearState.UpdateStencil(static_cast<uint8_t>(stream.ReadInt32()));
+                    break;
+                case CommandType::SetViewPort:
+                {
+                    const auto viewPort = stream.ReadSpan<float>(4);
+                    SetViewPortInternal(viewPort[0], viewPort[1], viewPort[2], viewPort[3]);
+                    break;
+                }
+                default:
+                    throw std::runtime_error{"Unrecognized command type."};
+            }
+        }
+    }
+
+    Napi::Value NativeEngine::GetCommandHandle(const Napi::CallbackInfo& info)
+    {
+        // Native objects are referenced from the command buffer by address, split into two 32-bit words. The objects
+        // are registered with their type when created, so that the commands can check what the address refers to.
+        const auto address = reinterpret_cast<uintptr_t>(info[0].As<Napi::External<void>>().Data());
+        if (!m_commandHandles->Contains(reinterpret_cast<const void*>(address)))
+        {
+            throw std::runtime_error{"Command buffers can only refer to vertex arrays, programs, uniforms, textures and frame buffers."};
+        }
+
+        auto handle = Napi::Array::New(info.Env(), 2);
+        handle[0u] = Napi::Value::From(info.Env(), static_cast<uint32_t>(static_cast<uint64_t>(address) & 0xFFFFFFFF));
+        handle[1u] = Napi::Value::From(info.Env(), static_cast<uint32_t>(static_cast<uint64_t>(address) >> 32));
+        return std::move(handle);
+    }
+
+    Napi::Value NativeEngine::GetSubmitStatistics(const Napi::CallbackInfo& info)
+    {
+        const auto& statistics = m_uniformShadowState.GetStatistics();
+        const auto& bindingStatistics = m_bindingShadowState.GetStatistics();
+
+        auto result = Napi::Object::New(info.Env());
+        result.Set("uniformsSubmitted", static_cast<double>(statistics.UniformsSubmitted));
+        result.Set("uniformsElided", static_cast<double>(statistics.UniformsElided));
+        result.Set("bindingsSubmitted", static_cast<double>(bindingStatistics.BindingsSubmitted));
+        result.Set("bindingsElided", static_cast<double>(bindingStatistics.BindingsElided));
+        result.Set("drawsMerged", static_cast<double>(m_mergedDrawCount));
+        result.Set("instancedDraws", static_cast<double>(m_instancedDrawCount));
+        result.Set("viewsUsed", static_cast<double>(m_frameBufferManager.GetStatistics().ViewsUsed));
+        result.Set("clearsDropped", static_cast<double>(m_frameBufferManager.GetStatistics().ClearsDropped));
+        result.Set("passesMerged", static_cast<double>(m_frameBufferManager.GetStatistics().PassesMerged));
+        return std::move(result);
+    }
+
+    void NativeEngine::SetProgramInternal(ProgramData* program)
+    {
+        m_currentProgram = program;
+        if (m_executingBundle.Bundle != nullptr)
+        {
+            ApplyBundlePatches();
+        }
+    }
+
+    void NativeEngine::ThrowIfRecordingBundle() const
+    {
+        // Only the command buffers are recorded, calling the method would render now instead of when the bundle is executed.
+        if (m_recordingBundle != nullptr)
+        {
+            throw std::runtime_error{"Rendering methods cannot be called while a bundle is being recorded, submit commands instead."};
+        }
+    }
+
+    void NativeEngine::BeginBundle(const Napi::CallbackInfo& info)
+    {
+        if (m_recordingBundle != nullptr)
+        {
+            throw std::runtime_error{"A bundle is already being recorded."};
+        }
+
+        auto bundle = std::make_unique<RenderBundle>();
+        if (!info[0].IsUndefined())
+        {
+            const auto patchableUniforms = info[0].As<Napi::Array>();
+            bundle->PatchableUniforms.reserve(patchableUniforms.Length());
+            for (uint32_t index = 0; index < patchableUniforms.Length(); ++index)
+            {
+                const auto uniformInfo = patchableUniforms.Get(index).As<Napi::External<UniformInfo>>().Data();
+                bundle->PatchableUniforms.push_back(uniformInfo->Handle);
+            }
+        }
+
+        m_recordingBundle = std::move(bundle);
+    }
+
+    Napi::Value NativeEngine::EndBundle(const Napi::CallbackInfo& info)
+    {
+        if (m_recordingBundle == nullptr)
+        {
+            throw std::runtime_error{"No bundle is being recorded."};
+        }
+
+        m_recordingBundle->Commands.shrink_to_fit();
+        return Napi::External<RenderBundle>::New(info.Env(), m_recordingBundle.release(), [](Napi::Env, RenderBundle* bundle) { delete bundle; });
+    }
+
+    void NativeEngine::ExecuteBundle(const Napi::CallbackInfo& info)
+    {
+        if (m_recordingBundle != nullptr)
+        {
+            throw std::runtime_error{"Bundles cannot be executed while a bundle is being recorded."};
+        }
+
+        if (m_executingBundle.Bundle != nullptr)
+        {
+            throw std::runtime_error{"Bundles cannot be executed from another bundle."};
+        }
+
+        const auto& bundle = *info[0].As<Napi::External<RenderBundle>>().Data();
+
+        // One Float32Array per patchable uniform, in the order given to beginBundle.
+        std::vector<gsl::span<const float>> values{};
+        values.reserve(bundle.PatchableUniforms.size());
+        const auto patchValues = info[1].IsUndefined() ? Napi::Array::New(info.Env()) : info[1].As<Napi::Array>();
+        if (patchValues.Length() != bundle.PatchableUniforms.size())
+        {
+            throw std::runtime_error{"A value must be given for each patchable uniform of the bundle."};
+        }
+
+        for (uint32_t index = 0; index < patchValues.Length(); ++index)
+        {
+            const auto array = patchValues.Get(index).As<Napi::Float32Array>();
+            values.push_back(gsl::make_span(array.Data(), array.ElementLength()));
+        }
+
+        m_executingBundle.Bundle = &bundle;
+        m_executingBundle.Values = std::move(values);
+        auto finally = gsl::finally([this]() { m_executingBundle = {}; });
+
+        // The program set before the bundle is executed may be used by its first draws.
+        if (m_currentProgram != nullptr)
+        {
+            ApplyBundlePatches();
+        }
+
+        ExecuteCommands(bundle.Commands);
+    }
+
+    void NativeEngine::ApplyBundlePatches()
+    {
+        const auto& patchableUniforms = m_executingBundle.Bundle->PatchableUniforms;
+        for (size_t index = 0; index < patchableUniforms.size(); ++index)
+        {
+            const auto handle = patchableUniforms[index];
+            const auto elementSize = m_currentProgram->GetUniformElementSize(handle);
+            if (elementSize != 0)
+            {
+                const auto& value = m_executingBundle.Values[index];
+                UpdateUniformValue(handle, value, std::max<size_t>(static_cast<size_t>(value.size()) / elementSize, 1));
+            }
+        }
+    }
+
     void NativeEngine::Dispatch(std::function<void()> function)
     {
         m_runtime.Dispatch([function = std::move(function)](Napi::Env) {
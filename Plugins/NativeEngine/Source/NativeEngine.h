@@ -2,6 +2,19 @@
 
 #include "ShaderCompiler.h"
 #include "BgfxCallback.h"
+#include "BindingShadowState.h"
+#include "CommandStream.h"
+#include "MipGeneration.h"
+#include "RenderTargetPool.h"
+#include "StagingBufferRing.h"
+#include "TextureCache.h"
+#include "TextureCompression.h"
+#include "TextureReadback.h"
+#include "TextureResidency.h"
+#include "TextureStreamer.h"
+#include "UniformShadowState.h"
+#include "VertexLayoutCache.h"
+#include "VertexQuantization.h"
 
 #include <Babylon/JsRuntime.h>
 #include <Babylon/JsRuntimeScheduler.h>
@@ -14,6 +27,7 @@
 #include <bgfx/platform.h>
 #include <bimg/bimg.h>
 #include <bx/allocator.h>
+#include <bx/math.h>
 
 #include <gsl/gsl>
 
@@ -21,7 +35,16 @@
 
 #include <arcana/containers/weak_table.h>
 #include <arcana/threading/cancellation.h>
+#include <algorithm>
+#include <array>
+#include <cstring>
+#include <memory>
+#include <mutex>
+#include <numeric>
+#include <optional>
+#include <stdexcept>
 #include <unordered_map>
+#include <utility>
 
 namespace Babylon
 {
@@ -41,16 +64,14 @@ namespace Babylon
             }
         }
 
-        void UpdateFlags(const Napi::CallbackInfo& info)
+        void UpdateFlags(uint16_t flags)
         {
-            const auto flags = static_cast<uint16_t>(info[0].As<Napi::Number>().Uint32Value());
             Flags = flags;
             Update();
         }
 
-        void UpdateDepth(const Napi::CallbackInfo& info)
+        void UpdateDepth(float depth)
         {
-            const auto depth = info[0].As<Napi::Number>().FloatValue();
             const bool needToUpdate = Depth != depth;
             if (needToUpdate)
             {
@@ -59,9 +80,8 @@ namespace Babylon
             }
         }
 
-        void UpdateStencil(const Napi::CallbackInfo& info)
+        void UpdateStencil(uint8_t stencil)
         {
-            const auto stencil = static_cast<uint8_t>(info[0].As<Napi::Number>().Int32Value());
             const bool needToUpdate = Stencil != stencil;
             if (needToUpdate)
             {
@@ -133,30 +153,57 @@ namespace Babylon
 
         void UpdateFlags(const Napi::CallbackInfo& info)
         {
-            m_clearState.UpdateFlags(info);
+            UpdateFlags(static_cast<uint16_t>(info[0].As<Napi::Number>().Uint32Value()));
+        }
+
+        void UpdateFlags(uint16_t flags)
+        {
+            m_clearState.UpdateFlags(flags);
         }
 
         void UpdateDepth(const Napi::CallbackInfo& info)
         {
-            m_clearState.UpdateDepth(info);
+            UpdateDepth(info[0].As<Napi::Number>().FloatValue());
+        }
+
+        void UpdateDepth(float depth)
+        {
+            m_clearState.UpdateDepth(depth);
         }
 
         void UpdateStencil(const Napi::CallbackInfo& info)
         {
-            m_clearState.UpdateStencil(info);
+            UpdateStencil(static_cast<uint8_t>(info[0].As<Napi::Number>().Int32Value()));
         }
 
+        void UpdateStencil(uint8_t stencil)
+        {
+            m_clearState.UpdateStencil(stencil);
+        }
+
+        uint16_t Flags() const
+        {
+            return m_clearState.Flags;
+        }
+
+        // Moves the clear values to another view. Unlike a change of the clear values, this keeps the
+        // state set on the encoder, as views are set up when the first draw call of a pass is submitted.
         void UpdateViewId(uint16_t viewId)
         {
             m_viewId = viewId;
-            Update();
+            SetViewClear();
         }
 
     private:
 
-        void Update() const
+        void SetViewClear() const
         {
             bgfx::setViewClear(m_viewId, m_clearState.Flags, m_clearState.Color(), m_clearState.Depth, m_clearState.Stencil);
+        }
+
+        void Update() const
+        {
+            SetViewClear();
             // discard any previous set state
             bgfx::discard();
         }
@@ -200,7 +247,10 @@ namespace Babylon
 
         ~FrameBufferData()
         {
-            bgfx::destroy(FrameBuffer);
+            if (bgfx::isValid(FrameBuffer))
+            {
+                bgfx::destroy(FrameBuffer);
+            }
         }
 
         void UseViewId(uint16_t viewId)
@@ -209,13 +259,6 @@ namespace Babylon
             ViewClearState.UpdateViewId(ViewId);
         }
 
-        void SetUpView(uint16_t viewId)
-        {
-            bgfx::setViewFrameBuffer(viewId, FrameBuffer);
-            UseViewId(viewId);
-            bgfx::setViewRect(ViewId, 0, 0, Width, Height);
-        }
-
         bgfx::FrameBufferHandle FrameBuffer{bgfx::kInvalidHandle};
         bgfx::ViewId ViewId{};
         Babylon::ViewClearState ViewClearState;
@@ -226,35 +269,37 @@ namespace Babylon
         // When this flag is true, projection matrix will not be flipped for API that would normaly need it.
         // Namely Direct3D and Metal.
         bool ActAsBackBuffer{false};
+        // Set for the render targets created by the engine, whose frame buffer returns to the pool when deleted.
+        std::optional<RenderTargetDescription> PoolDescription{};
     };
 
     struct FrameBufferManager final
     {
-        FrameBufferManager()
+        FrameBufferManager(CommandHandleTable& commandHandles)
+            : m_commandHandles{commandHandles}
         {
-            m_boundFrameBuffer = m_backBuffer = new FrameBufferData(BGFX_INVALID_HANDLE, GetNewViewId(), bgfx::getStats()->width, bgfx::getStats()->height);
+            m_boundFrameBuffer = m_backBuffer = new FrameBufferData(BGFX_INVALID_HANDLE, GetScratchViewId(), bgfx::getStats()->width, bgfx::getStats()->height);
+            m_requestedRect = m_backBufferRect = {0, 0, m_backBuffer->Width, m_backBuffer->Height};
         }
 
         FrameBufferData* CreateNew(bgfx::FrameBufferHandle frameBufferHandle, uint16_t width, uint16_t height)
         {
-            return new FrameBufferData(frameBufferHandle, GetNewViewId(), width, height);
+            auto* data = new FrameBufferData(frameBufferHandle, GetScratchViewId(), width, height);
+            m_commandHandles.Register(data);
+            return data;
         }
 
         FrameBufferData* CreateNew(bgfx::FrameBufferHandle frameBufferHandle, ClearState& clearState, uint16_t width, uint16_t height, bool actAsBackBuffer)
         {
-            return new FrameBufferData(frameBufferHandle, GetNewViewId(), clearState, width, height, actAsBackBuffer);
+            auto* data = new FrameBufferData(frameBufferHandle, GetScratchViewId(), clearState, width, height, actAsBackBuffer);
+            m_commandHandles.Register(data);
+            return data;
         }
 
         void Bind(FrameBufferData* data)
         {
             m_boundFrameBuffer = data;
-
-            // TODO: Consider doing this only on bgfx::reset(); the effects of this call don't survive reset, but as
-            // long as there's no reset this doesn't technically need to be called every time the frame buffer is bound.
-            m_boundFrameBuffer->SetUpView(GetNewViewId());
-
-            // bgfx::setTexture()? Why?
-            // TODO: View order?
+            m_requestedRect = {0, 0, m_boundFrameBuffer->Width, m_boundFrameBuffer->Height};
             m_renderingToTarget = !m_boundFrameBuffer->ActAsBackBuffer;
         }
 
@@ -269,19 +314,190 @@ namespace Babylon
             //assert(m_boundFrameBuffer == data);
             (void)data;
             m_boundFrameBuffer = m_backBuffer;
+            m_requestedRect = m_backBufferRect;
             m_renderingToTarget = false;
         }
 
+        void SetViewPort(uint16_t x, uint16_t y, uint16_t width, uint16_t height)
+        {
+            m_requestedRect = {x, y, width, height};
+            if (m_boundFrameBuffer == m_backBuffer)
+            {
+                m_backBufferRect = m_requestedRect;
+            }
+        }
+
+        // Binding a frame buffer or setting the viewport only records the requested pass. The view is set up
+        // when the pass draws or clears, so that passes that do neither never use a view.
+        bgfx::ViewId AcquireViewForDraw()
+        {
+            if (!IsCurrentViewRequested())
+            {
+                UseNewView();
+            }
+
+            m_currentView.HasDraws = true;
+            return m_currentView.Id;
+        }
+
+        // Must be called before the clear values of the bound frame buffer are updated. A clear is performed
+        // by bgfx at the start of a view, so a view that already has draws cannot be cleared again.
+        void PrepareClear()
+        {
+            if (!IsCurrentViewRequested() || m_currentView.HasDraws)
+            {
+                UseNewView();
+            }
+
+            m_currentView.HasClear = true;
+        }
+
+        // Hands out a view for blits that must happen after the draws submitted so far. The passes that follow
+        // use new views, so that their draws come after the blits.
+        bgfx::ViewId AcquireViewForBlit()
+        {
+            RetireCurrentView();
+            m_currentView = {};
+
+            // A blit may read what was cleared, such as a readback of the render target, so it is counted as a draw
+            // and the clears before it are never dropped.
+            m_drawCount++;
+            return GetNewViewId();
+        }
+
+        void OnDrawSubmitted()
+        {
+            m_drawCount++;
+        }
+
+        // Forgets the views set up with a frame buffer that is about to be destroyed, as its handle may be reused.
+        void OnFrameBufferDestroyed(const FrameBufferData& data)
+        {
+            m_commandHandles.Unregister(&data);
+
+            for (auto& view : m_views)
+            {
+                if (view.FrameBuffer.idx == data.FrameBuffer.idx)
+                {
+                    view.Valid = false;
+                }
+            }
+
+            if (m_currentView.FrameBuffer == &data)
+            {
+                m_currentView = {};
+            }
+
+            FreeClearOnlyViews([&data](const auto& view) {
+                return view.FrameBuffer == &data;
+            });
+        }
+
+        // Ends the passes of the frame. bgfx skips the views without draws, so the views that were cleared
+        // but not drawn to are touched, except when their clear is overwritten before anything is drawn.
+        void FinishFrame()
+        {
+            RetireCurrentView();
+            for (const auto& view : m_clearOnlyViews)
+            {
+                bgfx::touch(view.Id);
+            }
+
+            m_clearOnlyViews.clear();
+
+            if (m_viewsRecycled)
+            {
+                // Recycled views were handed out after views with higher ids, so bgfx is given the order in
+                // which the views were handed out. The order maps each view id to its position.
+                std::vector<bgfx::ViewId> ids(m_viewHandOutOrder.size());
+                std::iota(ids.begin(), ids.end(), bgfx::ViewId{0});
+                std::stable_sort(ids.begin(), ids.end(), [this](bgfx::ViewId a, bgfx::ViewId b) {
+                    return m_viewHandOutOrder[a] < m_viewHandOutOrder[b];
+                });
+
+                std::vector<bgfx::ViewId> order(ids.size());
+                for (size_t position = 0; position < ids.size(); ++position)
+                {
+                    order[ids[position]] = static_cast<bgfx::ViewId>(position);
+                }
+
+                bgfx::setViewOrder();
+                bgfx::setViewOrder(0, static_cast<uint16_t>(order.size()), order.data());
+                m_viewOrderSet = true;
+            }
+            else if (m_viewOrderSet)
+            {
+                bgfx::setViewOrder();
+                m_viewOrderSet = false;
+            }
+        }
+
+        struct Statistics
+        {
+            uint64_t ViewsUsed{};
+            uint64_t ClearsDropped{};
+            uint64_t PassesMerged{};
+        };
+
+        const Statistics& GetStatistics() const
+        {
+            return m_statistics;
+        }
+
         uint16_t GetNewViewId()
         {
-            m_nextId++;
-            assert(m_nextId < bgfx::getCaps()->limits.maxViews);
-            return m_nextId;
+            uint16_t viewId{};
+            if (!m_freeViewIds.empty())
+            {
+                // Views whose clear was dropped have no effect, so they are reused before new ones.
+                viewId = m_freeViewIds.back();
+                m_freeViewIds.pop_back();
+                m_viewsRecycled = true;
+            }
+            else
+            {
+                // The views are otherwise handed out in increasing order, so the default view order matches
+                // the submission order.
+                if (m_nextId + 1 >= GetScratchViewId())
+                {
+                    // Out of views, the passes that follow are merged into the last view. Their draws still execute
+                    // in order, but with the frame buffer and rect of the last of them. The merges are counted in
+                    // the statistics.
+                    viewId = m_nextId;
+                    m_viewHandOutOrder.resize(viewId + 1);
+                    m_statistics.PassesMerged++;
+                }
+                else
+                {
+                    viewId = ++m_nextId;
+                    m_viewHandOutOrder.resize(viewId + 1);
+                }
+            }
+
+            m_viewHandOutOrder[viewId] = ++m_viewHandOutCount;
+            return viewId;
         }
 
-        void Reset()
+        // Starts a new frame. Passing the number of bgfx resets performed so far allows the view
+        // configuration kept by bgfx to be trusted until the next reset.
+        void Reset(uint32_t resetCount)
         {
             m_nextId = 0;
+            m_freeViewIds.clear();
+            m_viewHandOutOrder.clear();
+            m_viewHandOutCount = 0;
+            m_viewsRecycled = false;
+            m_currentView = {};
+            m_drawCount = 0;
+
+            if (resetCount != m_resetCount)
+            {
+                m_resetCount = resetCount;
+                for (auto& view : m_views)
+                {
+                    view.Valid = false;
+                }
+            }
         }
 
         bool IsRenderingToTarget() const
@@ -290,27 +506,192 @@ namespace Babylon
         }
 
     private:
+        struct ViewRect
+        {
+            uint16_t X{};
+            uint16_t Y{};
+            uint16_t Width{};
+            uint16_t Height{};
+
+            bool operator==(const ViewRect& other) const
+            {
+                return X == other.X && Y == other.Y && Width == other.Width && Height == other.Height;
+            }
+        };
+
+        // Configuration last sent to bgfx for a view.
+        struct ViewState
+        {
+            bgfx::FrameBufferHandle FrameBuffer{bgfx::kInvalidHandle};
+            ViewRect Rect{};
+            bool Valid{false};
+        };
+
+        bool IsCurrentViewRequested() const
+        {
+            return m_currentView.FrameBuffer == m_boundFrameBuffer && m_boundFrameBuffer->ViewId == m_currentView.Id && m_views[m_currentView.Id].Rect == m_requestedRect;
+        }
+
+        void UseNewView()
+        {
+            RetireCurrentView();
+
+            auto& data = *m_boundFrameBuffer;
+            const auto& rect = m_requestedRect;
+            const uint16_t viewId = GetNewViewId();
+            if (m_views.size() <= viewId)
+            {
+                m_views.resize(viewId + 1);
+            }
+
+            auto& view = m_views[viewId];
+            if (!view.Valid)
+            {
+                // Draw calls are executed in the order they are submitted, as with WebGL. This is also
+                // required for skipping the upload of uniform values that are already set (see UniformShadowState).
+                bgfx::setViewMode(viewId, bgfx::ViewMode::Sequential);
+            }
+
+            if (!view.Valid || view.FrameBuffer.idx != data.FrameBuffer.idx)
+            {
+                bgfx::setViewFrameBuffer(viewId, data.FrameBuffer);
+            }
+
+            if (!view.Valid || !(view.Rect == rect))
+            {
+                bgfx::setViewRect(viewId, rect.X, rect.Y, rect.Width, rect.Height);
+            }
+
+            view = {data.FrameBuffer, rect, true};
+            data.UseViewId(viewId);
+            m_currentView = {viewId, &data, false, false, m_drawCount};
+            m_statistics.ViewsUsed++;
+        }
+
+        void RetireCurrentView()
+        {
+            if (m_currentView.FrameBuffer == nullptr || !m_currentView.HasClear)
+            {
+                return;
+            }
+
+            // Clears of the same frame buffer and rect made before this one with nothing drawn in between
+            // are overwritten by this clear when it covers the same buffers.
+            const auto& rect = m_views[m_currentView.Id].Rect;
+            const uint16_t flags = m_currentView.FrameBuffer->ViewClearState.Flags();
+            m_statistics.ClearsDropped += FreeClearOnlyViews([&](const auto& view) {
+                return view.FrameBuffer == m_currentView.FrameBuffer &&
+                       view.DrawCount == m_currentView.DrawCountAtStart &&
+                       m_views[view.Id].Rect == rect &&
+                       (view.Flags & ~flags) == 0;
+            });
+
+            if (!m_currentView.HasDraws)
+            {
+                m_clearOnlyViews.push_back({m_currentView.Id, m_currentView.FrameBuffer, flags, m_drawCount});
+            }
+        }
+
+        // Frame buffers are given the last view until a pass uses them. Nothing is submitted to that view, so
+        // changes of their clear values made before then have no effect on the passes of the frame.
+        static uint16_t GetScratchViewId()
+        {
+            return static_cast<uint16_t>(bgfx::getCaps()->limits.maxViews - 1);
+        }
+
+        // Erases the clear-only views matching the predicate and makes their ids available again. Returns the
+        // number of views erased.
+        template<typename PredicateT>
+        uint64_t FreeClearOnlyViews(PredicateT predicate)
+        {
+            const auto first = std::stable_partition(m_clearOnlyViews.begin(), m_clearOnlyViews.end(), [&predicate](const ClearOnlyView& view) {
+                return !predicate(view);
+            });
+            for (auto it = first; it != m_clearOnlyViews.end(); ++it)
+            {
+                m_freeViewIds.push_back(it->Id);
+            }
+
+            const auto count = static_cast<uint64_t>(std::distance(first, m_clearOnlyViews.end()));
+            m_clearOnlyViews.erase(first, m_clearOnlyViews.end());
+            return count;
+        }
+
+        // Frame buffers are registered there when created, so that command buffers can refer to them.
+        CommandHandleTable& m_commandHandles;
+
         FrameBufferData* m_boundFrameBuffer{nullptr};
         FrameBufferData* m_backBuffer{nullptr};
         uint16_t m_nextId{0};
+
+        // Ids of the views handed out during the frame that can be handed out again.
+        std::vector<uint16_t> m_freeViewIds{};
+
+        // Indexed by view id, the order in which the views were last handed out during the frame.
+        std::vector<uint32_t> m_viewHandOutOrder{};
+        uint32_t m_viewHandOutCount{};
+        bool m_viewsRecycled{false};
+        bool m_viewOrderSet{false};
         bool m_renderingToTarget{false};
+
+        // Indexed by view id.
+        std::vector<ViewState> m_views{};
+        uint32_t m_resetCount{};
+
+        // Rect of the pass requested by the last Bind, Unbind or SetViewPort.
+        ViewRect m_requestedRect{};
+
+        // Rect restored when the back buffer is bound again.
+        ViewRect m_backBufferRect{};
+
+        // The view draws and clears are currently submitted to.
+        struct
+        {
+            bgfx::ViewId Id{};
+            const FrameBufferData* FrameBuffer{};
+            bool HasDraws{false};
+            bool HasClear{false};
+            uint64_t DrawCountAtStart{};
+        } m_currentView{};
+
+        // Views of the frame that were cleared without being drawn to.
+        struct ClearOnlyView
+        {
+            bgfx::ViewId Id{};
+            const FrameBufferData* FrameBuffer{};
+            uint16_t Flags{};
+            uint64_t DrawCount{};
+        };
+        std::vector<ClearOnlyView> m_clearOnlyViews{};
+
+        // Number of draws and blits submitted during the frame.
+        uint64_t m_drawCount{};
+
+        Statistics m_statistics{};
     };
 
     struct TextureData final
     {
         ~TextureData()
         {
-            if (bgfx::isValid(Handle))
+            if (OwnsHandle && bgfx::isValid(Handle))
             {
                 bgfx::destroy(Handle);
             }
         }
 
         bgfx::TextureHandle Handle{bgfx::kInvalidHandle};
+        // Cleared for the color attachment of a render target, which is destroyed with its frame buffer.
+        bool OwnsHandle{true};
+        // Set for the color attachment of a render target, whose pixels can be read back.
+        bgfx::TextureFormat::Enum Format{bgfx::TextureFormat::Unknown};
         uint32_t Width{0};
         uint32_t Height{0};
         uint32_t Flags{0};
         uint8_t AnisotropicLevel{0};
+
+        // Frame the texture was last bound in, tracked when binding for the texture memory budget.
+        mutable uint32_t LastUsedFrame{0};
     };
 
     struct ImageData final
@@ -349,22 +730,193 @@ namespace Babylon
 
         bgfx::ProgramHandle Program{};
 
+        // The sources, for the variants of the program compiled on demand.
+        std::string VertexSource{};
+        std::string FragmentSource{};
+
+        // Variants reading other per-instance attributes than world0..world3 from the instance data registers,
+        // keyed by the names of the attributes of each register. Null when the variant cannot be compiled.
+        std::unordered_map<std::string, std::unique_ptr<ProgramData>> InstanceVariants{};
+
+        // Auto-instancing (see NativeEngine::SetAutoInstancing). The instanced program is compiled on first use
+        // from the sources, with the world uniform replaced by per-instance attributes.
+        bgfx::UniformHandle WorldUniform{bgfx::kInvalidHandle};
+        std::unique_ptr<ProgramData> InstancedProgram{};
+
+        // The values of all the uniforms of the program are stored in one contiguous block (UniformData).
+        // Each uniform owns a fixed slot of that block whose size is known from shader reflection.
         struct UniformValue
         {
-            std::vector<float> Data{};
+            bgfx::UniformHandle Handle{bgfx::kInvalidHandle};
+            uint32_t Offset{};
+            uint16_t Capacity{};
+            uint16_t ElementSize{};
             uint16_t ElementLength{};
             bool YFlip{false};
+            bool Dirty{false};
+
+            // Y-flipped copy of the value used when rendering to a texture, stored right after the value.
+            // It is only computed when needed and only recomputed after the value changes.
+            bool FlippedValid{false};
+
+            gsl::span<const float> Data(const std::vector<float>& uniformData) const
+            {
+                return gsl::make_span(uniformData.data() + Offset, static_cast<size_t>(ElementLength) * ElementSize);
+            }
+
+            gsl::span<const float> FlippedData(std::vector<float>& uniformData)
+            {
+                float* flipped = uniformData.data() + Offset + static_cast<size_t>(Capacity) * ElementSize;
+                if (!FlippedValid)
+                {
+                    static const float flipMatrix[16] = {1.f, 0.f, 0.f, 0.f,
+                        0.f, -1.f, 0.f, 0.f,
+                        0.f, 0.f, 1.f, 0.f,
+                        0.f, 0.f, 0.f, 1.f};
+                    const float* source = uniformData.data() + Offset;
+                    for (size_t element = 0; element < ElementLength; ++element)
+                    {
+                        bx::mtxMul(flipped + element * 16, source + element * 16, flipMatrix);
+                    }
+                    FlippedValid = true;
+                }
+
+                return gsl::make_span(static_cast<const float*>(flipped), static_cast<size_t>(ElementLength) * ElementSize);
+            }
         };
 
-        std::unordered_map<uint16_t, UniformValue> Uniforms{};
+        std::vector<float> UniformData{};
+        std::vector<UniformValue> Uniforms{};
+
+        void AddUniform(bgfx::UniformHandle handle, bgfx::UniformType::Enum type, uint16_t registerCount, bool YFlip)
+        {
+            if (FindUniform(handle) != nullptr)
+            {
+                // Uniform is shared by the vertex and fragment shaders.
+                return;
+            }
+
+            UniformValue& value = Uniforms.emplace_back();
+            value.Handle = handle;
+            value.Offset = static_cast<uint32_t>(UniformData.size());
+            value.ElementSize = static_cast<uint16_t>(type == bgfx::UniformType::Mat4 ? 16 : type == bgfx::UniformType::Mat3 ? 9 : 4);
+            value.Capacity = static_cast<uint16_t>(std::max<size_t>(registerCount * 4 / value.ElementSize, 1));
+            value.YFlip = YFlip && type == bgfx::UniformType::Mat4;
+            UniformData.resize(UniformData.size() + static_cast<size_t>(value.Capacity) * value.ElementSize * (value.YFlip ? 2 : 1));
+
+            if (m_uniformIndices.size() <= handle.idx)
+            {
+                m_uniformIndices.resize(handle.idx + 1, kInvalidUniformIndex);
+            }
+            m_uniformIndices[handle.idx] = static_cast<uint16_t>(Uniforms.size() - 1);
+        }
+
+        void SetUniform(bgfx::UniformHandle handle, gsl::span<const float> data, size_t elementLength = 1)
+        {
+            UniformValue* value = FindUniform(handle);
+            if (value == nullptr)
+            {
+                // The uniform is not used by this program.
+                return;
+            }
+
+            const size_t floatCount = std::min(static_cast<size_t>(data.size()), static_cast<size_t>(value->Capacity) * value->ElementSize);
+            std::memcpy(UniformData.data() + value->Offset, data.data(), floatCount * sizeof(float));
+            value->ElementLength = static_cast<uint16_t>(std::min(elementLength, static_cast<size_t>(value->Capacity)));
+            value->FlippedValid = false;
+            value->Dirty = true;
+        }
+
+        // Returns true when setting the value would not change the uniform.
+        bool HasUniformValue(bgfx::UniformHandle handle, gsl::span<const float> data, size_t elementLength = 1) const
+        {
+            const UniformValue* value = FindUniform(handle);
+            if (value == nullptr)
+            {
+                return true;
+            }
+
+            const size_t floatCount = std::min(static_cast<size_t>(data.size()), static_cast<size_t>(value->Capacity) * value->ElementSize);
+            return value->ElementLength == std::min(elementLength, static_cast<size_t>(value->Capacity)) &&
+                   std::memcmp(UniformData.data() + value->Offset, data.data(), floatCount * sizeof(float)) == 0;
+        }
+
+        // Returns the number of floats of one element of the uniform, or 0 if the program does not use the uniform.
+        uint16_t GetUniformElementSize(bgfx::UniformHandle handle) const
+        {
+            const UniformValue* value = FindUniform(handle);
+            return value == nullptr ? 0 : value->ElementSize;
+        }
+
+        gsl::span<const float> GetUniformData(bgfx::UniformHandle handle) const
+        {
+            const UniformValue* value = FindUniform(handle);
+            return value == nullptr ? gsl::span<const float>{} : value->Data(UniformData);
+        }
+
+        // Marks every uniform that holds a value as needing to be uploaded on the next draw.
+        void MarkUniformsDirty()
+        {
+            for (auto& value : Uniforms)
+            {
+                value.Dirty = value.ElementLength > 0;
+            }
+        }
 
-        void SetUniform(bgfx::UniformHandle handle, gsl::span<const float> data, bool YFlip, size_t elementLength = 1)
+    private:
+        static constexpr uint16_t kInvalidUniformIndex{UINT16_MAX};
+
+        const UniformValue* FindUniform(bgfx::UniformHandle handle) const
         {
-            UniformValue& value = Uniforms[handle.idx];
-            value.Data.assign(data.begin(), data.end());
-            value.ElementLength = static_cast<uint16_t>(elementLength);
-            value.YFlip = YFlip;
+            if (handle.idx >= m_uniformIndices.size() || m_uniformIndices[handle.idx] == kInvalidUniformIndex)
+            {
+                return nullptr;
+            }
+
+            return &Uniforms[m_uniformIndices[handle.idx]];
         }
+
+        UniformValue* FindUniform(bgfx::UniformHandle handle)
+        {
+            return const_cast<UniformValue*>(std::as_const(*this).FindUniform(handle));
+        }
+
+        // Maps a bgfx uniform handle index to the index of its value in Uniforms.
+        std::vector<uint16_t> m_uniformIndices{};
+    };
+
+    // Dispatches functions to the JavaScript thread from other threads until the engine is destroyed. bgfx can call back
+    // after that, when the runtime may already be gone.
+    class RuntimeDispatcher final
+    {
+    public:
+        explicit RuntimeDispatcher(JsRuntime& runtime)
+            : m_runtime{&runtime}
+        {
+        }
+
+        // Returns false, without calling the function, once the engine is destroyed.
+        bool Dispatch(std::function<void(Napi::Env)> function)
+        {
+            std::scoped_lock lock{m_mutex};
+            if (m_runtime == nullptr)
+            {
+                return false;
+            }
+
+            m_runtime->Dispatch(std::move(function));
+            return true;
+        }
+
+        void Disconnect()
+        {
+            std::scoped_lock lock{m_mutex};
+            m_runtime = nullptr;
+        }
+
+    private:
+        std::mutex m_mutex{};
+        JsRuntime* m_runtime{};
     };
 
     class IndexBufferData;
@@ -372,29 +924,87 @@ namespace Babylon
 
     struct VertexArray final
     {
+        explicit VertexArray(std::shared_ptr<VertexLayoutCache> layoutCache)
+            : vertexLayoutCache{std::move(layoutCache)}
+        {
+        }
+
         ~VertexArray()
         {
             for (auto& vertexBuffer : vertexBuffers)
             {
-                bgfx::destroy(vertexBuffer.vertexLayoutHandle);
+                vertexLayoutCache->Release(vertexBuffer.vertexLayoutHandle);
             }
         }
 
         struct IndexBuffer
         {
             const IndexBufferData* data{};
+
+            // Keeps a transient buffer alive while the vertex array refers to it.
+            std::shared_ptr<const IndexBufferData> transientData{};
         };
 
         IndexBuffer indexBuffer{};
 
+        struct VertexAttribute
+        {
+            bgfx::Attrib::Enum attrib{};
+            uint8_t numElements{};
+            bgfx::AttribType::Enum type{};
+            bool normalized{};
+            uint32_t offset{};
+        };
+
+        // One bgfx stream. The attributes interleaved in the same buffer with the same stride share a stream.
         struct VertexBuffer
         {
             const VertexBufferData* data{};
             uint32_t startVertex{};
+            uint32_t byteStride{};
+            std::vector<VertexAttribute> attributes{};
             bgfx::VertexLayoutHandle vertexLayoutHandle{};
+
+            // Keeps a transient buffer alive while the vertex array refers to it.
+            std::shared_ptr<const VertexBufferData> transientData{};
         };
 
         std::vector<VertexBuffer> vertexBuffers{};
+
+        // Attributes with a divisor of 1, read by DrawInstanced from the bgfx instance data registers.
+        struct InstanceAttribute
+        {
+            const VertexBufferData* data{};
+            uint32_t location{};
+            uint32_t startInstance{};
+            uint32_t byteStride{};
+            uint32_t offset{};
+            uint32_t byteSize{};
+
+            // Instance data register the attribute is read from, i_data0 being 0.
+            uint32_t instanceRegister{};
+
+            // Keeps a transient buffer alive while the vertex array refers to it.
+            std::shared_ptr<const VertexBufferData> transientData{};
+        };
+
+        std::vector<InstanceAttribute> instanceAttributes{};
+
+        // Whether the instance attributes can be read straight from their buffer: they share it, and each one
+        // starts a 16-byte register of its records. Otherwise they are gathered in transient instance data.
+        bool directInstanceData{};
+
+        std::shared_ptr<VertexLayoutCache> vertexLayoutCache{};
+    };
+
+    // Command buffers captured between beginBundle and endBundle, replayed by executeBundle.
+    // The native objects referenced by the commands must outlive the bundle.
+    struct RenderBundle final
+    {
+        std::vector<uint32_t> Commands{};
+
+        // Uniforms whose value is supplied by each executeBundle call rather than by the recorded commands.
+        std::vector<bgfx::UniformHandle> PatchableUniforms{};
     };
 
     class NativeEngine final : public Napi::ObjectWrap<NativeEngine>
@@ -411,6 +1021,10 @@ namespace Babylon
         static void Initialize(Napi::Env, bool autoRender);
 
         FrameBufferManager& GetFrameBufferManager();
+        void OnFrameBufferDestroyed(FrameBufferData& frameBuffer);
+
+        // Submits the draws held back for auto-instancing. Must be called before changing the bound frame buffer.
+        void FlushPendingDrawsForViewChange();
         void Dispatch(std::function<void()>);
 
         void ScheduleRender();
@@ -431,10 +1045,27 @@ namespace Babylon
         void DeleteIndexBuffer(const Napi::CallbackInfo& info);
         void RecordIndexBuffer(const Napi::CallbackInfo& info);
         void UpdateDynamicIndexBuffer(const Napi::CallbackInfo& info);
+        void SetIndexNarrowing(const Napi::CallbackInfo& info);
+        void SetTextureCompression(const Napi::CallbackInfo& info);
+        void SetMipFilter(const Napi::CallbackInfo& info);
+        void SetImageNarrowing(const Napi::CallbackInfo& info);
+        void SetVertexBufferBorrowing(const Napi::CallbackInfo& info);
+        void SetTextureCache(const Napi::CallbackInfo& info);
+        void SetTextureStreaming(const Napi::CallbackInfo& info);
+        void SetTextureMemoryBudget(const Napi::CallbackInfo& info);
+        Napi::Value GetTextureMemoryUsage(const Napi::CallbackInfo& info);
+        void SetRenderTargetPooling(const Napi::CallbackInfo& info);
+        Napi::Value GetRenderTargetPoolStatistics(const Napi::CallbackInfo& info);
+        void OptimizeIndices(const Napi::CallbackInfo& info);
+        void SetAttributeQuantization(const Napi::CallbackInfo& info);
         Napi::Value CreateVertexBuffer(const Napi::CallbackInfo& info);
         void DeleteVertexBuffer(const Napi::CallbackInfo& info);
+        Napi::Value AllocTransientVertexBuffer(const Napi::CallbackInfo& info);
+        Napi::Value AllocTransientIndexBuffer(const Napi::CallbackInfo& info);
         void RecordVertexBuffer(const Napi::CallbackInfo& info);
         void UpdateDynamicVertexBuffer(const Napi::CallbackInfo& info);
+        Napi::Value CreateInstanceBuffer(const Napi::CallbackInfo& info);
+        void UpdateInstanceBuffer(const Napi::CallbackInfo& info);
         Napi::Value CreateProgram(const Napi::CallbackInfo& info);
         Napi::Value GetUniforms(const Napi::CallbackInfo& info);
         Napi::Value GetAttributes(const Napi::CallbackInfo& info);
@@ -482,6 +1113,7 @@ namespace Babylon
         void UnbindFrameBuffer(const Napi::CallbackInfo& info);
         void DrawIndexed(const Napi::CallbackInfo& info);
         void Draw(const Napi::CallbackInfo& info);
+        void DrawInstanced(const Napi::CallbackInfo& info);
         void Clear(const Napi::CallbackInfo& info);
         void ClearColor(const Napi::CallbackInfo& info);
         void ClearStencil(const Napi::CallbackInfo& info);
@@ -490,7 +1122,50 @@ namespace Babylon
         Napi::Value GetRenderHeight(const Napi::CallbackInfo& info);
         void SetViewPort(const Napi::CallbackInfo& info);
         void GetFramebufferData(const Napi::CallbackInfo& info);
+        void ReadPixelsAsync(const Napi::CallbackInfo& info);
+        void ReadTexturePixelsAsync(const Napi::CallbackInfo& info);
+        void ReleasePixels(const Napi::CallbackInfo& info);
         Napi::Value GetRenderAPI(const Napi::CallbackInfo& info);
+        void SubmitCommands(const Napi::CallbackInfo& info);
+        Napi::Value GetCommandHandle(const Napi::CallbackInfo& info);
+        Napi::Value GetSubmitStatistics(const Napi::CallbackInfo& info);
+        void SetAutoInstancing(const Napi::CallbackInfo& info);
+        void BeginBundle(const Napi::CallbackInfo& info);
+        Napi::Value EndBundle(const Napi::CallbackInfo& info);
+        void ExecuteBundle(const Napi::CallbackInfo& info);
+
+        // Implementations shared by the per-call methods above and SubmitCommands.
+        void BindVertexArrayInternal(const VertexArray& vertexArray);
+        void SetStateInternal(bool culling, bool reverseSide);
+        void SetDepthTestInternal(uint32_t depthTest);
+        void SetDepthWriteInternal(bool enable);
+        void SetColorWriteInternal(bool enable);
+        void SetBlendModeInternal(uint64_t blendMode);
+        void SetTextureInternal(const UniformInfo& uniformInfo, const TextureData& texture);
+        void DrawIndexedInternal(int32_t fillMode, int32_t elementStart, int32_t elementCount);
+        void DrawInternal(int32_t fillMode, int32_t elementStart, int32_t elementCount);
+        void DrawInstancedInternal(int32_t fillMode, int32_t elementStart, int32_t elementCount, uint32_t instanceCount);
+        void SetUniformValue(bgfx::UniformHandle handle, gsl::span<const float> data, size_t elementLength = 1);
+        void UpdateUniformValue(bgfx::UniformHandle handle, gsl::span<const float> data, size_t elementLength);
+        void SetProgramInternal(ProgramData* program);
+        void ExecuteCommands(gsl::span<const uint32_t> commands);
+        void SetViewPortInternal(float x, float y, float width, float height);
+        void ReadPixelsInternal(const Napi::CallbackInfo& info, bgfx::TextureHandle texture, bgfx::TextureFormat::Enum format, uint16_t width, uint16_t height);
+        void ReadBackBufferPixels(Napi::Function callback, uint32_t x, uint32_t y, uint32_t readWidth, uint32_t readHeight);
+        Napi::ArrayBuffer AcquirePixelBuffer(Napi::Env env, uint32_t size);
+
+        std::unique_ptr<ProgramData> CreateProgramData(std::string_view vertexSource, std::string_view fragmentSource, const std::vector<std::string>& instanceAttributes = {}, const std::string& perInstanceUniform = {});
+        void DetachTransientArrayBuffers();
+        TextureResidency::Reloader CreateTextureReloader(TextureData* texture, uint64_t cacheKey);
+        void RecordInstanceAttribute(Napi::Env env, VertexArray& vertexArray, VertexBufferData* vertexBufferData, uint32_t location, uint32_t byteOffset, uint32_t byteStride, uint32_t numElements, uint32_t type, uint32_t divisor);
+        ProgramData& GetInstanceVariant(ProgramData& program, const VertexArray& vertexArray);
+        void SubmitDraw(ProgramData& program, const IndexBufferData* indexBuffer, int32_t fillMode, int32_t elementStart, int32_t elementCount, uint64_t engineState);
+
+        // Auto-instancing of consecutive draws that only differ by their world matrix.
+        bool CanBatchDraw() const;
+        void BatchDraw(int32_t fillMode, int32_t elementStart, int32_t elementCount);
+        void FlushPendingDraws();
+        bool EnsureInstancedProgram(ProgramData& program);
 
         template<typename SchedulerT>
         arcana::task<void, std::exception_ptr> GetRequestAnimationFrameTask(SchedulerT&);
@@ -502,24 +1177,49 @@ namespace Babylon
         ShaderCompiler m_shaderCompiler;
 
         ProgramData* m_currentProgram{nullptr};
+
+        // Parameters of the last draw call, used to decide which uniforms of the next draw call need to be uploaded.
+        struct SubmittedDrawInfo
+        {
+            const ProgramData* Program{nullptr};
+            bgfx::ViewId ViewId{};
+            bool YFlip{false};
+        } m_lastSubmitted{};
+
+        UniformShadowState m_uniformShadowState{};
+        BindingShadowState m_bindingShadowState{};
+
+        // Render state with reversed culling used when rendering to a texture, and the state it was computed from.
+        struct
+        {
+            uint64_t Source{};
+            uint64_t Flipped{};
+        } m_flippedState{};
+
         arcana::weak_table<std::unique_ptr<ProgramData>> m_programDataCollection{};
 
+        // Shared with the finalizers of the programs, which may run after the engine is gone.
+        std::shared_ptr<CommandHandleTable> m_commandHandles{std::make_shared<CommandHandleTable>()};
+
         JsRuntime& m_runtime;
         Graphics::Impl& m_graphicsImpl;
 
+        // Shared with the borrowed vertex arrays, which bgfx may release after the engine is gone.
+        std::shared_ptr<RuntimeDispatcher> m_runtimeDispatcher{std::make_shared<RuntimeDispatcher>(m_runtime)};
+
         bx::DefaultAllocator m_allocator;
         uint64_t m_engineState;
 
-        FrameBufferManager m_frameBufferManager{};
+        FrameBufferManager m_frameBufferManager{*m_commandHandles};
 
-        template<int size, typename arrayType>
-        void SetTypeArrayN(const Napi::CallbackInfo& info);
+        template<int size, typename elementType>
+        void SetTypeArrayN(const UniformInfo& uniformInfo, gsl::span<const elementType> array);
 
         template<int size>
-        void SetFloatN(const Napi::CallbackInfo& info);
+        void SetFloatN(const UniformInfo& uniformInfo, const float* values);
 
         template<int size>
-        void SetMatrixN(const Napi::CallbackInfo& info);
+        void SetMatrixN(const UniformInfo& uniformInfo, gsl::span<const float> matrix);
 
         // Scratch vector used for data alignment.
         std::vector<float> m_scratch{};
@@ -531,5 +1231,87 @@ namespace Babylon
         // at the time of webgl binding, we don't know those values yet
         // so a pointer to the to-bind buffer is kept and the buffer is bound to bgfx at the time of the drawcall
         const IndexBufferData* m_currentBoundIndexBuffer{};
+
+        const VertexArray* m_currentVertexArray{};
+
+        // Draws held back by auto-instancing. They share everything but the world matrix.
+        struct PendingDraws
+        {
+            ProgramData* Program{};
+            const VertexArray* BoundVertexArray{};
+            const IndexBufferData* IndexBuffer{};
+            int32_t FillMode{};
+            int32_t ElementStart{};
+            int32_t ElementCount{};
+            uint64_t EngineState{};
+            bgfx::ViewId ViewId{};
+            std::vector<float> WorldMatrices{};
+        } m_pendingDraws{};
+
+        // Incremented at the end of each frame, identifies the frame transient buffers were allocated in.
+        uint32_t m_frameIndex{};
+
+        // Memory of the dynamic buffer updates, recycled every frame.
+        StagingBufferRing m_stagingBuffers{};
+
+        // Array buffers over the transient memory allocated this frame, detached at the end of the frame.
+        std::vector<Napi::Reference<Napi::ArrayBuffer>> m_transientArrayBuffers{};
+
+        // Shared with the vertex arrays, which may outlive the engine.
+        std::shared_ptr<VertexLayoutCache> m_vertexLayoutCache{std::make_shared<VertexLayoutCache>()};
+
+        bool m_autoInstancingEnabled{false};
+        bool m_indexNarrowingEnabled{false};
+
+        // Compression applied to the images decoded by loadTexture.
+        TextureCompressionPreset m_textureCompression{TextureCompressionPreset::None};
+
+        // Filter of the mips generated by loadTexture and loadCubeTexture.
+        MipFilter m_mipFilter{MipFilter::Box};
+
+        // Whether loadTexture converts 16-bit per channel images to 8 bits per channel.
+        bool m_imageNarrowingEnabled{false};
+
+        // Whether static vertex buffers borrow the array they are created from instead of copying it. Disabled by default.
+        bool m_vertexBufferBorrowingEnabled{false};
+
+        // Processed textures kept on disk across runs, shared with the loading tasks. Null when disabled.
+        std::shared_ptr<TextureCache> m_textureCache{};
+
+        // Textures loaded by loadTexture whose larger mips are uploaded across frames. Disabled with a budget of 0.
+        TextureStreamer m_textureStreamer{};
+        uint32_t m_textureStreamingBudget{};
+        uint32_t m_textureStreamingInitialSize{};
+
+        // Memory of the loaded textures, kept within a budget by dropping the largest mips of the unused ones.
+        TextureResidency m_textureResidency{};
+
+        // Frame buffers of the deleted render targets, recycled by createFramebuffer. Disabled by default.
+        RenderTargetPool m_renderTargetPool{};
+
+        // Reads of readPixelsAsync, and the output buffers handed back by releasePixels for the next reads.
+        TextureReadback m_textureReadback{};
+        std::vector<Napi::Reference<Napi::ArrayBuffer>> m_pixelBuffers{};
+
+        // Expires with the engine. The screenshot callbacks are kept by Graphics, which can outlive the engine.
+        std::shared_ptr<void> m_lifetime{std::make_shared<bool>()};
+
+        // Format float attributes are converted to when static vertex buffers are created, indexed by attribute location.
+        std::array<VertexQuantization, bgfx::Attrib::Count> m_attributeQuantization{};
+        uint64_t m_mergedDrawCount{};
+        uint64_t m_instancedDrawCount{};
+
+        // Bundle receiving the submitted command buffers between beginBundle and endBundle.
+        std::unique_ptr<RenderBundle> m_recordingBundle{};
+
+        // Bundle being replayed by executeBundle, and the values of its patchable uniforms.
+        struct ExecutingBundle
+        {
+            const RenderBundle* Bundle{};
+            std::vector<gsl::span<const float>> Values{};
+        } m_executingBundle{};
+
+        void ThrowIfRecordingBundle() const;
+        void ApplyBundlePatches();
     };
 }
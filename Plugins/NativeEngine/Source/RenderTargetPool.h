@@ -0,0 +1,147 @@
+#pragma once
+
+#include <bgfx/bgfx.h>
+
+#include <algorithm>
+#include <array>
+#include <cassert>
+#include <cstdint>
+#include <iterator>
+#include <vector>
+
+namespace Babylon
+{
+    /// The attachments of a render target, which pooled frame buffers are matched against.
+    struct RenderTargetDescription
+    {
+        uint16_t Width{};
+        uint16_t Height{};
+        bgfx::TextureFormat::Enum Format{bgfx::TextureFormat::Unknown};
+
+        // Count when the render target has no depth attachment.
+        bgfx::TextureFormat::Enum DepthStencilFormat{bgfx::TextureFormat::Count};
+        bool HasMips{};
+
+        bool operator==(const RenderTargetDescription& other) const
+        {
+            return Width == other.Width && Height == other.Height && Format == other.Format && DepthStencilFormat == other.DepthStencilFormat && HasMips == other.HasMips;
+        }
+    };
+
+    /// Recycles the frame buffers of deleted render targets, with their attachments, for the render targets created
+    /// afterward with the same description. Frame buffers left idle for more than a number of frames are destroyed.
+    class RenderTargetPool final
+    {
+    public:
+        struct Statistics
+        {
+            uint64_t Hits{};
+            uint64_t Misses{};
+            uint64_t Trimmed{};
+        };
+
+        RenderTargetPool() = default;
+        RenderTargetPool(const RenderTargetPool&) = delete;
+        RenderTargetPool& operator=(const RenderTargetPool&) = delete;
+
+        /// Sets the number of frames a frame buffer is kept idle for, 0 to disable pooling and destroy the idle ones.
+        void SetMaxIdleFrames(uint32_t maxIdleFrames)
+        {
+            m_maxIdleFrames = maxIdleFrames;
+            if (m_maxIdleFrames == 0)
+            {
+                Clear();
+            }
+        }
+
+        /// Returns an idle frame buffer matching the description, or a new one. The frame buffer owns its attachments.
+        bgfx::FrameBufferHandle Acquire(const RenderTargetDescription& description)
+        {
+            // The most recently released first, so that the frame buffers in excess stay idle and get trimmed.
+            const auto it = std::find_if(m_idle.rbegin(), m_idle.rend(), [&description](const Entry& entry) { return entry.Description == description; });
+            if (it != m_idle.rend())
+            {
+                const bgfx::FrameBufferHandle handle = it->Handle;
+                m_idle.erase(std::next(it).base());
+                m_statistics.Hits++;
+                return handle;
+            }
+
+            m_statistics.Misses++;
+            return Create(description);
+        }
+
+        /// Keeps the frame buffer for a render target created later on, or destroys it when pooling is disabled.
+        void Release(const RenderTargetDescription& description, bgfx::FrameBufferHandle handle, uint32_t frameIndex)
+        {
+            if (m_maxIdleFrames == 0)
+            {
+                bgfx::destroy(handle);
+                return;
+            }
+
+            m_idle.push_back({description, handle, frameIndex});
+        }
+
+        /// Destroys the frame buffers idle for more than the maximum number of frames. Called once per frame.
+        void Trim(uint32_t frameIndex)
+        {
+            const auto expired = std::stable_partition(m_idle.begin(), m_idle.end(), [this, frameIndex](const Entry& entry) {
+                return frameIndex - entry.ReleasedFrame <= m_maxIdleFrames;
+            });
+            for (auto it = expired; it != m_idle.end(); ++it)
+            {
+                bgfx::destroy(it->Handle);
+            }
+            m_statistics.Trimmed += static_cast<uint64_t>(std::distance(expired, m_idle.end()));
+            m_idle.erase(expired, m_idle.end());
+        }
+
+        void Clear()
+        {
+            for (const auto& entry : m_idle)
+            {
+                bgfx::destroy(entry.Handle);
+            }
+            m_idle.clear();
+        }
+
+        const Statistics& GetStatistics() const
+        {
+            return m_statistics;
+        }
+
+    private:
+        struct Entry
+        {
+            RenderTargetDescription Description{};
+            bgfx::FrameBufferHandle Handle{bgfx::kInvalidHandle};
+            uint32_t ReleasedFrame{};
+        };
+
+        static bgfx::FrameBufferHandle Create(const RenderTargetDescription& description)
+        {
+            if (description.DepthStencilFormat == bgfx::TextureFormat::Count)
+            {
+                return bgfx::createFrameBuffer(description.Width, description.Height, description.Format, BGFX_TEXTURE_RT);
+            }
+
+            assert(bgfx::isTextureValid(0, false, 1, description.Format, BGFX_TEXTURE_RT));
+            assert(bgfx::isTextureValid(0, false, 1, description.DepthStencilFormat, BGFX_TEXTURE_RT));
+
+            std::array<bgfx::TextureHandle, 2> textures{
+                bgfx::createTexture2D(description.Width, description.Height, description.HasMips, 1, description.Format, BGFX_TEXTURE_RT),
+                bgfx::createTexture2D(description.Width, description.Height, description.HasMips, 1, description.DepthStencilFormat, BGFX_TEXTURE_RT)};
+            std::array<bgfx::Attachment, textures.size()> attachments{};
+            for (size_t idx = 0; idx < attachments.size(); ++idx)
+            {
+                attachments[idx].init(textures[idx]);
+            }
+            return bgfx::createFrameBuffer(static_cast<uint8_t>(attachments.size()), attachments.data(), true);
+        }
+
+        uint32_t m_maxIdleFrames{};
+        std::vector<Entry> m_idle{};
+        Statistics m_statistics{};
+    };
+}
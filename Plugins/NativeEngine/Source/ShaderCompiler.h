@@ -1,7 +1,9 @@
 #pragma once
 
+#include <string>
 #include <string_view>
 #include <functional>
+#include <vector>
 #include <spirv_cross.hpp>
 #include <spirv_parser.hpp>
 
@@ -28,8 +30,15 @@ namespace Babylon
 
             std::vector<uint8_t> FragmentBytes{};
             std::unordered_map<std::string, uint8_t> FragmentUniformStages{};
+
+            // Number of vec4 registers used by each non-sampler uniform, including arrays.
+            std::unordered_map<std::string, uint16_t> UniformRegisterCounts{};
         };
 
-        BgfxShaderInfo Compile(std::string_view vertexSource, std::string_view fragmentSource);
+        /// Compiles the program. The attributes listed in instanceAttributes are read from the bgfx instance data
+        /// registers, the first one from i_data0; empty names leave a register unused. Without them, the world0 to
+        /// world3 attributes are read from i_data0 to i_data3. When perInstanceUniform names a mat4 uniform of the
+        /// vertex shader, the uniform is replaced by a matrix whose columns are the attributes <name>0 to <name>3.
+        BgfxShaderInfo Compile(std::string_view vertexSource, std::string_view fragmentSource, const std::vector<std::string>& instanceAttributes = {}, const std::string& perInstanceUniform = {});
     };
 }
@@ -2,6 +2,7 @@
 #include "ShaderCompiler.h"
 #include <bx/bx.h>
 #include <bgfx/bgfx.h>
+#include <algorithm>
 
 #define BGFX_UNIFORM_FRAGMENTBIT UINT8_C(0x10) // Copy-pasta from bgfx_p.h
 #define BGFX_UNIFORM_SAMPLERBIT UINT8_C(0x20)  // Copy-pasta from bgfx_p.h
@@ -153,7 +154,16 @@ namespace Babylon::ShaderCompilerCommon
         return info;
     }
 
-    ShaderCompiler::BgfxShaderInfo CreateBgfxShader(ShaderInfo vertexShaderInfo, ShaderInfo fragmentShaderInfo)
+    void CollectRegisterCounts(const NonSamplerUniformsInfo& uniformsInfo, std::unordered_map<std::string, uint16_t>& registerCounts)
+    {
+        for (const auto& uniform : uniformsInfo.Uniforms)
+        {
+            auto& registerCount = registerCounts[uniform.Name];
+            registerCount = std::max(registerCount, uniform.RegisterSize);
+        }
+    }
+
+    ShaderCompiler::BgfxShaderInfo CreateBgfxShader(ShaderInfo vertexShaderInfo, ShaderInfo fragmentShaderInfo, const std::vector<std::string>& instanceAttributes)
     {
         ShaderCompiler::BgfxShaderInfo bgfxShaderInfo{};
 
@@ -187,18 +197,38 @@ namespace Babylon::ShaderCompilerCommon
             AppendBytes(vertexBytes, static_cast<uint16_t>(numUniforms));
             AppendUniformBuffer(vertexBytes, uniformsInfo, false);
             AppendSamplers(vertexBytes, compiler, samplers, bgfxShaderInfo.VertexUniformStages);
+            CollectRegisterCounts(uniformsInfo, bgfxShaderInfo.UniformRegisterCounts);
 
             AppendBytes(vertexBytes, static_cast<uint32_t>(vertexShaderInfo.Bytes.size()));
             AppendBytes(vertexBytes, vertexShaderInfo.Bytes);
             AppendBytes(vertexBytes, static_cast<uint8_t>(0));
 
-            AppendBytes(vertexBytes, static_cast<uint8_t>(resources.stage_inputs.size()));
+            // Instance data inputs (i_data*) are fed from the instance data buffer and are not
+            // vertex attributes as far as bgfx is concerned. They are reported under the name of
+            // the per-instance attribute they hold.
+            std::vector<const spirv_cross::Resource*> vertexAttributes{};
             for (const spirv_cross::Resource& stageInput : resources.stage_inputs)
             {
                 const uint32_t location = compiler.get_decoration(stageInput.id, spv::DecorationLocation);
+                if (stageInput.name.compare(0, 6, "i_data") == 0)
+                {
+                    const auto index = static_cast<size_t>(std::stoul(stageInput.name.substr(6)));
+                    const bool listed = index < instanceAttributes.size() && !instanceAttributes[index].empty();
+                    bgfxShaderInfo.VertexAttributeLocations[listed ? instanceAttributes[index] : "world" + stageInput.name.substr(6)] = location;
+                }
+                else
+                {
+                    vertexAttributes.push_back(&stageInput);
+                }
+            }
+
+            AppendBytes(vertexBytes, static_cast<uint8_t>(vertexAttributes.size()));
+            for (const spirv_cross::Resource* stageInput : vertexAttributes)
+            {
+                const uint32_t location = compiler.get_decoration(stageInput->id, spv::DecorationLocation);
                 AppendBytes(vertexBytes, bgfx::attribToId(static_cast<bgfx::Attrib::Enum>(location)));
 
-                std::string attributeName = stageInput.name;
+                std::string attributeName = stageInput->name;
                 if (attributeName == "a_position")
                     attributeName = "position";
                 else if (attributeName == "a_normal")
@@ -249,6 +279,7 @@ namespace Babylon::ShaderCompilerCommon
             AppendBytes(fragmentBytes, static_cast<uint16_t>(numUniforms));
             AppendUniformBuffer(fragmentBytes, uniformsInfo, true);
             AppendSamplers(fragmentBytes, compiler, samplers, bgfxShaderInfo.FragmentUniformStages);
+            CollectRegisterCounts(uniformsInfo, bgfxShaderInfo.UniformRegisterCounts);
 
             AppendBytes(fragmentBytes, static_cast<uint32_t>(fragmentShaderInfo.Bytes.size()));
             AppendBytes(fragmentBytes, fragmentShaderInfo.Bytes);
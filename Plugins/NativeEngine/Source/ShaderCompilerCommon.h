@@ -55,6 +55,7 @@ namespace Babylon::ShaderCompilerCommon
     void AppendUniformBuffer(std::vector<uint8_t>& bytes, const NonSamplerUniformsInfo& uniformBuffer, bool isFragment);
     void AppendSamplers(std::vector<uint8_t>& bytes, const spirv_cross::Compiler& compiler, const spirv_cross::SmallVector<spirv_cross::Resource>& samplers, std::unordered_map<std::string, uint8_t>& stages);
     NonSamplerUniformsInfo CollectNonSamplerUniforms(spirv_cross::Parser& parser, const spirv_cross::Compiler& compiler);
+    void CollectRegisterCounts(const NonSamplerUniformsInfo& uniformsInfo, std::unordered_map<std::string, uint16_t>& registerCounts);
 
     struct ShaderInfo
     {
@@ -63,5 +64,5 @@ namespace Babylon::ShaderCompilerCommon
         gsl::span<uint8_t> Bytes;
     };
 
-    ShaderCompiler::BgfxShaderInfo CreateBgfxShader(ShaderInfo vertexShaderInfo, ShaderInfo fragmentShaderInfo);
+    ShaderCompiler::BgfxShaderInfo CreateBgfxShader(ShaderInfo vertexShaderInfo, ShaderInfo fragmentShaderInfo, const std::vector<std::string>& instanceAttributes);
 }
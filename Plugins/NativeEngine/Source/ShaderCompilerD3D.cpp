@@ -75,7 +75,7 @@ namespace Babylon
         glslang::FinalizeProcess();
     }
 
-    ShaderCompiler::BgfxShaderInfo ShaderCompiler::Compile(std::string_view vertexSource, std::string_view fragmentSource)
+    ShaderCompiler::BgfxShaderInfo ShaderCompiler::Compile(std::string_view vertexSource, std::string_view fragmentSource, const std::vector<std::string>& instanceAttributes, const std::string& perInstanceUniform)
     {
         glslang::TProgram program;
 
@@ -96,8 +96,12 @@ namespace Babylon
         }
 
         ShaderCompilerTraversers::IdGenerator ids{};
+        if (!perInstanceUniform.empty())
+        {
+            ShaderCompilerTraversers::ReplaceUniformWithAttributes(program, ids, perInstanceUniform);
+        }
         auto utstScope = ShaderCompilerTraversers::MoveNonSamplerUniformsIntoStruct(program, ids);
-        ShaderCompilerTraversers::AssignLocationsAndNamesToVertexVaryings(program, ids);
+        ShaderCompilerTraversers::AssignLocationsAndNamesToVertexVaryings(program, ids, instanceAttributes);
         ShaderCompilerTraversers::SplitSamplersIntoSamplersAndTextures(program, ids);
         ShaderCompilerTraversers::InvertYDerivativeOperands(program);
 
@@ -134,6 +138,6 @@ namespace Babylon
             std::move(fragmentCompiler),
             gsl::make_span(static_cast<uint8_t*>(fragmentBlob->GetBufferPointer()), fragmentBlob->GetBufferSize())};
 
-        return ShaderCompilerCommon::CreateBgfxShader(std::move(vertexShaderInfo), std::move(fragmentShaderInfo));
+        return ShaderCompilerCommon::CreateBgfxShader(std::move(vertexShaderInfo), std::move(fragmentShaderInfo), instanceAttributes);
     }
 }
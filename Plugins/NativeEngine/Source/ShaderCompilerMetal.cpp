@@ -89,7 +89,7 @@ namespace Babylon
         glslang::FinalizeProcess();
     }
 
-    ShaderCompiler::BgfxShaderInfo ShaderCompiler::Compile(std::string_view vertexSource, std::string_view fragmentSource)
+    ShaderCompiler::BgfxShaderInfo ShaderCompiler::Compile(std::string_view vertexSource, std::string_view fragmentSource, const std::vector<std::string>& instanceAttributes, const std::string& perInstanceUniform)
     {
         glslang::TProgram program;
 
@@ -110,9 +110,13 @@ namespace Babylon
         }
 
         ShaderCompilerTraversers::IdGenerator ids{};
+        if (!perInstanceUniform.empty())
+        {
+            ShaderCompilerTraversers::ReplaceUniformWithAttributes(program, ids, perInstanceUniform);
+        }
         auto cutScope = ShaderCompilerTraversers::ChangeUniformTypes(program, ids);
         auto utstScope = ShaderCompilerTraversers::MoveNonSamplerUniformsIntoStruct(program, ids);
-        ShaderCompilerTraversers::AssignLocationsAndNamesToVertexVaryings(program, ids);
+        ShaderCompilerTraversers::AssignLocationsAndNamesToVertexVaryings(program, ids, instanceAttributes);
         ShaderCompilerTraversers::SplitSamplersIntoSamplersAndTextures(program, ids);
         ShaderCompilerTraversers::InvertYDerivativeOperands(program);
 
@@ -124,6 +128,7 @@ namespace Babylon
 
         return ShaderCompilerCommon::CreateBgfxShader(
             {std::move(vertexParser), std::move(vertexCompiler), gsl::make_span(reinterpret_cast<uint8_t*>(vertexGLSL.data()), vertexGLSL.size())},
-            {std::move(fragmentParser), std::move(fragmentCompiler), gsl::make_span(reinterpret_cast<uint8_t*>(fragmentGLSL.data()), fragmentGLSL.size())});
+            {std::move(fragmentParser), std::move(fragmentCompiler), gsl::make_span(reinterpret_cast<uint8_t*>(fragmentGLSL.data()), fragmentGLSL.size())},
+            instanceAttributes);
     }
 }
@@ -60,7 +60,7 @@ namespace Babylon
         glslang::FinalizeProcess();
     }
 
-    ShaderCompiler::BgfxShaderInfo ShaderCompiler::Compile(std::string_view vertexSource, std::string_view fragmentSource)
+    ShaderCompiler::BgfxShaderInfo ShaderCompiler::Compile(std::string_view vertexSource, std::string_view fragmentSource, const std::vector<std::string>& instanceAttributes, const std::string& perInstanceUniform)
     {
         glslang::TProgram program;
 
@@ -81,8 +81,12 @@ namespace Babylon
         }
 
         ShaderCompilerTraversers::IdGenerator ids{};
+        if (!perInstanceUniform.empty())
+        {
+            ShaderCompilerTraversers::ReplaceUniformWithAttributes(program, ids, perInstanceUniform);
+        }
         auto cutScope = ShaderCompilerTraversers::ChangeUniformTypes(program, ids);
-        ShaderCompilerTraversers::AssignLocationsAndNamesToVertexVaryings(program, ids);
+        ShaderCompilerTraversers::AssignLocationsAndNamesToVertexVaryings(program, ids, instanceAttributes);
 
         std::string vertexGLSL(vertexSource.data(), vertexSource.size());
         auto [vertexParser, vertexCompiler] = CompileShader(program, EShLangVertex, vertexGLSL);
@@ -92,6 +96,7 @@ namespace Babylon
 
         return ShaderCompilerCommon::CreateBgfxShader(
             {std::move(vertexParser), std::move(vertexCompiler), gsl::make_span(reinterpret_cast<uint8_t*>(vertexGLSL.data()), vertexGLSL.size())},
-            {std::move(fragmentParser), std::move(fragmentCompiler), gsl::make_span(reinterpret_cast<uint8_t*>(fragmentGLSL.data()), fragmentGLSL.size())});
+            {std::move(fragmentParser), std::move(fragmentCompiler), gsl::make_span(reinterpret_cast<uint8_t*>(fragmentGLSL.data()), fragmentGLSL.size())},
+            instanceAttributes);
     }
 }
@@ -10,6 +10,9 @@
 
 #include <gsl/gsl>
 
+#include <algorithm>
+#include <array>
+#include <set>
 #include <stdexcept>
 
 using namespace glslang;
@@ -419,12 +422,17 @@ namespace Babylon::ShaderCompilerTraversers
         class VertexVaryingInTraverser final : private TIntermTraverser
         {
         public:
-            static void Traverse(TProgram& program, IdGenerator& ids)
+            static void Traverse(TProgram& program, IdGenerator& ids, const std::vector<std::string>& instanceAttributes)
             {
-                Traverse(program.getIntermediate(EShLangVertex), ids);
+                Traverse(program.getIntermediate(EShLangVertex), ids, instanceAttributes);
             }
 
         private:
+            explicit VertexVaryingInTraverser(const std::vector<std::string>& instanceAttributes)
+                : m_instanceAttributes{instanceAttributes}
+            {
+            }
+
             virtual void visitSymbol(TIntermSymbol* symbol) override
             {
                 // Collect all vertex attributes, described by glslang as "varyings."
@@ -448,6 +456,28 @@ namespace Babylon::ShaderCompilerTraversers
 
             std::pair<unsigned int, const char*> GetVaryingLocationAndNewNameForName(const char* name)
             {
+                const auto location = GetDefaultVaryingLocationAndNewNameForName(name);
+
+                // Per-instance attributes are read from the bgfx instance data registers, i_data0 being TEXCOORD7,
+                // i_data1 TEXCOORD6 and so on. The default location is still computed first, so that the generic
+                // attributes keep the locations they have without per-instance attributes.
+                static constexpr std::array<const char*, 5> instanceDataNames{"i_data0", "i_data1", "i_data2", "i_data3", "i_data4"};
+                const auto it = std::find(m_instanceAttributes.begin(), m_instanceAttributes.end(), name);
+                if (it != m_instanceAttributes.end())
+                {
+                    const auto index = static_cast<unsigned int>(it - m_instanceAttributes.begin());
+                    if (index >= instanceDataNames.size())
+                    {
+                        throw std::runtime_error{"Too many per-instance attributes."};
+                    }
+                    return {static_cast<unsigned int>(bgfx::Attrib::TexCoord7) - index, instanceDataNames[index]};
+                }
+
+                return location;
+            }
+
+            std::pair<unsigned int, const char*> GetDefaultVaryingLocationAndNewNameForName(const char* name)
+            {
 #define IF_NAME_RETURN_ATTRIB(varyingName, attrib, newName)  \
     if (std::strcmp(name, varyingName) == 0)                 \
     {                                                        \
@@ -463,13 +493,18 @@ namespace Babylon::ShaderCompilerTraversers
                 IF_NAME_RETURN_ATTRIB("color", bgfx::Attrib::Color0, "a_color0")
                 IF_NAME_RETURN_ATTRIB("matricesIndices", bgfx::Attrib::Indices, "a_indices")
                 IF_NAME_RETURN_ATTRIB("matricesWeights", bgfx::Attrib::Weight, "a_weight")
+                // Per-instance world matrix rows use the bgfx instance data registers (i_data0 is TEXCOORD7).
+                IF_NAME_RETURN_ATTRIB("world0", bgfx::Attrib::TexCoord7, "i_data0")
+                IF_NAME_RETURN_ATTRIB("world1", bgfx::Attrib::TexCoord6, "i_data1")
+                IF_NAME_RETURN_ATTRIB("world2", bgfx::Attrib::TexCoord5, "i_data2")
+                IF_NAME_RETURN_ATTRIB("world3", bgfx::Attrib::TexCoord4, "i_data3")
 #undef IF_NAME_RETURN_ATTRIB
                 return {FIRST_GENERIC_ATTRIBUTE_LOCATION + m_genericAttributesRunningCount++, name};
             }
 
-            static void Traverse(TIntermediate* intermediate, IdGenerator& ids)
+            static void Traverse(TIntermediate* intermediate, IdGenerator& ids, const std::vector<std::string>& instanceAttributes)
             {
-                VertexVaryingInTraverser traverser{};
+                VertexVaryingInTraverser traverser{instanceAttributes};
                 intermediate->getTreeRoot()->traverse(&traverser);
 
                 std::map<std::string, TIntermTyped*> originalNameToReplacement{};
@@ -491,6 +526,8 @@ namespace Babylon::ShaderCompilerTraversers
                     }
                 }
 
+                std::set<unsigned int> usedLocations{};
+
                 // Create the new symbols with which to replace all of the original varying 
                 // symbols. The primary purpose of these new symbols is to contain the required
                 // name and location.
@@ -499,6 +536,11 @@ namespace Babylon::ShaderCompilerTraversers
                     const auto& type = symbol->getType();
                     publicType.qualifier = type.getQualifier();
                     auto [location, newName] = traverser.GetVaryingLocationAndNewNameForName(name.c_str());
+                    if (!instanceAttributes.empty() && !usedLocations.insert(location).second)
+                    {
+                        // A per-instance attribute took a register also used by another attribute.
+                        throw std::runtime_error{"Per-instance attribute collides with vertex attribute " + name + "."};
+                    }
                     // It may not be necessary to specify this on certain platforms (like OpenGL), 
                     // which might simplify the handling of scenarios where we currently run out 
                     // of attribute locations.
@@ -522,12 +564,119 @@ namespace Babylon::ShaderCompilerTraversers
                 makeReplacements(originalNameToReplacement, traverser.m_symbolsToParents);
             }
 
+            const std::vector<std::string>& m_instanceAttributes;
             const unsigned int FIRST_GENERIC_ATTRIBUTE_LOCATION{10};
             unsigned int m_genericAttributesRunningCount{0};
             std::map<std::string, TIntermSymbol*> m_varyingNameToSymbol{};
             std::vector<std::pair<TIntermSymbol*, TIntermNode*>> m_symbolsToParents{};
         };
 
+        /// Replaces a mat4 uniform of the vertex shader by a matrix built from four new vec4
+        /// vertex attributes, so that the matrix can be read from the instance data registers.
+        class UniformToAttributesTraverser final : private TIntermTraverser
+        {
+        public:
+            static void Traverse(TProgram& program, IdGenerator& ids, const std::string& uniformName)
+            {
+                Traverse(program.getIntermediate(EShLangVertex), ids, uniformName);
+            }
+
+        private:
+            explicit UniformToAttributesTraverser(const std::string& uniformName)
+                : m_uniformName{uniformName}
+            {
+            }
+
+            virtual void visitSymbol(TIntermSymbol* symbol) override
+            {
+                const auto& qualifier = symbol->getType().getQualifier();
+                if (qualifier.storage == EvqVaryingIn && isLinkerObject(this->path))
+                {
+                    m_attributeNames.insert(symbol->getName().c_str());
+                }
+                else if (qualifier.storage == EvqUniform && symbol->getName() == m_uniformName.c_str())
+                {
+                    // Members of uniform blocks are accessed through the block symbol, so only a standalone
+                    // uniform can be found here.
+                    if (isLinkerObject(this->path))
+                    {
+                        m_linkerObject = symbol;
+                    }
+                    else
+                    {
+                        m_symbolsToParents.emplace_back(symbol, this->getParentNode());
+                    }
+                }
+            }
+
+            static void Traverse(TIntermediate* intermediate, IdGenerator& ids, const std::string& uniformName)
+            {
+                UniformToAttributesTraverser traverser{uniformName};
+                intermediate->getTreeRoot()->traverse(&traverser);
+
+                if (traverser.m_linkerObject == nullptr)
+                {
+                    throw std::runtime_error{"The vertex shader has no uniform " + uniformName + "."};
+                }
+
+                const auto& uniformType = traverser.m_linkerObject->getType();
+                if (!uniformType.isMatrix() || uniformType.isArray() || uniformType.getBasicType() != EbtFloat ||
+                    uniformType.getMatrixCols() != 4 || uniformType.getMatrixRows() != 4)
+                {
+                    throw std::runtime_error{"Uniform " + uniformName + " is not a mat4."};
+                }
+
+                TSourceLoc loc{};
+                loc.init();
+
+                // The attributes holding the columns of the matrix.
+                TType columnType{EbtFloat, EvqVaryingIn, 4};
+                columnType.getQualifier().precision = EpqHigh;
+                std::array<TIntermSymbol*, 4> columns{};
+                for (size_t idx = 0; idx < columns.size(); ++idx)
+                {
+                    const std::string name{uniformName + std::to_string(idx)};
+                    if (traverser.m_attributeNames.find(name) != traverser.m_attributeNames.end())
+                    {
+                        throw std::runtime_error{"The vertex shader already has an attribute " + name + "."};
+                    }
+
+                    columns[idx] = intermediate->addSymbol(TIntermSymbol{ids.Next(), name.c_str(), columnType});
+                }
+
+                // Every use of the uniform gets its own constructor node reading the columns.
+                TType matrixType{EbtFloat, EvqTemporary, 0, 4, 4};
+                matrixType.getQualifier().precision = EpqHigh;
+                for (const auto& [symbol, parent] : traverser.m_symbolsToParents)
+                {
+                    TIntermAggregate* constructor{};
+                    for (const auto* column : columns)
+                    {
+                        constructor = intermediate->growAggregate(constructor, intermediate->addSymbol(*column));
+                    }
+                    auto* replacement = intermediate->setAggregateOperator(constructor, EOpConstructMat4, matrixType, loc);
+                    makeReplacements({{uniformName, replacement}}, {{symbol, parent}});
+                }
+
+                // The uniform is no longer a linker object, the new attributes are.
+                auto* linkerObjectAggregate = intermediate->getTreeRoot()->getAsAggregate()->getSequence().back()->getAsAggregate();
+                assert(linkerObjectAggregate->getOp() == EOpLinkerObjects);
+                auto& sequence = linkerObjectAggregate->getSequence();
+                const auto found = std::find(sequence.begin(), sequence.end(), traverser.m_linkerObject);
+                if (found != sequence.end())
+                {
+                    RemoveAllTreeNodes(*found);
+                    sequence.erase(found);
+                }
+                sequence.insert(sequence.end(), columns.begin(), columns.end());
+            }
+
+            const std::string& m_uniformName;
+            std::set<std::string> m_attributeNames{};
+            TIntermSymbol* m_linkerObject{};
+            std::vector<std::pair<TIntermSymbol*, TIntermNode*>> m_symbolsToParents{};
+        };
+
         /// <summary>
         /// Split sampler symbols into separate sampler and texture symbols. This is
         /// required for DirectX, OpenGL, and Metal.
@@ -712,9 +861,14 @@ namespace Babylon::ShaderCompilerTraversers
         return UniformTypeChangeTraverser::Traverse(program, ids);
     }
 
-    void AssignLocationsAndNamesToVertexVaryings(TProgram& program, IdGenerator& ids)
+    void AssignLocationsAndNamesToVertexVaryings(TProgram& program, IdGenerator& ids, const std::vector<std::string>& instanceAttributes)
+    {
+        VertexVaryingInTraverser::Traverse(program, ids, instanceAttributes);
+    }
+
+    void ReplaceUniformWithAttributes(TProgram& program, IdGenerator& ids, const std::string& uniformName)
     {
-        VertexVaryingInTraverser::Traverse(program, ids);
+        UniformToAttributesTraverser::Traverse(program, ids, uniformName);
     }
 
     void SplitSamplersIntoSamplersAndTextures(TProgram& program, IdGenerator& ids)
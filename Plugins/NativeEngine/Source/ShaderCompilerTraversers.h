@@ -3,6 +3,8 @@
 #include <glslang/Public/ShaderLang.h>
 
 #include <memory>
+#include <string>
+#include <vector>
 
 namespace Babylon::ShaderCompilerTraversers
 {
@@ -65,8 +67,18 @@ namespace Babylon::ShaderCompilerTraversers
     ScopeT ChangeUniformTypes(glslang::TProgram& program, IdGenerator& ids);
 
     /// Changes the names and locations of varying attributes in the vertex shader to
-    /// match bgfx's expectations. 
-    void AssignLocationsAndNamesToVertexVaryings(glslang::TProgram& program, IdGenerator& ids);
+    /// match bgfx's expectations. The attributes listed in instanceAttributes are read
+    /// from the bgfx instance data registers, the first one from i_data0.
+    void AssignLocationsAndNamesToVertexVaryings(glslang::TProgram& program, IdGenerator& ids, const std::vector<std::string>& instanceAttributes);
+
+    /// Replaces the mat4 uniform of the vertex shader with the given name by a matrix built from the vec4
+    /// attributes <name>0 to <name>3, its columns. Thus, if the input shader has the uniform
+    ///
+    ///     mat4 world;
+    ///
+    /// then every use of world will instead read mat4(world0, world1, world2, world3). This must be done
+    /// before any of the other modifications.
+    void ReplaceUniformWithAttributes(glslang::TProgram& program, IdGenerator& ids, const std::string& uniformName);
 
     /// WebGL (and therefore Babylon.js) treats texture samplers as a single variable. 
     /// Native platforms expect them to be two separate variables -- a texture and a 
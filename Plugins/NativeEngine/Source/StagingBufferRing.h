@@ -0,0 +1,122 @@
+#pragma once
+
+#include <bgfx/bgfx.h>
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <cstring>
+#include <memory>
+
+namespace Babylon
+{
+    /// Provides the memory of buffer updates from a few preallocated slabs instead of allocating a copy for
+    /// each update. Each frame uses its own slab, which is only reused once bgfx has released every update
+    /// it holds. Updates that do not fit in the slab of the frame fall back to bgfx::alloc, and the slabs
+    /// grow to the size needed by the previous frame when they are recycled.
+    class StagingBufferRing final
+    {
+    public:
+        StagingBufferRing()
+        {
+            for (auto& slab : m_slabs)
+            {
+                slab = new Slab{};
+            }
+        }
+
+        StagingBufferRing(const StagingBufferRing&) = delete;
+        StagingBufferRing& operator=(const StagingBufferRing&) = delete;
+
+        ~StagingBufferRing()
+        {
+            // The slabs still referenced by bgfx are deleted when their last update is released.
+            for (auto* slab : m_slabs)
+            {
+                Release(slab);
+            }
+        }
+
+        /// Returns memory of the given size for a buffer update, to be filled by the caller through its data pointer.
+        const bgfx::Memory* Allocate(uint32_t size)
+        {
+            m_frameSize += Align(size);
+
+            auto& slab = *m_slabs[m_current];
+            if (!slab.Available || slab.Used + size > slab.Capacity)
+            {
+                return bgfx::alloc(size);
+            }
+
+            uint8_t* destination = slab.Data.get() + slab.Used;
+            slab.Used += Align(size);
+            slab.References++;
+
+            // The release function is called by bgfx once the update has been consumed, possibly from the render
+            // thread and after the ring is destroyed.
+            return bgfx::makeRef(destination, size, [](void*, void* userData) {
+                Release(static_cast<Slab*>(userData));
+            }, &slab);
+        }
+
+        const bgfx::Memory* Copy(const void* data, uint32_t size)
+        {
+            const bgfx::Memory* memory = Allocate(size);
+            std::memcpy(memory->data, data, size);
+            return memory;
+        }
+
+        /// Moves to the next slab. Must be called once per frame.
+        void NextFrame()
+        {
+            const size_t frameSize = m_frameSize;
+            m_frameSize = 0;
+
+            m_current = (m_current + 1) % m_slabs.size();
+            auto& slab = *m_slabs[m_current];
+            slab.Available = slab.References.load() == 1;
+            if (slab.Available)
+            {
+                slab.Used = 0;
+                if (slab.Capacity < frameSize)
+                {
+                    slab.Capacity = std::max(frameSize, MinimumSlabSize);
+                    slab.Data = std::make_unique<uint8_t[]>(slab.Capacity);
+                }
+            }
+        }
+
+    private:
+        static constexpr size_t MinimumSlabSize{64 * 1024};
+
+        static size_t Align(size_t size)
+        {
+            return (size + 15) & ~size_t{15};
+        }
+
+        // Slabs are reference counted by the ring and by each update bgfx holds, and deleted by the last of them.
+        // Only the ring uses the other members.
+        struct Slab
+        {
+            std::unique_ptr<uint8_t[]> Data{};
+            size_t Capacity{};
+            size_t Used{};
+            bool Available{false};
+            std::atomic<uint32_t> References{1};
+        };
+
+        static void Release(Slab* slab)
+        {
+            if (slab->References.fetch_sub(1) == 1)
+            {
+                delete slab;
+            }
+        }
+
+        // bgfx can hold on to the memory of an update for up to two frames.
+        std::array<Slab*, 3> m_slabs{};
+        size_t m_current{};
+        size_t m_frameSize{};
+    };
+}
@@ -0,0 +1,543 @@
+#include "TextureCache.h"
+
+#include <algorithm>
+#include <array>
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <vector>
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <cerrno>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace Babylon
+{
+    namespace
+    {
+        // Incremented whenever the processing of loaded textures changes, which invalidates all the entries.
+        constexpr uint32_t CacheVersion{1};
+        constexpr uint32_t EntryMagic{0x43544E42}; // BNTC
+        constexpr uint32_t IndexMagic{0x49544E42}; // BNTI
+
+        // Entries stored since the last save of the index are lost by a crash, and their files replaced when they
+        // are stored again.
+        constexpr std::chrono::seconds IndexSaveInterval{1};
+
+        // Header of an entry file, followed by the texture data. Its size keeps the data 16-byte aligned.
+        struct EntryHeader
+        {
+            uint32_t Magic{EntryMagic};
+            uint32_t Version{CacheVersion};
+            uint64_t Key{};
+            uint32_t Format{};
+            uint32_t Width{};
+            uint32_t Height{};
+            uint32_t NumMips{};
+            uint32_t DataSize{};
+            uint32_t Reserved[7]{};
+        };
+        static_assert(sizeof(EntryHeader) == 64);
+
+        struct IndexHeader
+        {
+            uint32_t Magic{IndexMagic};
+            uint32_t Version{CacheVersion};
+            uint64_t Clock{};
+            uint64_t EntryCount{};
+        };
+
+        // Records of orphaned files have no last use.
+        struct IndexRecord
+        {
+            uint64_t Key{};
+            uint64_t Size{};
+            uint64_t LastUse{};
+        };
+
+        // MurmurHash64A by Austin Appleby, public domain.
+        uint64_t Hash(gsl::span<const uint8_t> data, uint64_t seed)
+        {
+            constexpr uint64_t m{0xc6a4a7935bd1e995ull};
+            constexpr int r{47};
+
+            const size_t length = static_cast<size_t>(data.size());
+            uint64_t h = seed ^ (length * m);
+
+            const uint8_t* bytes = data.data();
+            const size_t blockCount = length / 8;
+            for (size_t block = 0; block < blockCount; ++block)
+            {
+                uint64_t k;
+                std::memcpy(&k, bytes + block * 8, sizeof(k));
+
+                k *= m;
+                k ^= k >> r;
+                k *= m;
+
+                h ^= k;
+                h *= m;
+            }
+
+            const uint8_t* tail = bytes + blockCount * 8;
+            switch (length & 7)
+            {
+                case 7: h ^= uint64_t{tail[6]} << 48; [[fallthrough]];
+                case 6: h ^= uint64_t{tail[5]} << 40; [[fallthrough]];
+                case 5: h ^= uint64_t{tail[4]} << 32; [[fallthrough]];
+                case 4: h ^= uint64_t{tail[3]} << 24; [[fallthrough]];
+                case 3: h ^= uint64_t{tail[2]} << 16; [[fallthrough]];
+                case 2: h ^= uint64_t{tail[1]} << 8; [[fallthrough]];
+                case 1:
+                    h ^= uint64_t{tail[0]};
+                    h *= m;
+            }
+
+            h ^= h >> r;
+            h *= m;
+            h ^= h >> r;
+            return h;
+        }
+
+#ifdef _WIN32
+        std::wstring Widen(const std::string& path)
+        {
+            const int length = MultiByteToWideChar(CP_UTF8, 0, path.c_str(), -1, nullptr, 0);
+            std::wstring widePath(static_cast<size_t>(length), L'\0');
+            MultiByteToWideChar(CP_UTF8, 0, path.c_str(), -1, widePath.data(), length);
+            return widePath;
+        }
+#endif
+
+        // Maps a whole file for reading. Returns nullptr when the file cannot be opened or is empty.
+        void* MapFile(const std::string& path, size_t& size)
+        {
+#ifdef _WIN32
+            const HANDLE file = CreateFile2(Widen(path).c_str(), GENERIC_READ, FILE_SHARE_READ | FILE_SHARE_DELETE, OPEN_EXISTING, nullptr);
+            if (file == INVALID_HANDLE_VALUE)
+            {
+                return nullptr;
+            }
+
+            LARGE_INTEGER fileSize{};
+            const HANDLE mapping = GetFileSizeEx(file, &fileSize) && fileSize.QuadPart > 0
+                                       ? CreateFileMappingFromApp(file, nullptr, PAGE_READONLY, 0, nullptr)
+                                       : nullptr;
+            CloseHandle(file);
+            if (mapping == nullptr)
+            {
+                return nullptr;
+            }
+
+            // The view keeps the mapping alive.
+            void* address = MapViewOfFileFromApp(mapping, FILE_MAP_READ, 0, 0);
+            CloseHandle(mapping);
+            size = static_cast<size_t>(fileSize.QuadPart);
+            return address;
+#else
+            const int file = open(path.c_str(), O_RDONLY);
+            if (file < 0)
+            {
+                return nullptr;
+            }
+
+            struct stat status{};
+            void* address = nullptr;
+            if (fstat(file, &status) == 0 && status.st_size > 0)
+            {
+                address = mmap(nullptr, static_cast<size_t>(status.st_size), PROT_READ, MAP_PRIVATE, file, 0);
+                if (address == MAP_FAILED)
+                {
+                    address = nullptr;
+                }
+            }
+            close(file);
+            size = static_cast<size_t>(status.st_size);
+            return address;
+#endif
+        }
+
+        void UnmapFile(void* address, size_t size)
+        {
+#ifdef _WIN32
+            (void)size;
+            UnmapViewOfFile(address);
+#else
+            munmap(address, size);
+#endif
+        }
+
+        // Deletes the file. Returns false when it still exists, which happens on Windows while it is mapped.
+        bool RemoveFile(const std::string& path)
+        {
+#ifdef _WIN32
+            if (DeleteFileW(Widen(path).c_str()))
+            {
+                return true;
+            }
+            const DWORD error = GetLastError();
+            return error == ERROR_FILE_NOT_FOUND || error == ERROR_PATH_NOT_FOUND;
+#else
+            return unlink(path.c_str()) == 0 || errno == ENOENT;
+#endif
+        }
+
+        // Moves the file over the destination, which std::rename does not replace on Windows. Fails on Windows while
+        // the destination is mapped.
+        bool MoveFileOver(const std::string& source, const std::string& destination)
+        {
+#ifdef _WIN32
+            return MoveFileExW(Widen(source).c_str(), Widen(destination).c_str(), MOVEFILE_REPLACE_EXISTING) != 0;
+#else
+            return std::rename(source.c_str(), destination.c_str()) == 0;
+#endif
+        }
+
+        // Whether the header describes the entry of the key, and the byte size of the texture it describes matches
+        // both the data size and the size of the file.
+        bool IsValid(const EntryHeader& header, uint64_t key, size_t fileSize)
+        {
+            if (header.Magic != EntryMagic || header.Version != CacheVersion || header.Key != key ||
+                static_cast<uint64_t>(header.DataSize) + sizeof(header) != fileSize)
+            {
+                return false;
+            }
+
+            const auto format = static_cast<bimg::TextureFormat::Enum>(header.Format);
+            if (header.Format >= bimg::TextureFormat::Count || format == bimg::TextureFormat::Unknown || format == bimg::TextureFormat::UnknownDepth ||
+                header.Width == 0 || header.Width > UINT16_MAX || header.Height == 0 || header.Height > UINT16_MAX || header.NumMips == 0 || header.NumMips > 16)
+            {
+                return false;
+            }
+
+            // Decoded files can have fewer mips than the full chain.
+            if ((std::max(header.Width, header.Height) >> (header.NumMips - 1)) == 0)
+            {
+                return false;
+            }
+
+            uint64_t expectedSize = 0;
+            for (uint32_t mip = 0; mip < header.NumMips; ++mip)
+            {
+                const uint16_t width = static_cast<uint16_t>(std::max(header.Width >> mip, 1u));
+                const uint16_t height = static_cast<uint16_t>(std::max(header.Height >> mip, 1u));
+                expectedSize += bimg::imageGetSize(nullptr, width, height, 1, false, false, 1, format);
+            }
+            return expectedSize == header.DataSize;
+        }
+
+        bool WriteParts(const std::string& path, gsl::span<const gsl::span<const uint8_t>> parts)
+        {
+            FILE* file = std::fopen(path.c_str(), "wb");
+            if (file == nullptr)
+            {
+                return false;
+            }
+
+            bool succeeded = true;
+            for (const auto& part : parts)
+            {
+                succeeded = succeeded && std::fwrite(part.data(), 1, static_cast<size_t>(part.size()), file) == static_cast<size_t>(part.size());
+            }
+            return std::fclose(file) == 0 && succeeded;
+        }
+
+        template<typename T>
+        gsl::span<const uint8_t> AsBytes(const T& value)
+        {
+            return gsl::make_span(reinterpret_cast<const uint8_t*>(&value), sizeof(T));
+        }
+    }
+
+    TextureCache::MappedTexture::MappedTexture(void* address, size_t size)
+        : m_address{address}
+        , m_size{size}
+    {
+    }
+
+    TextureCache::MappedTexture::~MappedTexture()
+    {
+        UnmapFile(m_address, m_size);
+    }
+
+    bimg::ImageContainer TextureCache::MappedTexture::GetImage() const
+    {
+        bimg::ImageContainer image{};
+        image.m_data = const_cast<uint8_t*>(Data);
+        image.m_size = Size;
+        image.m_format = Format;
+        image.m_width = Width;
+        image.m_height = Height;
+        image.m_depth = 1;
+        image.m_numLayers = 1;
+        image.m_numMips = NumMips;
+        return image;
+    }
+
+    TextureCache::TextureCache(std::string directory, uint64_t maxBytes)
+        : m_directory{std::move(directory)}
+        , m_maxBytes{maxBytes}
+    {
+        LoadIndex();
+
+        std::scoped_lock lock{m_mutex};
+        DeleteOrphans();
+    }
+
+    TextureCache::~TextureCache()
+    {
+        // Saves the stores since the last save, and the uses of the entries.
+        SaveIndex(true);
+    }
+
+    uint64_t TextureCache::ComputeKey(gsl::span<const uint8_t> source, uint64_t processing)
+    {
+        return Hash(source, processing);
+    }
+
+    std::unique_ptr<TextureCache::MappedTexture> TextureCache::Find(uint64_t key)
+    {
+        {
+            std::scoped_lock lock{m_mutex};
+            const auto it = m_entries.find(key);
+            if (it == m_entries.end())
+            {
+                return nullptr;
+            }
+            it->second.LastUse = ++m_clock;
+            m_indexChanged = true;
+        }
+
+        size_t size{};
+        void* address = MapFile(GetEntryPath(key), size);
+        if (address == nullptr)
+        {
+            std::scoped_lock lock{m_mutex};
+            Remove(key);
+            return nullptr;
+        }
+
+        auto texture = std::make_unique<MappedTexture>(address, size);
+
+        EntryHeader header{};
+        if (size >= sizeof(header))
+        {
+            std::memcpy(&header, address, sizeof(header));
+        }
+        if (!IsValid(header, key, size))
+        {
+            texture.reset();
+            std::scoped_lock lock{m_mutex};
+            Remove(key);
+            return nullptr;
+        }
+
+        texture->Format = static_cast<bimg::TextureFormat::Enum>(header.Format);
+        texture->Width = header.Width;
+        texture->Height = header.Height;
+        texture->NumMips = static_cast<uint8_t>(header.NumMips);
+        texture->Data = static_cast<const uint8_t*>(address) + sizeof(header);
+        texture->Size = header.DataSize;
+        return texture;
+    }
+
+    void TextureCache::Store(uint64_t key, const bimg::ImageContainer& image)
+    {
+        const uint64_t size = sizeof(EntryHeader) + static_cast<uint64_t>(image.m_size);
+        if (size > m_maxBytes)
+        {
+            return;
+        }
+
+        EntryHeader header{};
+        header.Key = key;
+        header.Format = static_cast<uint32_t>(image.m_format);
+        header.Width = image.m_width;
+        header.Height = image.m_height;
+        header.NumMips = image.m_numMips;
+        header.DataSize = image.m_size;
+
+        const std::string path = GetEntryPath(key);
+        const std::string temporaryPath = path + ".tmp";
+        const std::array<gsl::span<const uint8_t>, 2> parts{AsBytes(header), gsl::make_span(static_cast<const uint8_t*>(image.m_data), image.m_size)};
+
+        {
+            std::scoped_lock lock{m_mutex};
+            if (!m_pendingKeys.insert(key).second)
+            {
+                return;
+            }
+        }
+
+        // Written to a temporary file first, so that a crash never leaves a partial entry behind. The write does not
+        // hold the lock, the pending key keeps other stores of the same texture away from the temporary file.
+        const bool written = WriteParts(temporaryPath, parts);
+
+        {
+            std::scoped_lock lock{m_mutex};
+            m_pendingKeys.erase(key);
+
+            // The file is moved into place under the lock, so that it always matches the index.
+            if (!written || !MoveFileOver(temporaryPath, path))
+            {
+                RemoveFile(temporaryPath);
+                return;
+            }
+
+            // The previous file of the key, as an entry or an orphan, was replaced.
+            if (const auto it = m_entries.find(key); it != m_entries.end())
+            {
+                m_totalSize -= it->second.Size;
+                m_entries.erase(it);
+            }
+            if (const auto it = m_orphans.find(key); it != m_orphans.end())
+            {
+                m_totalSize -= it->second;
+                m_orphans.erase(it);
+            }
+
+            m_entries[key] = {size, ++m_clock};
+            m_totalSize += size;
+            m_indexChanged = true;
+
+            DeleteOrphans();
+            while (m_totalSize > m_maxBytes && !m_entries.empty())
+            {
+                const auto leastRecentlyUsed = std::min_element(m_entries.begin(), m_entries.end(), [](const auto& a, const auto& b) {
+                    return a.second.LastUse < b.second.LastUse;
+                });
+                Remove(leastRecentlyUsed->first);
+            }
+        }
+
+        SaveIndex(false);
+    }
+
+    std::string TextureCache::GetEntryPath(uint64_t key) const
+    {
+        char name[32];
+        std::snprintf(name, sizeof(name), "/%016llx.tex", static_cast<unsigned long long>(key));
+        return m_directory + name;
+    }
+
+    void TextureCache::Remove(uint64_t key)
+    {
+        const auto it = m_entries.find(key);
+        if (it == m_entries.end())
+        {
+            return;
+        }
+
+        // Mapped entries cannot be deleted on Windows, their files are deleted later or replaced when the texture
+        // is stored again.
+        if (RemoveFile(GetEntryPath(key)))
+        {
+            m_totalSize -= it->second.Size;
+        }
+        else
+        {
+            m_orphans[key] = it->second.Size;
+        }
+        m_entries.erase(it);
+        m_indexChanged = true;
+    }
+
+    void TextureCache::DeleteOrphans()
+    {
+        for (auto it = m_orphans.begin(); it != m_orphans.end();)
+        {
+            if (RemoveFile(GetEntryPath(it->first)))
+            {
+                m_totalSize -= it->second;
+                it = m_orphans.erase(it);
+                m_indexChanged = true;
+            }
+            else
+            {
+                ++it;
+            }
+        }
+    }
+
+    void TextureCache::LoadIndex()
+    {
+        FILE* file = std::fopen((m_directory + "/index").c_str(), "rb");
+        if (file == nullptr)
+        {
+            return;
+        }
+
+        IndexHeader header{};
+        if (std::fread(&header, sizeof(header), 1, file) == 1 && header.Magic == IndexMagic && header.Version == CacheVersion)
+        {
+            m_clock = header.Clock;
+            IndexRecord record{};
+            for (uint64_t index = 0; index < header.EntryCount && std::fread(&record, sizeof(record), 1, file) == 1; ++index)
+            {
+                if (record.LastUse == 0)
+                {
+                    m_orphans[record.Key] = record.Size;
+                }
+                else
+                {
+                    m_entries[record.Key] = {record.Size, record.LastUse};
+                }
+                m_totalSize += record.Size;
+            }
+        }
+        std::fclose(file);
+    }
+
+    void TextureCache::SaveIndex(bool force)
+    {
+        // A store that finds another thread saving the index leaves the save to a later store.
+        std::unique_lock indexLock{m_indexMutex, std::defer_lock};
+        if (force)
+        {
+            indexLock.lock();
+        }
+        else if (!indexLock.try_lock())
+        {
+            return;
+        }
+
+        IndexHeader header{};
+        std::vector<IndexRecord> records{};
+        {
+            std::scoped_lock lock{m_mutex};
+            const auto now = std::chrono::steady_clock::now();
+            if (!m_indexChanged || (!force && now - m_lastIndexSave < IndexSaveInterval))
+            {
+                return;
+            }
+            m_indexChanged = false;
+            m_lastIndexSave = now;
+
+            header.Clock = m_clock;
+            header.EntryCount = m_entries.size() + m_orphans.size();
+            records.reserve(header.EntryCount);
+            for (const auto& [key, entry] : m_entries)
+            {
+                records.push_back({key, entry.Size, entry.LastUse});
+            }
+            for (const auto& [key, size] : m_orphans)
+            {
+                records.push_back({key, size, 0});
+            }
+        }
+
+        const std::string path = m_directory + "/index";
+        const std::array<gsl::span<const uint8_t>, 2> parts{AsBytes(header), gsl::make_span(reinterpret_cast<const uint8_t*>(records.data()), records.size() * sizeof(IndexRecord))};
+        if (!WriteParts(path + ".tmp", parts) || !MoveFileOver(path + ".tmp", path))
+        {
+            std::scoped_lock lock{m_mutex};
+            m_indexChanged = true;
+        }
+    }
+}
@@ -0,0 +1,98 @@
+#pragma once
+
+#include <bimg/bimg.h>
+
+#include <gsl/gsl>
+
+#include <chrono>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <unordered_set>
+
+namespace Babylon
+{
+    /// Persistent cache of decoded and processed textures, ready to upload. Entries are files in a directory, named
+    /// after a hash of the source bytes and of the processing applied to them, and evicted in least recently used
+    /// order when the total size exceeds the limit. Cache hits are memory mapped rather than read. Thread safe.
+    class TextureCache final
+    {
+    public:
+        /// A cache hit, mapped in memory until it is destroyed.
+        class MappedTexture final
+        {
+        public:
+            MappedTexture(void* address, size_t size);
+            ~MappedTexture();
+
+            MappedTexture(const MappedTexture&) = delete;
+            MappedTexture& operator=(const MappedTexture&) = delete;
+
+            /// Returns an image over the mapped data, valid while the texture is mapped.
+            bimg::ImageContainer GetImage() const;
+
+            bimg::TextureFormat::Enum Format{};
+            uint32_t Width{};
+            uint32_t Height{};
+            uint8_t NumMips{};
+            const uint8_t* Data{};
+            uint32_t Size{};
+
+        private:
+            void* m_address{};
+            size_t m_size{};
+        };
+
+        TextureCache(std::string directory, uint64_t maxBytes);
+        ~TextureCache();
+
+        TextureCache(const TextureCache&) = delete;
+        TextureCache& operator=(const TextureCache&) = delete;
+
+        /// Returns the key of the texture produced from the source bytes with the given processing, which must
+        /// include everything that changes the result (such as flipping, mips and the compressed format).
+        static uint64_t ComputeKey(gsl::span<const uint8_t> source, uint64_t processing);
+
+        /// Returns the cached texture, or nullptr when there is none.
+        std::unique_ptr<MappedTexture> Find(uint64_t key);
+
+        /// Writes the texture to the cache, evicting the least recently used entries to stay within the size limit.
+        /// The file is written without holding the lock, and the index is saved at most once per second.
+        void Store(uint64_t key, const bimg::ImageContainer& image);
+
+    private:
+        struct Entry
+        {
+            uint64_t Size{};
+            uint64_t LastUse{};
+        };
+
+        std::string GetEntryPath(uint64_t key) const;
+        void Remove(uint64_t key);
+        void DeleteOrphans();
+        void LoadIndex();
+        void SaveIndex(bool force);
+
+        const std::string m_directory;
+        const uint64_t m_maxBytes;
+
+        // Guards the index. The files of the entries are written without the lock, and only moved into place and
+        // deleted under it.
+        std::mutex m_mutex{};
+        std::unordered_map<uint64_t, Entry> m_entries{};
+        // Files of removed entries that could not be deleted, such as mapped entries on Windows, with their size.
+        // They count against the size limit until they are deleted.
+        std::unordered_map<uint64_t, uint64_t> m_orphans{};
+        // Keys being written, a second store of the same key is skipped.
+        std::unordered_set<uint64_t> m_pendingKeys{};
+        uint64_t m_totalSize{};
+        uint64_t m_clock{};
+        bool m_indexChanged{};
+        std::chrono::steady_clock::time_point m_lastIndexSave{};
+
+        // Serializes the writes of the index file, taken before m_mutex.
+        std::mutex m_indexMutex{};
+    };
+}
@@ -0,0 +1,163 @@
+#pragma once
+
+#include <bgfx/bgfx.h>
+#include <bimg/bimg.h>
+#include <bimg/encode.h>
+#include <bx/allocator.h>
+#include <bx/error.h>
+
+#include <algorithm>
+#include <array>
+#include <cstdint>
+#include <cstring>
+#include <vector>
+
+namespace Babylon
+{
+    /// Trade-off between encoding time and quality of the textures compressed when they are loaded.
+    enum class TextureCompressionPreset : uint32_t
+    {
+        None,
+        Fast,
+        Balanced,
+        Quality,
+    };
+
+    /// Formats decoded images are compressed to, chosen among the formats supported by the renderer.
+    /// A format is bimg::TextureFormat::Count when images of that kind are kept uncompressed.
+    struct TextureCompressionFormats
+    {
+        bimg::TextureFormat::Enum Opaque{bimg::TextureFormat::Count};
+        bimg::TextureFormat::Enum Transparent{bimg::TextureFormat::Count};
+        bimg::Quality::Enum Quality{bimg::Quality::Default};
+
+        bool IsEnabled() const
+        {
+            return Opaque != bimg::TextureFormat::Count || Transparent != bimg::TextureFormat::Count;
+        }
+    };
+
+    namespace TextureCompressionDetail
+    {
+        template<size_t Size>
+        bimg::TextureFormat::Enum FirstSupportedFormat(const bgfx::Caps& caps, const std::array<bimg::TextureFormat::Enum, Size>& candidates)
+        {
+            for (const auto format : candidates)
+            {
+                if ((caps.formats[format] & BGFX_CAPS_FORMAT_TEXTURE_2D) != 0)
+                {
+                    return format;
+                }
+            }
+            return bimg::TextureFormat::Count;
+        }
+
+        inline bool HasTransparency(const bimg::ImageContainer& image)
+        {
+            const auto* pixels = static_cast<const uint8_t*>(image.m_data);
+            const size_t pixelCount = static_cast<size_t>(image.m_width) * image.m_height;
+            for (size_t pixel = 0; pixel < pixelCount; ++pixel)
+            {
+                if (pixels[pixel * 4 + 3] != UINT8_MAX)
+                {
+                    return true;
+                }
+            }
+            return false;
+        }
+    }
+
+    /// Returns the formats to compress images to with the preset: BC on desktop GPUs, ETC2 or ASTC on mobile GPUs.
+    /// Faster presets favor the formats with the fastest encoders and the smallest blocks of memory.
+    inline TextureCompressionFormats SelectTextureCompressionFormats(TextureCompressionPreset preset, const bgfx::Caps& caps)
+    {
+        using TextureCompressionDetail::FirstSupportedFormat;
+        using Format = bimg::TextureFormat;
+
+        switch (preset)
+        {
+            case TextureCompressionPreset::Fast:
+                return {
+                    FirstSupportedFormat<3>(caps, {Format::BC1, Format::ETC2, Format::ASTC8x6}),
+                    FirstSupportedFormat<2>(caps, {Format::BC3, Format::ASTC8x6}),
+                    bimg::Quality::Fastest};
+            case TextureCompressionPreset::Balanced:
+                return {
+                    FirstSupportedFormat<3>(caps, {Format::BC1, Format::ETC2, Format::ASTC6x6}),
+                    FirstSupportedFormat<2>(caps, {Format::BC3, Format::ASTC6x6}),
+                    bimg::Quality::Default};
+            case TextureCompressionPreset::Quality:
+                return {
+                    FirstSupportedFormat<3>(caps, {Format::BC7, Format::ETC2, Format::ASTC4x4}),
+                    FirstSupportedFormat<2>(caps, {Format::BC7, Format::ASTC4x4}),
+                    bimg::Quality::Highest};
+            default:
+                return {};
+        }
+    }
+
+    /// Compresses a decoded image, and its mips, to one of the formats. The image is left unchanged when it is already
+    /// compressed, is not 8-bit color, or when no format applies or the encoder does not support the format.
+    inline void CompressImage(bx::AllocatorI* allocator, bimg::ImageContainer** image, const TextureCompressionFormats& formats)
+    {
+        bimg::ImageContainer* input = *image;
+        if (input->m_format != bimg::TextureFormat::RGBA8 && input->m_format != bimg::TextureFormat::BGRA8 && input->m_format != bimg::TextureFormat::RGB8)
+        {
+            return;
+        }
+
+        bimg::ImageContainer* rgba = input->m_format == bimg::TextureFormat::RGBA8 ? input : bimg::imageConvert(allocator, bimg::TextureFormat::RGBA8, *input);
+        const auto freeRgba = [input, rgba]() {
+            if (rgba != input)
+            {
+                bimg::imageFree(rgba);
+            }
+        };
+
+        const bimg::TextureFormat::Enum format = TextureCompressionDetail::HasTransparency(*rgba) ? formats.Transparent : formats.Opaque;
+        if (format == bimg::TextureFormat::Count)
+        {
+            freeRgba();
+            return;
+        }
+
+        bimg::ImageContainer* output = bimg::imageAlloc(allocator, format, static_cast<uint16_t>(rgba->m_width), static_cast<uint16_t>(rgba->m_height), 1, 1, false, rgba->m_numMips > 1);
+
+        std::vector<uint8_t> padded{};
+        for (uint8_t lod = 0; lod < rgba->m_numMips; ++lod)
+        {
+            bimg::ImageMip source{};
+            bimg::ImageMip destination{};
+            bimg::imageGetRawData(*rgba, 0, lod, rgba->m_data, rgba->m_size, source);
+            bimg::imageGetRawData(*output, 0, lod, output->m_data, output->m_size, destination);
+
+            // The destination is rounded up to whole blocks, the missing pixels repeat the last row and column.
+            const uint32_t width = destination.m_width;
+            const uint32_t height = destination.m_height;
+            padded.resize(static_cast<size_t>(width) * height * 4);
+            for (uint32_t y = 0; y < height; ++y)
+            {
+                const uint8_t* sourceRow = source.m_data + static_cast<size_t>(std::min(y, source.m_height - 1)) * source.m_width * 4;
+                uint8_t* paddedRow = padded.data() + static_cast<size_t>(y) * width * 4;
+                std::memcpy(paddedRow, sourceRow, static_cast<size_t>(std::min(width, source.m_width)) * 4);
+                for (uint32_t x = source.m_width; x < width; ++x)
+                {
+                    std::memcpy(paddedRow + static_cast<size_t>(x) * 4, sourceRow + static_cast<size_t>(source.m_width - 1) * 4, 4);
+                }
+            }
+
+            bx::Error error{};
+            bimg::imageEncodeFromRgba8(const_cast<uint8_t*>(destination.m_data), padded.data(), width, height, 1, format, formats.Quality, &error);
+            if (!error.isOk())
+            {
+                bimg::imageFree(output);
+                freeRgba();
+                return;
+            }
+        }
+
+        freeRgba();
+        bimg::imageFree(input);
+        *image = output;
+    }
+}
@@ -0,0 +1,194 @@
+#pragma once
+
+#include <PixelSwizzle.h>
+
+#include <bgfx/bgfx.h>
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <functional>
+#include <memory>
+#include <utility>
+#include <vector>
+
+namespace Babylon
+{
+    /// Pixels read back from a texture, valid during the completion callback of the read only.
+    struct ReadbackPixels
+    {
+        const uint8_t* Data{};
+        uint32_t Width{};
+        uint32_t Height{};
+        bool Bgra{};
+
+        // Whether the rows are stored from the bottom of the region to its top.
+        bool BottomUp{};
+
+        uint32_t GetSize() const
+        {
+            return Width * Height * 4;
+        }
+
+        /// Copies the pixels to destination as RGBA8 rows, from the top of the region to its bottom.
+        void CopyTo(uint8_t* destination) const
+        {
+            const size_t pitch = static_cast<size_t>(Width) * 4;
+            for (uint32_t row = 0; row < Height; ++row)
+            {
+                const uint8_t* source = Data + (BottomUp ? Height - row - 1 : row) * pitch;
+                if (Bgra)
+                {
+                    SwizzleBgraToRgba(source, destination + row * pitch, Width);
+                }
+                else
+                {
+                    std::memcpy(destination + row * pitch, source, pitch);
+                }
+            }
+        }
+    };
+
+    /// Reads regions of textures back to memory without stalling. Each read blits the region to a staging texture,
+    /// whose content bgfx copies to memory a few frames later. The staging textures and their memory are reused by
+    /// the reads of the same size and format.
+    class TextureReadback final
+    {
+    public:
+        using CompletionCallback = std::function<void(const ReadbackPixels&)>;
+
+        /// Number of staging textures kept for later reads once their read is complete.
+        static constexpr size_t MaxIdleStagingTextures{4};
+
+        TextureReadback() = default;
+        TextureReadback(const TextureReadback&) = delete;
+        TextureReadback& operator=(const TextureReadback&) = delete;
+
+        static bool IsSupported()
+        {
+            const uint64_t required = BGFX_CAPS_TEXTURE_BLIT | BGFX_CAPS_TEXTURE_READ_BACK;
+            return (bgfx::getCaps()->supported & required) == required;
+        }
+
+        static bool IsFormatSupported(bgfx::TextureFormat::Enum format)
+        {
+            return format == bgfx::TextureFormat::RGBA8 || format == bgfx::TextureFormat::BGRA8;
+        }
+
+        /// Reads a region of the texture, with its origin at the top left corner of the texture. The blit is recorded
+        /// in the given view, which must come after the draws to the texture. onComplete is called by Update.
+        void Read(bgfx::ViewId viewId, bgfx::TextureHandle texture, bgfx::TextureFormat::Enum format, uint16_t textureHeight,
+            uint16_t x, uint16_t y, uint16_t width, uint16_t height, CompletionCallback onComplete)
+        {
+            // Textures are stored from their bottom row on with OpenGL.
+            const bool bottomUp = bgfx::getCaps()->originBottomLeft;
+
+            Staging staging = AcquireStaging(width, height, format);
+            bgfx::blit(viewId, staging.Handle, 0, 0, texture, x, bottomUp ? static_cast<uint16_t>(textureHeight - y - height) : y, width, height);
+            const uint32_t frame = bgfx::readTexture(staging.Handle, staging.Data.get());
+
+            m_pending.push_back({std::move(staging), frame, bottomUp, std::move(onComplete)});
+        }
+
+        bool IsEmpty() const
+        {
+            return m_pending.empty();
+        }
+
+        /// Completes the reads bgfx is done with, given the number returned by the last call to bgfx::frame.
+        void Update(uint32_t frameNumber)
+        {
+            const auto it = std::stable_partition(m_pending.begin(), m_pending.end(), [frameNumber](const Pending& pending) {
+                return pending.Frame > frameNumber;
+            });
+            std::vector<Pending> completed{std::make_move_iterator(it), std::make_move_iterator(m_pending.end())};
+            m_pending.erase(it, m_pending.end());
+
+            // Called once the reads are removed, as callbacks may request other reads.
+            for (auto& pending : completed)
+            {
+                const Staging& staging = pending.Texture;
+                pending.OnComplete({staging.Data.get(), staging.Width, staging.Height, staging.Format == bgfx::TextureFormat::BGRA8, pending.BottomUp});
+                ReleaseStaging(std::move(pending.Texture));
+            }
+        }
+
+        /// Memory of reads bgfx may still write to until it is done with the given frame.
+        struct RetiredMemory
+        {
+            std::vector<std::unique_ptr<uint8_t[]>> Data{};
+            uint32_t Frame{};
+        };
+
+        /// Destroys the staging textures. The memory of the reads still pending is returned, for the caller to free
+        /// once bgfx is done with the frame of the last of them.
+        RetiredMemory Clear()
+        {
+            RetiredMemory retired{};
+            for (auto& pending : m_pending)
+            {
+                bgfx::destroy(pending.Texture.Handle);
+                retired.Data.push_back(std::move(pending.Texture.Data));
+                retired.Frame = std::max(retired.Frame, pending.Frame);
+            }
+            m_pending.clear();
+
+            for (const auto& staging : m_idle)
+            {
+                bgfx::destroy(staging.Handle);
+            }
+            m_idle.clear();
+
+            return retired;
+        }
+
+    private:
+        struct Staging
+        {
+            bgfx::TextureHandle Handle{bgfx::kInvalidHandle};
+            uint16_t Width{};
+            uint16_t Height{};
+            bgfx::TextureFormat::Enum Format{bgfx::TextureFormat::Unknown};
+            std::unique_ptr<uint8_t[]> Data{};
+        };
+
+        struct Pending
+        {
+            Staging Texture{};
+            uint32_t Frame{};
+            bool BottomUp{};
+            CompletionCallback OnComplete{};
+        };
+
+        Staging AcquireStaging(uint16_t width, uint16_t height, bgfx::TextureFormat::Enum format)
+        {
+            const auto it = std::find_if(m_idle.begin(), m_idle.end(), [width, height, format](const Staging& staging) {
+                return staging.Width == width && staging.Height == height && staging.Format == format;
+            });
+            if (it != m_idle.end())
+            {
+                Staging staging = std::move(*it);
+                m_idle.erase(it);
+                return staging;
+            }
+
+            const bgfx::TextureHandle handle = bgfx::createTexture2D(width, height, false, 1, format, BGFX_TEXTURE_BLIT_DST | BGFX_TEXTURE_READ_BACK);
+            return {handle, width, height, format, std::make_unique<uint8_t[]>(static_cast<size_t>(width) * height * 4)};
+        }
+
+        void ReleaseStaging(Staging staging)
+        {
+            if (m_idle.size() == MaxIdleStagingTextures)
+            {
+                // The oldest is dropped, bgfx defers its destruction past the frames that may still use it.
+                bgfx::destroy(m_idle.front().Handle);
+                m_idle.erase(m_idle.begin());
+            }
+            m_idle.push_back(std::move(staging));
+        }
+
+        std::vector<Pending> m_pending{};
+        std::vector<Staging> m_idle{};
+    };
+}
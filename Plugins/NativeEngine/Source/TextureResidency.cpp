@@ -0,0 +1,258 @@
+#include "TextureResidency.h"
+#include "NativeEngine.h"
+
+#include <algorithm>
+#include <vector>
+
+namespace Babylon
+{
+    namespace
+    {
+        uint16_t GetLevelDimension(uint32_t dimension, uint8_t level)
+        {
+            return static_cast<uint16_t>(std::max(dimension >> level, 1u));
+        }
+    }
+
+    void TextureResidency::SetBudget(uint64_t budget)
+    {
+        m_budget = budget;
+    }
+
+    void TextureResidency::Track(TextureData* texture, const bimg::ImageContainer& image, Reloader reload)
+    {
+        Untrack(texture);
+
+        Entry entry{};
+        entry.Format = static_cast<bgfx::TextureFormat::Enum>(image.m_format);
+        entry.Width = image.m_width;
+        entry.Height = image.m_height;
+        entry.NumMips = image.m_numMips;
+        entry.Bytes = image.m_size;
+        entry.FullBytes = image.m_size;
+        if (reload)
+        {
+            entry.MaxLevel = TextureStreamer::GetInitialLevel(image, MinimumSize);
+        }
+
+        // Textures too small to be reduced are only accounted.
+        if (entry.MaxLevel > 0)
+        {
+            entry.Reload = std::move(reload);
+        }
+
+        m_totalBytes += entry.Bytes;
+        m_entries[texture] = std::move(entry);
+    }
+
+    void TextureResidency::Track(TextureData* texture, uint64_t bytes)
+    {
+        Untrack(texture);
+
+        Entry entry{};
+        entry.Bytes = bytes;
+        entry.FullBytes = bytes;
+        m_totalBytes += bytes;
+        m_entries[texture] = std::move(entry);
+    }
+
+    void TextureResidency::Untrack(TextureData* texture)
+    {
+        const auto it = m_entries.find(texture);
+        if (it != m_entries.end())
+        {
+            m_totalBytes -= it->second.Bytes;
+            m_entries.erase(it);
+        }
+    }
+
+    void TextureResidency::Restore(TextureData* texture, uint64_t request, StreamedImage source)
+    {
+        const auto it = m_entries.find(texture);
+        if (it == m_entries.end() || it->second.Request != request)
+        {
+            return;
+        }
+
+        Entry& entry = it->second;
+        if (!source.Owner || source.Image.m_size != entry.FullBytes)
+        {
+            // The image is no longer available, such as when it was evicted from the texture cache. The texture keeps
+            // the levels it has and is no longer reduced.
+            entry.Request = 0;
+            entry.Reload = {};
+            entry.MaxLevel = entry.Level;
+            return;
+        }
+
+        entry.Reloaded = std::move(source);
+    }
+
+    void TextureResidency::Update(uint32_t frameIndex, const BlitViewAcquirer& acquireBlitView)
+    {
+        const uint64_t budget = m_budget > 0 ? m_budget : UINT64_MAX;
+        const uint32_t previousFrame = frameIndex > 0 ? frameIndex - 1 : 0;
+
+        // Only acquired once a texture is reduced.
+        bgfx::ViewId blitView{bgfx::kInvalidHandle};
+
+        // Finds the reduced textures bound in the previous frame, and the room restoring all of them needs.
+        std::vector<std::pair<TextureData*, Entry*>> restored{};
+        uint64_t needed = 0;
+        for (auto& [texture, entry] : m_entries)
+        {
+            if (entry.Level == 0 || !entry.Reload)
+            {
+                continue;
+            }
+
+            if (texture->LastUsedFrame < previousFrame)
+            {
+                // No longer bound, a reloaded image is not worth keeping.
+                entry.Request = 0;
+                entry.Reloaded = {};
+                continue;
+            }
+
+            restored.emplace_back(texture, &entry);
+            needed += entry.FullBytes - entry.Bytes;
+        }
+
+        // Makes room for all of them at once in the other textures, then restores as many levels as fit.
+        if (!restored.empty())
+        {
+            Reduce(budget > needed ? budget - needed : 0, previousFrame, blitView, acquireBlitView);
+        }
+
+        for (auto& [texture, entry] : restored)
+        {
+            uint8_t level = entry->Level;
+            while (level > 0 && m_totalBytes - entry->Bytes + GetSize(*entry, static_cast<uint8_t>(level - 1)) <= budget)
+            {
+                --level;
+            }
+
+            if (level == entry->Level)
+            {
+                continue;
+            }
+
+            // The dropped levels need the image loaded again, the texture keeps its levels meanwhile.
+            if (entry->Reloaded.Owner)
+            {
+                Grow(*texture, *entry, level);
+            }
+            else if (entry->Request == 0)
+            {
+                entry->Request = ++m_lastRequest;
+                entry->Reload(entry->Request);
+            }
+        }
+
+        // Then reduces the least recently used textures, the ones bound in the previous frame last.
+        Reduce(budget, previousFrame, blitView, acquireBlitView);
+        Reduce(budget, UINT32_MAX, blitView, acquireBlitView);
+    }
+
+    void TextureResidency::Clear()
+    {
+        m_entries.clear();
+        m_totalBytes = 0;
+    }
+
+    uint64_t TextureResidency::GetSize(const Entry& entry, uint8_t level)
+    {
+        if (level == 0)
+        {
+            return entry.FullBytes;
+        }
+
+        uint64_t size = 0;
+        for (uint8_t mip = level; mip < entry.NumMips; ++mip)
+        {
+            size += bimg::imageGetSize(nullptr, GetLevelDimension(entry.Width, mip), GetLevelDimension(entry.Height, mip), 1, false, false, 1, static_cast<bimg::TextureFormat::Enum>(entry.Format));
+        }
+        return size;
+    }
+
+    void TextureResidency::Reduce(uint64_t budget, uint32_t usedBefore, bgfx::ViewId& blitView, const BlitViewAcquirer& acquireBlitView)
+    {
+        if (m_totalBytes <= budget)
+        {
+            return;
+        }
+
+        std::vector<std::pair<TextureData*, Entry*>> candidates{};
+        for (auto& [texture, entry] : m_entries)
+        {
+            if (entry.Level < entry.MaxLevel && texture->LastUsedFrame < usedBefore)
+            {
+                candidates.emplace_back(texture, &entry);
+            }
+        }
+        std::sort(candidates.begin(), candidates.end(), [](const auto& a, const auto& b) {
+            return a.first->LastUsedFrame < b.first->LastUsedFrame;
+        });
+
+        for (auto& [texture, entry] : candidates)
+        {
+            // Each level dropped divides the size by about 4, the texture is recreated once.
+            uint8_t level = entry->Level;
+            uint64_t bytes = entry->Bytes;
+            while (level < entry->MaxLevel && m_totalBytes - entry->Bytes + bytes > budget)
+            {
+                ++level;
+                bytes = GetSize(*entry, level);
+            }
+            if (blitView == bgfx::kInvalidHandle)
+            {
+                blitView = acquireBlitView();
+            }
+            Shrink(*texture, *entry, level, blitView);
+
+            if (m_totalBytes <= budget)
+            {
+                return;
+            }
+        }
+    }
+
+    void TextureResidency::Shrink(TextureData& texture, Entry& entry, uint8_t level, bgfx::ViewId blitView)
+    {
+        // The remaining levels are copied on the GPU into a smaller texture. Called between frames, so that no pending
+        // draw refers to the destroyed texture, which bgfx destroys after the blits of the frame.
+        const auto numMips = static_cast<uint8_t>(entry.NumMips - level);
+        const bgfx::TextureHandle handle = bgfx::createTexture2D(GetLevelDimension(entry.Width, level), GetLevelDimension(entry.Height, level),
+            numMips > 1, 1, entry.Format, BGFX_TEXTURE_BLIT_DST | BGFX_SAMPLER_NONE);
+        for (uint8_t mip = 0; mip < numMips; ++mip)
+        {
+            bgfx::blit(blitView, handle, mip, 0, 0, 0, texture.Handle, static_cast<uint8_t>(level - entry.Level + mip), 0, 0, 0);
+        }
+        bgfx::destroy(texture.Handle);
+        texture.Handle = handle;
+
+        SetLevel(entry, level);
+    }
+
+    void TextureResidency::Grow(TextureData& texture, Entry& entry, uint8_t level)
+    {
+        // Called between frames, so that no pending draw refers to the destroyed texture. The levels come from the
+        // reloaded image.
+        bgfx::destroy(texture.Handle);
+        texture.Handle = TextureStreamer::CreateTexture(entry.Reloaded, level, BGFX_TEXTURE_NONE | BGFX_SAMPLER_NONE);
+
+        SetLevel(entry, level);
+    }
+
+    void TextureResidency::SetLevel(Entry& entry, uint8_t level)
+    {
+        const uint64_t bytes = GetSize(entry, level);
+        m_totalBytes = m_totalBytes - entry.Bytes + bytes;
+        entry.Bytes = bytes;
+        entry.Level = level;
+
+        // A pending reload is no longer wanted, and the reloaded image is only needed until bgfx uploads it.
+        entry.Request = 0;
+        entry.Reloaded = {};
+    }
+}
@@ -0,0 +1,105 @@
+#pragma once
+
+#include "TextureStreamer.h"
+
+#include <cstdint>
+#include <functional>
+#include <unordered_map>
+
+namespace Babylon
+{
+    struct TextureData;
+
+    /// Accounts the memory of loaded textures and keeps it within a budget by dropping the largest mips of the least
+    /// recently bound textures. The dropped levels are restored once the textures are bound again and fit in the
+    /// budget. Only textures with mips that can be loaded again can be reduced, the others are only accounted. The
+    /// remaining levels of a reduced texture are blitted into a smaller texture on the GPU, and its image is loaded
+    /// again to restore the dropped levels, so that no copy of the levels is kept in memory.
+    class TextureResidency final
+    {
+    public:
+        /// Textures are never reduced below this size.
+        static constexpr uint32_t MinimumSize{64};
+
+        /// Loads the image of a texture again, asynchronously, and hands it to Restore along with the request.
+        using Reloader = std::function<void(uint64_t request)>;
+
+        /// Returns the view the blits of the reduced textures are recorded in, which must come before the draws.
+        using BlitViewAcquirer = std::function<bgfx::ViewId()>;
+
+        /// Whether textures can be reduced, which blits their levels.
+        static bool IsSupported()
+        {
+            return (bgfx::getCaps()->supported & BGFX_CAPS_TEXTURE_BLIT) != 0;
+        }
+
+        TextureResidency() = default;
+        TextureResidency(const TextureResidency&) = delete;
+        TextureResidency& operator=(const TextureResidency&) = delete;
+
+        /// Sets the budget in bytes, 0 for no budget.
+        void SetBudget(uint64_t budget);
+
+        bool HasBudget() const
+        {
+            return m_budget > 0;
+        }
+
+        uint64_t GetTotalBytes() const
+        {
+            return m_totalBytes;
+        }
+
+        /// Accounts a texture created from all the levels of the image, which only describes the texture and is not
+        /// kept. reload is called to restore the levels dropped from it.
+        void Track(TextureData* texture, const bimg::ImageContainer& image, Reloader reload);
+
+        /// Accounts a texture that cannot be reduced.
+        void Track(TextureData* texture, uint64_t bytes);
+
+        void Untrack(TextureData* texture);
+
+        /// Receives the image of a texture loaded again, which restores its dropped levels before the next frame if they
+        /// still fit in the budget. Ignored when the texture was untracked or reduced since the request. An empty image
+        /// means it could not be loaded again, the texture then keeps its current levels.
+        void Restore(TextureData* texture, uint64_t request, StreamedImage source);
+
+        /// Drops and restores levels to stay within the budget. Must be called between frames, with the index of the
+        /// frame about to be recorded: the textures bound in the previous frame are restored first and reduced last.
+        void Update(uint32_t frameIndex, const BlitViewAcquirer& acquireBlitView);
+
+        void Clear();
+
+    private:
+        struct Entry
+        {
+            // Description of the levels of the full texture.
+            bgfx::TextureFormat::Enum Format{};
+            uint32_t Width{};
+            uint32_t Height{};
+            uint8_t NumMips{};
+
+            Reloader Reload{};
+            uint64_t Bytes{};
+            uint64_t FullBytes{};
+            uint8_t Level{};
+            uint8_t MaxLevel{};
+
+            // The pending reload of the image, 0 when there is none, and the image once it is loaded.
+            uint64_t Request{};
+            StreamedImage Reloaded{};
+        };
+
+        static uint64_t GetSize(const Entry& entry, uint8_t level);
+
+        void Reduce(uint64_t budget, uint32_t usedBefore, bgfx::ViewId& blitView, const BlitViewAcquirer& acquireBlitView);
+        void Shrink(TextureData& texture, Entry& entry, uint8_t level, bgfx::ViewId blitView);
+        void Grow(TextureData& texture, Entry& entry, uint8_t level);
+        void SetLevel(Entry& entry, uint8_t level);
+
+        uint64_t m_budget{};
+        uint64_t m_totalBytes{};
+        uint64_t m_lastRequest{};
+        std::unordered_map<TextureData*, Entry> m_entries{};
+    };
+}
@@ -0,0 +1,209 @@
+#pragma once
+
+#include <bgfx/bgfx.h>
+#include <bimg/bimg.h>
+
+#include <algorithm>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <utility>
+#include <vector>
+
+namespace Babylon
+{
+    /// A decoded 2D image with mips, and whatever keeps its memory alive while bgfx reads it.
+    struct StreamedImage
+    {
+        bimg::ImageContainer Image{};
+        std::shared_ptr<const void> Owner{};
+
+        // Level the initial texture starts at, 0 when the image is not streamed.
+        uint8_t InitialLevel{};
+    };
+
+    /// Uploads the levels of streamed textures across frames, within a byte budget per frame. A streamed texture is
+    /// first created from its small mips only, which is usable right away and caps the resolution it is sampled at, as
+    /// bgfx has no minimum LOD per texture. The whole mip chain is uploaded to a second texture in chunks of rows, from
+    /// the smallest level to the largest, and replaces the initial texture once complete.
+    class TextureStreamer final
+    {
+    public:
+        using CompletionCallback = std::function<void(bgfx::TextureHandle)>;
+
+        TextureStreamer() = default;
+        TextureStreamer(const TextureStreamer&) = delete;
+        TextureStreamer& operator=(const TextureStreamer&) = delete;
+
+        /// Returns the first level no larger than initialSize, or 0 when the image has no level that small or no mips.
+        static uint8_t GetInitialLevel(const bimg::ImageContainer& image, uint32_t initialSize)
+        {
+            if (image.m_numMips <= 1 || image.m_depth != 1 || image.m_numLayers != 1 || image.m_cubeMap)
+            {
+                return 0;
+            }
+
+            uint8_t level = 0;
+            while (level + 1 < image.m_numMips && std::max(image.m_width >> level, image.m_height >> level) > initialSize)
+            {
+                ++level;
+            }
+            return level;
+        }
+
+        /// Creates a texture from the levels of the image from firstLevel on, without copying them.
+        static bgfx::TextureHandle CreateTexture(const StreamedImage& streamed, uint8_t firstLevel, uint64_t flags)
+        {
+            const bimg::ImageContainer& image = streamed.Image;
+            bimg::ImageMip mip{};
+            bimg::imageGetRawData(image, 0, firstLevel, image.m_data, image.m_size, mip);
+            return bgfx::createTexture2D(
+                static_cast<uint16_t>(GetLevelDimension(image.m_width, firstLevel)),
+                static_cast<uint16_t>(GetLevelDimension(image.m_height, firstLevel)),
+                image.m_numMips > 1, 1, static_cast<bgfx::TextureFormat::Enum>(image.m_format), flags,
+                MakeRef(streamed, mip.m_data, GetLevelsSize(image, firstLevel)));
+        }
+
+        /// Returns the size of the levels of the image from firstLevel on.
+        static uint32_t GetLevelsSize(const bimg::ImageContainer& image, uint8_t firstLevel)
+        {
+            bimg::ImageMip mip{};
+            bimg::imageGetRawData(image, 0, firstLevel, image.m_data, image.m_size, mip);
+            return image.m_size - static_cast<uint32_t>(mip.m_data - static_cast<const uint8_t*>(image.m_data));
+        }
+
+        /// Starts uploading the whole mip chain of the image. The callback receives the complete texture, unless the
+        /// stream is removed first.
+        void Add(const void* key, StreamedImage streamed, uint64_t flags, CompletionCallback onComplete)
+        {
+            const bimg::ImageContainer& image = streamed.Image;
+            const bgfx::TextureHandle handle = bgfx::createTexture2D(static_cast<uint16_t>(image.m_width), static_cast<uint16_t>(image.m_height), true, 1,
+                static_cast<bgfx::TextureFormat::Enum>(image.m_format), flags);
+
+            const uint8_t lastLevel = static_cast<uint8_t>(image.m_numMips - 1);
+            m_streams.push_back({key, std::move(streamed), handle, lastLevel, 0, std::move(onComplete)});
+        }
+
+        /// Stops streaming to the texture, destroying the partially uploaded one.
+        void Remove(const void* key)
+        {
+            const auto it = std::find_if(m_streams.begin(), m_streams.end(), [key](const Stream& stream) { return stream.Key == key; });
+            if (it != m_streams.end())
+            {
+                bgfx::destroy(it->Handle);
+                m_streams.erase(it);
+            }
+        }
+
+        void Clear()
+        {
+            for (const auto& stream : m_streams)
+            {
+                bgfx::destroy(stream.Handle);
+            }
+            m_streams.clear();
+        }
+
+        bool IsEmpty() const
+        {
+            return m_streams.empty();
+        }
+
+        /// Uploads up to byteBudget bytes, oldest streams first, and at least one chunk of rows. Must be called between
+        /// frames, as the completion callbacks swap the textures that draws refer to.
+        void Update(uint32_t byteBudget)
+        {
+            std::vector<std::pair<CompletionCallback, bgfx::TextureHandle>> completed{};
+
+            uint32_t uploaded = 0;
+            for (auto it = m_streams.begin(); it != m_streams.end() && (uploaded < byteBudget || uploaded == 0);)
+            {
+                if (Upload(*it, byteBudget, uploaded))
+                {
+                    completed.emplace_back(std::move(it->OnComplete), it->Handle);
+                    it = m_streams.erase(it);
+                }
+                else
+                {
+                    ++it;
+                }
+            }
+
+            // Called last, as callbacks may remove other streams.
+            for (auto& [onComplete, handle] : completed)
+            {
+                onComplete(handle);
+            }
+        }
+
+    private:
+        struct Stream
+        {
+            const void* Key{};
+            StreamedImage Source{};
+            bgfx::TextureHandle Handle{bgfx::kInvalidHandle};
+            uint8_t Level{};
+            uint32_t BlockRow{};
+            CompletionCallback OnComplete{};
+        };
+
+        static uint32_t GetLevelDimension(uint32_t dimension, uint32_t level)
+        {
+            return std::max(dimension >> level, 1u);
+        }
+
+        static const bgfx::Memory* MakeRef(const StreamedImage& streamed, const uint8_t* data, uint32_t size)
+        {
+            // The image stays alive until bgfx is done with the memory.
+            return bgfx::makeRef(data, size, [](void* /*ptr*/, void* userData) {
+                delete static_cast<std::shared_ptr<const void>*>(userData);
+            }, new std::shared_ptr<const void>{streamed.Owner});
+        }
+
+        // Uploads rows of the current level, then of the next levels, while within the budget. Returns true once the
+        // largest level is complete.
+        static bool Upload(Stream& stream, uint32_t byteBudget, uint32_t& uploaded)
+        {
+            const bimg::ImageContainer& image = stream.Source.Image;
+            const bimg::ImageBlockInfo& blockInfo = bimg::getBlockInfo(image.m_format);
+
+            while (uploaded < byteBudget || uploaded == 0)
+            {
+                bimg::ImageMip mip{};
+                bimg::imageGetRawData(image, 0, stream.Level, image.m_data, image.m_size, mip);
+
+                const uint32_t width = GetLevelDimension(image.m_width, stream.Level);
+                const uint32_t height = GetLevelDimension(image.m_height, stream.Level);
+                const uint32_t blockRowCount = (mip.m_height + blockInfo.blockHeight - 1) / blockInfo.blockHeight;
+                const uint32_t pitch = mip.m_size / blockRowCount;
+
+                // At least one row of blocks, so that every update makes progress.
+                const uint32_t remainingBudget = byteBudget > uploaded ? byteBudget - uploaded : 0;
+                const uint32_t blockRows = std::clamp(remainingBudget / pitch, 1u, blockRowCount - stream.BlockRow);
+
+                const uint32_t y = stream.BlockRow * blockInfo.blockHeight;
+                const uint32_t rows = std::min((stream.BlockRow + blockRows) * blockInfo.blockHeight, height) - y;
+                // Pitches too large for bgfx are computed from the width, which is only an issue for compressed formats.
+                bgfx::updateTexture2D(stream.Handle, 0, stream.Level, 0, static_cast<uint16_t>(y), static_cast<uint16_t>(width), static_cast<uint16_t>(rows),
+                    MakeRef(stream.Source, mip.m_data + stream.BlockRow * pitch, blockRows * pitch), static_cast<uint16_t>(std::min<uint32_t>(pitch, UINT16_MAX)));
+
+                uploaded += blockRows * pitch;
+                stream.BlockRow += blockRows;
+                if (stream.BlockRow == blockRowCount)
+                {
+                    if (stream.Level == 0)
+                    {
+                        return true;
+                    }
+
+                    --stream.Level;
+                    stream.BlockRow = 0;
+                }
+            }
+
+            return false;
+        }
+
+        std::vector<Stream> m_streams{};
+    };
+}
@@ -0,0 +1,83 @@
+#pragma once
+
+#include <bgfx/bgfx.h>
+
+#include <gsl/gsl>
+
+#include <cstdint>
+#include <cstring>
+#include <vector>
+
+namespace Babylon
+{
+    /// Remembers the last value uploaded to each uniform handle on each view during the current frame,
+    /// so that uploads of a value the renderer already holds can be skipped. Views must be sequential
+    /// (bgfx::ViewMode::Sequential) for the draws of a view to be executed in submission order.
+    class UniformShadowState final
+    {
+    public:
+        struct Statistics
+        {
+            uint64_t UniformsSubmitted{};
+            uint64_t UniformsElided{};
+        };
+
+        /// Returns true when the value differs from the last value uploaded to the uniform on the view,
+        /// in which case the value is recorded and must be uploaded by the caller.
+        bool Update(bgfx::ViewId viewId, bgfx::UniformHandle handle, gsl::span<const float> data)
+        {
+            if (m_views.size() <= viewId)
+            {
+                m_views.resize(viewId + 1);
+            }
+
+            auto& uniforms = m_views[viewId];
+            if (uniforms.size() <= handle.idx)
+            {
+                uniforms.resize(handle.idx + 1);
+            }
+
+            auto& shadow = uniforms[handle.idx];
+            const size_t byteSize = static_cast<size_t>(data.size_bytes());
+            if (shadow.Valid && shadow.Data.size() == static_cast<size_t>(data.size()) && std::memcmp(shadow.Data.data(), data.data(), byteSize) == 0)
+            {
+                m_statistics.UniformsElided++;
+                return false;
+            }
+
+            shadow.Data.assign(data.begin(), data.end());
+            shadow.Valid = true;
+            m_statistics.UniformsSubmitted++;
+            return true;
+        }
+
+        /// Forgets all the uploaded values. Must be called whenever the order in which the renderer
+        /// executes draw calls stops matching the order of submission, for example at each new frame.
+        void Reset()
+        {
+            for (auto& uniforms : m_views)
+            {
+                for (auto& shadow : uniforms)
+                {
+                    shadow.Valid = false;
+                }
+            }
+        }
+
+        const Statistics& GetStatistics() const
+        {
+            return m_statistics;
+        }
+
+    private:
+        struct ShadowValue
+        {
+            std::vector<float> Data{};
+            bool Valid{false};
+        };
+
+        // Indexed by view id, then by uniform handle index.
+        std::vector<std::vector<ShadowValue>> m_views{};
+        Statistics m_statistics{};
+    };
+}
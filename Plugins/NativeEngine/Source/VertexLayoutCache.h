@@ -0,0 +1,61 @@
+#pragma once
+
+#include <bgfx/bgfx.h>
+
+#include <cassert>
+#include <cstdint>
+#include <unordered_map>
+
+namespace Babylon
+{
+    /// Shares bgfx vertex layout handles between the vertex arrays that use identical layouts.
+    /// Layouts are identified by the hash bgfx computes in bgfx::VertexLayout::end() and are
+    /// destroyed when the last vertex array using them releases them.
+    class VertexLayoutCache final
+    {
+    public:
+        VertexLayoutCache() = default;
+        VertexLayoutCache(const VertexLayoutCache&) = delete;
+        VertexLayoutCache& operator=(const VertexLayoutCache&) = delete;
+
+        bgfx::VertexLayoutHandle Acquire(const bgfx::VertexLayout& layout)
+        {
+            auto it = m_entries.find(layout.m_hash);
+            if (it == m_entries.end())
+            {
+                const bgfx::VertexLayoutHandle handle = bgfx::createVertexLayout(layout);
+                it = m_entries.emplace(layout.m_hash, Entry{handle, 0}).first;
+                m_hashes[handle.idx] = layout.m_hash;
+            }
+
+            it->second.RefCount++;
+            return it->second.Handle;
+        }
+
+        void Release(bgfx::VertexLayoutHandle handle)
+        {
+            const auto hash = m_hashes.find(handle.idx);
+            assert(hash != m_hashes.end());
+
+            auto it = m_entries.find(hash->second);
+            if (--it->second.RefCount == 0)
+            {
+                bgfx::destroy(it->second.Handle);
+                m_entries.erase(it);
+                m_hashes.erase(hash);
+            }
+        }
+
+    private:
+        struct Entry
+        {
+            bgfx::VertexLayoutHandle Handle{bgfx::kInvalidHandle};
+            uint32_t RefCount{};
+        };
+
+        std::unordered_map<uint32_t, Entry> m_entries{};
+
+        // Maps a layout handle index to the hash of its layout.
+        std::unordered_map<uint16_t, uint32_t> m_hashes{};
+    };
+}
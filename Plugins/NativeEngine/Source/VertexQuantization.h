@@ -0,0 +1,165 @@
+#pragma once
+
+#include <Simd.h>
+
+#include <bgfx/bgfx.h>
+#include <bx/uint32_t.h>
+
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+
+namespace Babylon
+{
+    /// Formats float attributes can be converted to when they are uploaded. The normalized integer
+    /// formats are read by shaders as floats, so shaders are unchanged.
+    enum class VertexQuantization : uint32_t
+    {
+        None,
+        Half,    // 16-bit float, for values of any range.
+        Snorm16, // 16-bit normalized signed integer, for values in [-1, 1].
+        Unorm8,  // 8-bit normalized unsigned integer, for values in [0, 1].
+    };
+
+    struct QuantizedVertexFormat
+    {
+        bgfx::AttribType::Enum Type{};
+        uint8_t NumElements{};
+        bool Normalized{};
+        uint32_t ByteStride{};
+    };
+
+    /// Returns the format of a quantized attribute of numElements floats. Attributes are padded to a
+    /// multiple of 4 bytes and to formats that exist on every renderer (there are no 3 component 16-bit
+    /// or 8-bit formats), the padding components are not read by shaders.
+    inline QuantizedVertexFormat GetQuantizedVertexFormat(VertexQuantization quantization, uint32_t numElements)
+    {
+        switch (quantization)
+        {
+            case VertexQuantization::Half:
+            {
+                const uint8_t padded = static_cast<uint8_t>(numElements <= 2 ? 2 : 4);
+                return {bgfx::AttribType::Half, padded, false, padded * 2u};
+            }
+            case VertexQuantization::Snorm16:
+            {
+                const uint8_t padded = static_cast<uint8_t>(numElements <= 2 ? 2 : 4);
+                return {bgfx::AttribType::Int16, padded, true, padded * 2u};
+            }
+            case VertexQuantization::Unorm8:
+                return {bgfx::AttribType::Uint8, 4, true, 4};
+            default:
+                return {bgfx::AttribType::Float, static_cast<uint8_t>(numElements), false, numElements * 4};
+        }
+    }
+
+    /// Returns true when every value can be represented by the quantized format.
+    inline bool CanQuantizeVertices(VertexQuantization quantization, const float* values, size_t count)
+    {
+        float minimum = 0.0f;
+        float maximum = 0.0f;
+        for (size_t index = 0; index < count; ++index)
+        {
+            if (!std::isfinite(values[index]))
+            {
+                return false;
+            }
+            minimum = std::min(minimum, values[index]);
+            maximum = std::max(maximum, values[index]);
+        }
+
+        switch (quantization)
+        {
+            case VertexQuantization::Half:
+                return minimum >= -65504.0f && maximum <= 65504.0f;
+            case VertexQuantization::Snorm16:
+                return minimum >= -1.0f && maximum <= 1.0f;
+            case VertexQuantization::Unorm8:
+                return minimum >= 0.0f && maximum <= 1.0f;
+            default:
+                return false;
+        }
+    }
+
+    /// Converts vertexCount vertices of numElements tightly packed floats to the quantized format.
+    /// The destination must hold vertexCount * GetQuantizedVertexFormat(...).ByteStride bytes.
+    inline void QuantizeVertices(VertexQuantization quantization, const float* source, size_t vertexCount, uint32_t numElements, uint8_t* destination)
+    {
+        const QuantizedVertexFormat format = GetQuantizedVertexFormat(quantization, numElements);
+        for (size_t vertex = 0; vertex < vertexCount; ++vertex, source += numElements, destination += format.ByteStride)
+        {
+            float values[4]{};
+            std::memcpy(values, source, numElements * sizeof(float));
+
+            switch (quantization)
+            {
+                case VertexQuantization::Half:
+                {
+#if defined(BABYLON_SIMD_F16C)
+                    const __m128i halves = _mm_cvtps_ph(_mm_loadu_ps(values), _MM_FROUND_TO_NEAREST_INT);
+                    uint16_t converted[8];
+                    _mm_storeu_si128(reinterpret_cast<__m128i*>(converted), halves);
+#elif defined(BABYLON_SIMD_NEON)
+                    uint16_t converted[4];
+                    vst1_u16(converted, vreinterpret_u16_f16(vcvt_f16_f32(vld1q_f32(values))));
+#else
+                    uint16_t converted[4];
+                    for (size_t index = 0; index < 4; ++index)
+                    {
+                        converted[index] = bx::halfFromFloat(values[index]);
+                    }
+#endif
+                    std::memcpy(destination, converted, format.ByteStride);
+                    break;
+                }
+                case VertexQuantization::Snorm16:
+                {
+#if defined(BABYLON_SIMD_SSE2)
+                    const __m128 clamped = _mm_min_ps(_mm_max_ps(_mm_loadu_ps(values), _mm_set1_ps(-1.0f)), _mm_set1_ps(1.0f));
+                    const __m128i integers = _mm_cvtps_epi32(_mm_mul_ps(clamped, _mm_set1_ps(32767.0f)));
+                    int16_t converted[8];
+                    _mm_storeu_si128(reinterpret_cast<__m128i*>(converted), _mm_packs_epi32(integers, integers));
+#elif defined(BABYLON_SIMD_NEON)
+                    const float32x4_t clamped = vminq_f32(vmaxq_f32(vld1q_f32(values), vdupq_n_f32(-1.0f)), vdupq_n_f32(1.0f));
+                    int16_t converted[4];
+                    vst1_s16(converted, vqmovn_s32(vcvtnq_s32_f32(vmulq_n_f32(clamped, 32767.0f))));
+#else
+                    int16_t converted[4];
+                    for (size_t index = 0; index < 4; ++index)
+                    {
+                        converted[index] = static_cast<int16_t>(std::lround(std::clamp(values[index], -1.0f, 1.0f) * 32767.0f));
+                    }
+#endif
+                    std::memcpy(destination, converted, format.ByteStride);
+                    break;
+                }
+                case VertexQuantization::Unorm8:
+                {
+#if defined(BABYLON_SIMD_SSE2)
+                    const __m128 clamped = _mm_min_ps(_mm_max_ps(_mm_loadu_ps(values), _mm_setzero_ps()), _mm_set1_ps(1.0f));
+                    const __m128i integers = _mm_cvtps_epi32(_mm_mul_ps(clamped, _mm_set1_ps(255.0f)));
+                    const __m128i words = _mm_packs_epi32(integers, integers);
+                    const int32_t converted = _mm_cvtsi128_si32(_mm_packus_epi16(words, words));
+#elif defined(BABYLON_SIMD_NEON)
+                    const float32x4_t clamped = vminq_f32(vmaxq_f32(vld1q_f32(values), vdupq_n_f32(0.0f)), vdupq_n_f32(1.0f));
+                    const uint16x4_t words = vqmovn_u32(vcvtnq_u32_f32(vmulq_n_f32(clamped, 255.0f)));
+                    const uint32_t converted = vget_lane_u32(vreinterpret_u32_u8(vqmovn_u16(vcombine_u16(words, words))), 0);
+#else
+                    uint8_t converted[4];
+                    for (size_t index = 0; index < 4; ++index)
+                    {
+                        converted[index] = static_cast<uint8_t>(std::lround(std::clamp(values[index], 0.0f, 1.0f) * 255.0f));
+                    }
+#endif
+                    std::memcpy(destination, &converted, format.ByteStride);
+                    break;
+                }
+                default:
+                    std::memcpy(destination, values, format.ByteStride);
+                    break;
+            }
+        }
+    }
+}
@@ -394,11 +394,14 @@ namespace Babylon
             auto it = m_texturesToFrameBuffers.find(texPtr);
             if (it != m_texturesToFrameBuffers.end())
             {
+                // Draws held back for auto-instancing may target the FrameBuffer.
+                m_engineImpl->FlushPendingDrawsForViewChange();
                 if (&m_engineImpl->GetFrameBufferManager().GetBound() == it->second.get())
                 {
                     // bind back buffer because currently bound FrameBuffer will be destroyed
                     m_engineImpl->GetFrameBufferManager().Unbind(it->second.get());
                 }
+                m_engineImpl->OnFrameBufferDestroyed(*it->second);
                 m_texturesToFrameBuffers.erase(it);
             }
         });